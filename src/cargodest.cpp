@@ -15,6 +15,7 @@
 #include "cargodest_func.h"
 #include "core/bitmath_func.hpp"
 #include "core/random_func.hpp"
+#include "core/sort_func.hpp"
 #include "core/pool_func.hpp"
 #include "cargotype.h"
 #include "settings_type.h"
@@ -25,6 +26,11 @@
 #include "station_base.h"
 #include "pathfinder/yapf/yapf.h"
 #include "company_base.h"
+#include "date_func.h"
+#include "debug.h"
+#include "thread/thread.h"
+#include <set>
+#include <vector>
 
 
 /* Possible link weight modifiers. */
@@ -129,6 +135,180 @@ static bool IsNearby(TileIndex t1, TileIndex t2, uint32 dist_square)
 	return DistanceSquare(t1, t2) < ScaleByMapSize1D(dist_square);
 }
 
+/**
+ * Grid index of towns or industries, used to find the candidates
+ * for a "nearby" search without looking at every item on the map.
+ * @tparam T Town or Industry.
+ */
+template <typename T>
+class NearbyIndex {
+	typedef std::vector<uint16> Cell;
+
+	static const uint CELL_BITS = 6; ///< Log2 of the cell size in tiles.
+
+	std::vector<Cell> cells; ///< Item IDs of each cell.
+	uint size_x;             ///< Number of cells in x direction.
+	uint size_y;             ///< Number of cells in y direction.
+
+	/** Get the location an item is indexed with. */
+	static inline TileIndex GetTile(const Town *t) { return t->xy; }
+	static inline TileIndex GetTile(const Industry *ind) { return ind->location.tile; }
+
+	/** Get the cell containing a tile. */
+	inline Cell &GetCell(TileIndex tile)
+	{
+		return this->cells[(TileY(tile) >> CELL_BITS) * this->size_x + (TileX(tile) >> CELL_BITS)];
+	}
+
+	/** Make sure the cells match the current map size. */
+	void CheckMapSize()
+	{
+		uint size_x = MapSizeX() >> CELL_BITS;
+		uint size_y = MapSizeY() >> CELL_BITS;
+		if (size_x != this->size_x || size_y != this->size_y) {
+			this->size_x = size_x;
+			this->size_y = size_y;
+			this->Clear();
+		}
+	}
+
+public:
+	NearbyIndex() : size_x(0), size_y(0) {}
+
+	/** Remove all items from the index. */
+	void Clear()
+	{
+		this->cells.clear();
+		this->cells.resize(this->size_x * this->size_y);
+	}
+
+	/**
+	 * Add an item to the index.
+	 * @param item The item.
+	 */
+	void Add(const T *item)
+	{
+		this->CheckMapSize();
+		this->GetCell(GetTile(item)).push_back(item->index);
+	}
+
+	/**
+	 * Remove an item from the index.
+	 * @param item The item.
+	 */
+	void Remove(const T *item)
+	{
+		this->CheckMapSize();
+		/* Items that never got a location were never added. */
+		if (GetTile(item) >= MapSize()) return;
+
+		Cell &cell = this->GetCell(GetTile(item));
+		for (Cell::iterator it = cell.begin(); it != cell.end(); ++it) {
+			if (*it == item->index) {
+				cell.erase(it);
+				return;
+			}
+		}
+	}
+
+	/** Rebuild the index from the pool. */
+	void Rebuild()
+	{
+		this->CheckMapSize();
+		this->Clear();
+
+		const T *item;
+		FOR_ALL_ITEMS_FROM(T, index, item, 0) this->Add(item);
+	}
+
+	/**
+	 * Pick a random item near a tile. The result and the random numbers
+	 * drawn are the same as for T::GetRandom with an enum proc that
+	 * includes the same distance test.
+	 * @param enum_proc Callback function. Only items passing this check are considered.
+	 * @param skip Skip over this item ID when searching.
+	 * @param xy Centre of the search.
+	 * @param dist_square Unscaled squared search distance as passed to #IsNearby.
+	 * @param data Optional data passed to the callback function.
+	 * @return A random item satisfying the search criteria or NULL if none exists.
+	 */
+	T *GetRandom(bool (*enum_proc)(const T *, void *), size_t skip, TileIndex xy, uint32 dist_square, void *data)
+	{
+		this->CheckMapSize();
+
+		/* Every tile within the distance is inside this square around the centre. */
+		uint radius = IntSqrt(ScaleByMapSize1D(dist_square)) + 1;
+		uint x0 = (TileX(xy) - min(TileX(xy), radius)) >> CELL_BITS;
+		uint y0 = (TileY(xy) - min(TileY(xy), radius)) >> CELL_BITS;
+		uint x1 = min(TileX(xy) + radius, MapMaxX()) >> CELL_BITS;
+		uint y1 = min(TileY(xy) + radius, MapMaxY()) >> CELL_BITS;
+
+		static SmallVector<uint16, 64> candidates;
+		candidates.Clear();
+		for (uint y = y0; y <= y1; y++) {
+			for (uint x = x0; x <= x1; x++) {
+				const Cell &cell = this->cells[y * this->size_x + x];
+				for (Cell::const_iterator it = cell.begin(); it != cell.end(); ++it) {
+					if (*it != skip && enum_proc(T::Get(*it), data)) *candidates.Append() = *it;
+				}
+			}
+		}
+		if (candidates.Length() == 0) return NULL;
+
+		/* Choose in pool order, exactly like T::GetRandom does. */
+		QSortT(candidates.Begin(), candidates.Length(), &CompareIDs);
+		return T::Get(candidates[RandomRange((uint16)candidates.Length())]);
+	}
+
+private:
+	static int CDECL CompareIDs(const uint16 *a, const uint16 *b)
+	{
+		return (int)*a - (int)*b;
+	}
+};
+
+static NearbyIndex<Town> _nearby_towns;          ///< Grid index of all towns.
+static NearbyIndex<Industry> _nearby_industries; ///< Grid index of all industries.
+
+/** Add a town to the index of nearby link candidates. */
+void AddToNearbyIndex(const Town *t)
+{
+	_nearby_towns.Add(t);
+}
+
+/** Add an industry to the index of nearby link candidates. */
+void AddToNearbyIndex(const Industry *ind)
+{
+	_nearby_industries.Add(ind);
+}
+
+/** Remove a town from the index of nearby link candidates. */
+void RemoveFromNearbyIndex(const Town *t)
+{
+	if (Town::CleaningPool()) {
+		_nearby_towns.Clear();
+	} else {
+		_nearby_towns.Remove(t);
+	}
+}
+
+/** Remove an industry from the index of nearby link candidates. */
+void RemoveFromNearbyIndex(const Industry *ind)
+{
+	if (Industry::CleaningPool()) {
+		_nearby_industries.Clear();
+	} else {
+		_nearby_industries.Remove(ind);
+	}
+}
+
+/** Rebuild the index of nearby link candidates, e.g. after loading a game. */
+void RebuildNearbyIndex()
+{
+	_nearby_towns.Rebuild();
+	_nearby_industries.Rebuild();
+}
+
 /**
  * Test whether a tiles is near a town.
  * @param t The town.
@@ -254,7 +434,11 @@ static CargoSourceSink *FindTownDestination(byte &weight_mod, CargoSourceSink *s
 		/* Skip if destination class not reached. */
 		if (destclass > destclass_chance[i]) continue;
 
-		dest = Town::GetRandom(destclass_enum[i], skip, &erd);
+		if (destclass_enum[i] == &EnumNearbyTown) {
+			dest = _nearby_towns.GetRandom(destclass_enum[i], skip, source_xy, _settings_game.economy.cargodest.town_nearby_dist, &erd);
+		} else {
+			dest = Town::GetRandom(destclass_enum[i], skip, &erd);
+		}
 		weight_mod = weight_mods[i];
 	}
 
@@ -283,7 +467,11 @@ static CargoSourceSink *FindIndustryDestination(byte &weight_mod, CargoSourceSin
 		/* Skip if destination class not reached. */
 		if (destclass > _settings_game.economy.cargodest.ind_chances[i]) continue;
 
-		dest = Industry::GetRandom(destclass_enum[i], skip, &erd);
+		if (destclass_enum[i] == &EnumNearbyIndustry) {
+			dest = _nearby_industries.GetRandom(destclass_enum[i], skip, source_xy, _settings_game.economy.cargodest.ind_nearby_dist, &erd);
+		} else {
+			dest = Industry::GetRandom(destclass_enum[i], skip, &erd);
+		}
 		weight_mod = weight_mods[i];
 	}
 
@@ -300,13 +488,13 @@ static CargoSourceSink *FindSupplySource(Industry *dest, CargoID cid)
 	/* Even chance for industry source first, town second and vice versa.
 	 * Try a nearby supplier first, then check all suppliers. */
 	if (Chance16(1, 2)) {
-		source = Industry::GetRandom(&EnumNearbySupplier, dest->index, &erd);
-		if (source == NULL) source = Town::GetRandom(&EnumNearbySupplier, INVALID_TOWN, &erd);
+		source = _nearby_industries.GetRandom(&EnumNearbySupplier, dest->index, dest->location.tile, _settings_game.economy.cargodest.ind_nearby_dist, &erd);
+		if (source == NULL) source = _nearby_towns.GetRandom(&EnumNearbySupplier, INVALID_TOWN, dest->location.tile, _settings_game.economy.cargodest.town_nearby_dist, &erd);
 		if (source == NULL) source = Industry::GetRandom(&EnumAnySupplier, dest->index, &erd);
 		if (source == NULL) source = Town::GetRandom(&EnumAnySupplier, INVALID_TOWN, &erd);
 	} else {
-		source = Town::GetRandom(&EnumNearbySupplier, INVALID_TOWN, &erd);
-		if (source == NULL) source = Industry::GetRandom(&EnumNearbySupplier, dest->index, &erd);
+		source = _nearby_towns.GetRandom(&EnumNearbySupplier, INVALID_TOWN, dest->location.tile, _settings_game.economy.cargodest.town_nearby_dist, &erd);
+		if (source == NULL) source = _nearby_industries.GetRandom(&EnumNearbySupplier, dest->index, dest->location.tile, _settings_game.economy.cargodest.ind_nearby_dist, &erd);
 		if (source == NULL) source = Town::GetRandom(&EnumAnySupplier, INVALID_TOWN, &erd);
 		if (source == NULL) source = Industry::GetRandom(&EnumAnySupplier, dest->index, &erd);
 	}
@@ -325,6 +513,7 @@ static CargoSourceSink *FindSupplySource(Industry *dest, CargoID cid)
 		*this->cargo_links[cid].Append() = *this->cargo_links[cid].Get(0);
 		*this->cargo_links[cid].Get(0) = CargoLink(NULL, LWM_ANYWHERE);
 	}
+	this->InvalidateLinkWeightIndex(cid);
 }
 
 /* virtual */ void Town::CreateSpecialLinks(CargoID cid)
@@ -345,6 +534,7 @@ static CargoSourceSink *FindSupplySource(Industry *dest, CargoID cid)
 			this->cargo_links[cid].Erase(this->cargo_links[cid].Get(1));
 		}
 	}
+	this->InvalidateLinkWeightIndex(cid);
 }
 
 /**
@@ -373,9 +563,11 @@ static void RemoveLowestLink(CargoSourceSink *source, CargoID cid)
 		if (IsSymmetricCargo(cid) && lowest_link->dest->HasLinkTo(cid, source)) {
 			source->num_incoming_links[cid]--;
 			lowest_link->dest->cargo_links[cid].Erase(lowest_link->dest->cargo_links[cid].Find(CargoLink(source, LWM_ANYWHERE)));
+			lowest_link->dest->InvalidateLinkWeightIndex(cid);
 		}
 		lowest_link->dest->num_incoming_links[cid]--;
 		source->cargo_links[cid].Erase(lowest_link);
+		source->InvalidateLinkWeightIndex(cid);
 	}
 }
 
@@ -413,10 +605,12 @@ static void CreateNewLinks(CargoSourceSink *source, TileIndex source_xy, CargoID
 		/* If this is a symmetric cargo and we accept it as well, create a back link. */
 		if (IsSymmetricCargo(cid) && dest->SuppliesCargo(cid) && source->AcceptsCargo(cid)) {
 			*dest->cargo_links[cid].Append() = CargoLink(source, weight_mod);
+			dest->InvalidateLinkWeightIndex(cid);
 			source->num_incoming_links[cid]++;
 		}
 
 		*source->cargo_links[cid].Append() = CargoLink(dest, weight_mod);
+		source->InvalidateLinkWeightIndex(cid);
 		dest->num_incoming_links[cid]++;
 	}
 }
@@ -443,6 +637,8 @@ static void RemoveInvalidLinks(CargoSourceSink *css)
 				l++;
 			}
 		}
+
+		css->InvalidateLinkWeightIndex(cid);
 	}
 }
 
@@ -522,11 +718,13 @@ void AddMissingIndustryLinks(Industry *ind)
 		}
 
 		*source->cargo_links[cid].Append() = CargoLink(ind, LWM_IND_ANY);
+		source->InvalidateLinkWeightIndex(cid);
 		ind->num_incoming_links[cid]++;
 
 		/* If this is a symmetric cargo and we produce it as well, create a back link. */
 		if (IsSymmetricCargo(cid) && ind->SuppliesCargo(cid) && source->AcceptsCargo(cid)) {
 			*ind->cargo_links[cid].Append() = CargoLink(source, LWM_IND_ANY);
+			ind->InvalidateLinkWeightIndex(cid);
 			source->num_incoming_links[cid]++;
 		}
 	}
@@ -627,6 +825,7 @@ void UpdateLinkWeights(Town *t)
 		t->cargo_links[cid].Begin()->weight = weight_sum == 0 ? 1 : (weight_sum * _settings_game.economy.cargodest.random_dest_chance) / (100 - _settings_game.economy.cargodest.random_dest_chance);
 
 		t->cargo_links_weight[cid] = weight_sum + t->cargo_links[cid].Begin()->weight;
+		t->UpdateLinkWeightIndex(cid);
 	}
 }
 
@@ -651,6 +850,7 @@ void UpdateLinkWeights(CargoSourceSink *css)
 		css->cargo_links[cid].Begin()->weight = weight_sum == 0 ? 1 : (weight_sum * _settings_game.economy.cargodest.random_dest_chance) / (100 - _settings_game.economy.cargodest.random_dest_chance);
 
 		css->cargo_links_weight[cid] = weight_sum + css->cargo_links[cid].Begin()->weight;
+		css->UpdateLinkWeightIndex(cid);
 	}
 }
 
@@ -664,6 +864,7 @@ void UpdateLinkWeights(CargoSourceSink *css)
 		for (CargoID cid = 0; cid < NUM_CARGO; cid++) {
 			if (t->HasLinkTo(cid, this)) {
 				t->cargo_links[cid].Erase(t->cargo_links[cid].Find(CargoLink(this, LWM_ANYWHERE)));
+				t->InvalidateLinkWeightIndex(cid);
 				InvalidateWindowData(WC_TOWN_VIEW, t->index, 1);
 			}
 		}
@@ -674,6 +875,7 @@ void UpdateLinkWeights(CargoSourceSink *css)
 		for (CargoID cid = 0; cid < NUM_CARGO; cid++) {
 			if (ind->HasLinkTo(cid, this)) {
 				ind->cargo_links[cid].Erase(ind->cargo_links[cid].Find(CargoLink(this, LWM_ANYWHERE)));
+				ind->InvalidateLinkWeightIndex(cid);
 				InvalidateWindowData(WC_INDUSTRY_VIEW, ind->index, 1);
 			}
 		}
@@ -717,6 +919,8 @@ void UpdateCargoLinks()
 {
 	if (CargoDestinationsDisabled()) return;
 
+	CargodestPerfTimer perf(CDPE_UPDATE_LINKS);
+
 	Town *t;
 	Industry *ind;
 
@@ -743,6 +947,106 @@ void UpdateCargoLinks()
 	InvalidateWindowClassesData(WC_INDUSTRY_VIEW, 1);
 }
 
+/** Number of days per month the demand links are updated on. */
+static const uint CARGO_LINK_UPDATE_DAYS = 28;
+
+static bool _town_links_changed     = false; ///< Were demand links of a town updated since the town windows were last invalidated?
+static bool _industry_links_changed = false; ///< Were demand links of an industry updated since the industry windows were last invalidated?
+
+/**
+ * Update the demand links of a single town. This is
+ * the same work #UpdateCargoLinks does for each town.
+ * @param t The town to update.
+ */
+static void UpdateAllCargoLinks(Town *t)
+{
+	RemoveInvalidLinks(t);
+	UpdateExpectedLinks(t);
+	UpdateCargoLinks(t);
+	UpdateLinkWeights(t);
+}
+
+/**
+ * Update the demand links of a single industry. This is
+ * the same work #UpdateCargoLinks does for each industry.
+ * @param ind The industry to update.
+ */
+static void UpdateAllCargoLinks(Industry *ind)
+{
+	RemoveInvalidLinks(ind);
+	UpdateExpectedLinks(ind);
+	AddMissingIndustryLinks(ind);
+	UpdateCargoLinks(ind);
+	UpdateLinkWeights(ind);
+}
+
+/**
+ * Update the demand links of a slice of all towns and industries. Spread over
+ * the first #CARGO_LINK_UPDATE_DAYS days of each month, every town and industry
+ * is updated exactly once. The slice is derived from the current date only,
+ * so no extra state has to be saved to keep multiplayer games in sync.
+ */
+void OnTick_CargoLinks()
+{
+	if (_game_mode == GM_EDITOR) return;
+
+	uint ticks_per_day = DAY_TICKS_DAY_LENGTH;
+
+	if (!CargoDestinationsDisabled()) {
+		YearMonthDay ymd;
+		ConvertDateToYMD(_date, &ymd);
+
+		uint slices = CARGO_LINK_UPDATE_DAYS * ticks_per_day;
+		uint slice = (ymd.day - 1) * ticks_per_day + _date_fract;
+
+		if (slice < slices) {
+			CargodestPerfTimer perf(CDPE_UPDATE_LINKS);
+
+			for (size_t index = slice; index < Town::GetPoolSize(); index += slices) {
+				Town *t = Town::GetIfValid(index);
+				if (t == NULL) continue;
+
+				UpdateAllCargoLinks(t);
+				_town_links_changed = true;
+			}
+			for (size_t index = slice; index < Industry::GetPoolSize(); index += slices) {
+				Industry *ind = Industry::GetIfValid(index);
+				if (ind == NULL) continue;
+
+				UpdateAllCargoLinks(ind);
+				_industry_links_changed = true;
+			}
+		}
+	}
+
+	/* Refresh the link lists in the windows once a day. */
+	if (_date_fract == ticks_per_day - 1) {
+		if (_town_links_changed) InvalidateWindowClassesData(WC_TOWN_VIEW, 1);
+		if (_industry_links_changed) InvalidateWindowClassesData(WC_INDUSTRY_VIEW, 1);
+		_town_links_changed = false;
+		_industry_links_changed = false;
+	}
+}
+
+/**
+ * Recalculate the running sums and the total of the link weights of a cargo.
+ * @param cid Cargo type.
+ */
+void CargoSourceSink::UpdateLinkWeightIndex(CargoID cid)
+{
+	SmallVector<uint, 8> &cum = this->cargo_links_cum_weight[cid];
+	cum.Clear();
+
+	uint cur_sum = 0;
+	for (const CargoLink *l = this->cargo_links[cid].Begin(); l != this->cargo_links[cid].End(); ++l) {
+		cur_sum += l->weight;
+		*cum.Append() = cur_sum;
+	}
+
+	/* Links of other sources can change at any time, keep the total in sync. */
+	this->cargo_links_weight[cid] = cur_sum;
+}
+
 /**
  * Get a random demand link.
  * @param cid Cargo type
@@ -751,20 +1055,32 @@ void UpdateCargoLinks()
  */
 CargoLink *CargoSourceSink::GetRandomLink(CargoID cid, bool allow_self)
 {
+	if (this->cargo_links_cum_weight[cid].Length() != this->cargo_links[cid].Length()) this->UpdateLinkWeightIndex(cid);
+
 	/* Randomly choose a cargo link. */
 	uint weight = RandomRange(this->cargo_links_weight[cid] - 1);
-	uint cur_sum = 0;
 
-	CargoLink *l;
-	for (l = this->cargo_links[cid].Begin(); l != this->cargo_links[cid].End(); ++l) {
-		cur_sum += l->weight;
-		if (weight < cur_sum) {
-			/* Link is valid if it is random destination or only the
-			 * local link if allowed and accepts the cargo. */
-			if (l->dest == NULL || ((allow_self || l->dest != this) && l->dest->AcceptsCargo(cid))) break;
+	/* Binary search for the first link whose running weight sum exceeds the chosen weight. */
+	const uint *cum = this->cargo_links_cum_weight[cid].Begin();
+	uint lo = 0;
+	uint hi = this->cargo_links_cum_weight[cid].Length();
+	while (lo < hi) {
+		uint mid = (lo + hi) / 2;
+		if (weight < cum[mid]) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
 		}
 	}
 
+	/* If the chosen link is not usable, take the next usable one after it. */
+	CargoLink *l;
+	for (l = this->cargo_links[cid].Get(lo); l != this->cargo_links[cid].End(); ++l) {
+		/* Link is valid if it is random destination or only the
+		 * local link if allowed and accepts the cargo. */
+		if (l->dest == NULL || ((allow_self || l->dest != this) && l->dest->AcceptsCargo(cid))) break;
+	}
+
 	return l;
 }
 
@@ -777,19 +1093,24 @@ CargoLink *CargoSourceSink::GetRandomLink(CargoID cid, bool allow_self)
 	/* Randomly choose a target square. */
 	uint32 weight = RandomRange(this->cargo_accepted_weights[cid] - 1);
 
-	/* Iterate over all grid squares till the chosen square is found. */
-	uint32 weight_sum = 0;
-	const TileArea &area = this->cargo_accepted.GetArea();
-	TILE_AREA_LOOP(tile, area) {
-		if (TileX(tile) % AcceptanceMatrix::GRID == 0 && TileY(tile) % AcceptanceMatrix::GRID == 0) {
-			weight_sum += this->cargo_accepted_max_weight - (DistanceMax(this->xy_aligned, tile) / AcceptanceMatrix::GRID) * 2;
-			/* Return tile area inside the grid square if this is the chosen square. */
-			if (weight < weight_sum) return TileArea(tile + TileDiffXY(1, 1), 2, 2);
+	/* Binary search for the first accepting square whose running weight sum exceeds the chosen weight. */
+	const AcceptanceIndexItem *index = this->cargo_accepted_index[cid].Begin();
+	uint lo = 0;
+	uint hi = this->cargo_accepted_index[cid].Length();
+	while (lo < hi) {
+		uint mid = (lo + hi) / 2;
+		if (weight < index[mid].weight_sum) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
 		}
 	}
 
 	/* Something went wrong here... */
-	NOT_REACHED();
+	assert(lo < this->cargo_accepted_index[cid].Length());
+
+	/* Return tile area inside the chosen grid square. */
+	return TileArea(index[lo].tile + TileDiffXY(1, 1), 2, 2);
 }
 
 /** Enumerate all towns accepting a specific cargo. */
@@ -926,6 +1247,8 @@ bool MoveCargoWithDestinationToStation(CargoID cid, uint *amount, SourceType sou
 {
 	if (!CargoHasDestinations(cid)) return false;
 
+	CargodestPerfTimer perf(CDPE_MOVE_TO_STATION);
+
 	/* Split the cargo into multiple destinations for industries. */
 	int num_packets = 1;
 	if (source_type == ST_INDUSTRY) {
@@ -950,6 +1273,160 @@ bool MoveCargoWithDestinationToStation(CargoID cid, uint *amount, SourceType sou
 	return true;
 }
 
+/** Route table epoch, changing it invalidates all cached routing decisions. */
+static uint32 _route_table_epoch = 0;
+/** Memo generation, changed at the end of each tick and on any route link change. */
+static uint32 _route_table_memo = 0;
+
+/**
+ * Invalidate all cached routing decisions. Used for changes that can't
+ * be attributed to the route links of a single station, like station
+ * layout, acceptance, order flags or settings.
+ */
+void InvalidateRouteTables()
+{
+	_route_table_epoch++;
+	_route_table_memo++;
+}
+
+/**
+ * Stop reusing routing decisions without checking the waiting cargo.
+ * Called at the end of each tick, so no memo survives into the next
+ * tick or the commands executed before it. This keeps the memo out
+ * of the savegame state a joining client gets.
+ */
+void ResetRouteTableMemo()
+{
+	_route_table_memo++;
+}
+
+/**
+ * Record a station the routing decision depends on, that is the route
+ * links originating at the station and the cargo waiting for each of them.
+ * @param st The station.
+ * @param cid Cargo type of the decision.
+ */
+void RouteTableEntry::AddStation(const Station *st, CargoID cid)
+{
+	/* Each station only needs to be recorded once. */
+	for (const RouteTableDependency *d = this->deps.Begin(); d != this->deps.End(); d++) {
+		if (d->station == st->index && d->order == INVALID_ORDER) return;
+	}
+
+	const GoodsEntry &ge = st->goods[cid];
+
+	RouteTableDependency *d = this->deps.Append();
+	d->station = st->index;
+	d->order   = INVALID_ORDER;
+	d->value   = ge.route_table.GetLinksStamp();
+
+	for (RouteLinkList::const_iterator link = ge.routes.begin(); link != ge.routes.end(); ++link) {
+		d = this->deps.Append();
+		d->station = st->index;
+		d->order   = (*link)->GetOriginOrderId();
+		d->value   = (uint32)ge.cargo.CountForNextHop(d->order);
+	}
+}
+
+/**
+ * Test whether a new search would still come to the same result as this decision.
+ * @param cid Cargo type of the decision.
+ * @return True if the decision is still valid.
+ */
+bool RouteTableEntry::IsValid(CargoID cid) const
+{
+	if (this->epoch != _route_table_epoch) return false;
+
+	const GoodsEntry *ge = NULL;
+	for (const RouteTableDependency *d = this->deps.Begin(); d != this->deps.End(); d++) {
+		if (d->station == INVALID_STATION) {
+			/* Flags of the order the cargo arrived with. */
+			if (!Order::IsValidID(d->order)) return false;
+			const Order *o = Order::Get(d->order);
+			if ((uint32)(o->GetUnloadType() | o->GetLoadType() << 8) != d->value) return false;
+		} else if (d->order == INVALID_ORDER) {
+			/* Route links of a station. The waiting cargo entries for this station follow. */
+			ge = &Station::Get(d->station)->goods[cid];
+			if (ge->route_table.GetLinksStamp() != d->value) return false;
+		} else {
+			if ((uint32)ge->cargo.CountForNextHop(d->order) != d->value) return false;
+		}
+	}
+
+	return true;
+}
+
+/** The route links originating at this station have changed. */
+void RouteTable::OnLinksChanged()
+{
+	this->links_stamp++;
+	/* All our decisions started with the old links. */
+	this->entries.clear();
+	/* Decisions at other stations might have used our links. */
+	_route_table_memo++;
+}
+
+/**
+ * Find a still valid routing decision.
+ * @param key Key of the decision.
+ * @param cid Cargo type of this table.
+ * @return The routing decision or NULL if none valid is cached.
+ */
+RouteTableEntry *RouteTable::Find(const RouteTableKey &key, CargoID cid)
+{
+	EntryMap::iterator it = this->entries.find(key);
+	if (it == this->entries.end()) return NULL;
+
+	/* Already made or confirmed this tick? */
+	if (it->second.memo == _route_table_memo) return &it->second;
+
+	if (!it->second.IsValid(cid)) {
+		this->entries.erase(it);
+		return NULL;
+	}
+	it->second.memo = _route_table_memo;
+	return &it->second;
+}
+
+/**
+ * Create a new empty routing decision.
+ * @param key Key of the decision.
+ * @return The new routing decision.
+ */
+RouteTableEntry *RouteTable::Insert(const RouteTableKey &key)
+{
+	/* Start over if the table is getting too big. */
+	if (this->entries.size() >= MAX_ENTRIES) this->entries.clear();
+
+	RouteTableEntry *entry = &this->entries[key];
+	entry->link        = INVALID_ROUTE_LINK;
+	entry->next_unload = INVALID_STATION;
+	entry->found       = false;
+	entry->epoch       = _route_table_epoch;
+	entry->memo        = _route_table_memo;
+	entry->deps.Clear();
+
+	if (key.order != INVALID_ORDER) {
+		const Order *o = Order::Get(key.order);
+		RouteTableDependency *d = entry->deps.Append();
+		d->station = INVALID_STATION;
+		d->order   = key.order;
+		d->value   = o->GetUnloadType() | o->GetLoadType() << 8;
+	}
+
+	return entry;
+}
+
+/**
+ * Get the destination area of a cargo packet.
+ * @param cp Cargo packet with destination information.
+ * @return Tile area the cargo should be delivered to.
+ */
+static inline TileArea GetCargoDestinationArea(const CargoPacket *cp)
+{
+	return (cp->DestinationType() == ST_INDUSTRY) ? Industry::Get(cp->DestinationID())->location : TileArea(cp->DestinationXY(), 2, 2);
+}
+
 /**
  * Get the current best route link for a cargo packet at a station.
  * @param st Station the route starts at.
@@ -963,11 +1440,259 @@ RouteLink *FindRouteLinkForCargo(Station *st, CargoID cid, const CargoPacket *cp
 {
 	if (cp->DestinationID() == INVALID_SOURCE) return NULL;
 
+	TileArea area = GetCargoDestinationArea(cp);
+	RouteTableKey key(area, order, cp->Flags());
+
+	/* Reuse the last decision for this destination if nothing it was based on has changed. */
+	RouteTableEntry *entry = st->goods[cid].route_table.Find(key, cid);
+	if (entry == NULL) {
+		StationList sl;
+		*sl.Append() = st;
+
+		entry = st->goods[cid].route_table.Insert(key);
+		RouteLink *link = YapfChooseRouteLink(cid, &sl, st->xy, area, NULL, &entry->next_unload, cp->Flags(), &entry->found, order, INT_MAX, entry);
+		if (link != NULL) entry->link = link->index;
+	}
+
+	*next_unload = entry->next_unload;
+	if (found != NULL) *found = entry->found;
+	return entry->link != INVALID_ROUTE_LINK ? RouteLink::Get(entry->link) : NULL;
+}
+
+
+/** A queued update of the next hops of the cargo waiting at a station. */
+struct NextHopJob {
+	StationID station; ///< Station the cargo waits at.
+	CargoID   cid;     ///< Cargo type to update.
+};
+
+/** A route search done by the routing workers. */
+struct RouteSearch {
+	StationID       station; ///< Station the route starts at.
+	CargoID         cid;     ///< Cargo type to route.
+	RouteTableKey   key;     ///< Destination, order and flags of the cargo.
+	TileArea        area;    ///< Destination area of the cargo.
+	RouteLinkID     link;    ///< Resulting route link.
+	RouteTableEntry result;  ///< Resulting routing decision and its inputs.
+
+	RouteSearch(StationID station, CargoID cid, const RouteTableKey &key, const TileArea &area) : station(station), cid(cid), key(key), area(area), link(INVALID_ROUTE_LINK)
+	{
+		this->result.link = INVALID_ROUTE_LINK;
+		this->result.next_unload = INVALID_STATION;
+		this->result.found = false;
+		this->result.epoch = 0;
+		this->result.memo = 0;
+	}
+
+	/** Compare two searches for finding duplicates. */
+	bool operator <(const RouteSearch &other) const
+	{
+		if (this->station != other.station) return this->station < other.station;
+		if (this->cid != other.cid) return this->cid < other.cid;
+		return this->key < other.key;
+	}
+};
+
+static const uint MAX_ROUTING_THREADS       = 8;  ///< Maximum number of threads doing route searches.
+static const uint MIN_SEARCHES_PER_THREAD   = 16; ///< Don't start a thread for less searches than this.
+
+static SmallVector<NextHopJob, 16> _next_hop_jobs; ///< Next hop updates queued this tick.
+static std::vector<RouteSearch> _route_searches;   ///< Route searches the queued jobs need.
+static std::set<RouteSearch> _route_search_set;    ///< Route searches already queued.
+static uint _route_search_next;                    ///< Next route search to hand to a worker.
+static ThreadMutex *_route_search_mutex = NULL;    ///< Mutex protecting #_route_search_next and the profiling counters.
+
+/** A thread helping the main thread with the route searches. */
+struct RouteSearchThread {
+	ThreadObject *thread; ///< The thread.
+	ThreadMutex *mutex;   ///< Mutex protecting #busy, signalled whenever it changes.
+	bool busy;            ///< Does the thread have to work on the searches? Cleared by the thread when it's done.
+};
+
+static RouteSearchThread _route_search_threads[MAX_ROUTING_THREADS - 1]; ///< The threads helping the main thread.
+static uint _route_search_num_threads = 0;                               ///< Number of threads started so far.
+
+/**
+ * Queue updating the next hops of the cargo waiting at a station.
+ * The update is done by #RunCargoRoutingJobs later in the same tick.
+ * @param st Station the cargo waits at.
+ * @param cid Cargo type to update.
+ */
+void QueueCargoNextHopUpdate(Station *st, CargoID cid)
+{
+	for (const NextHopJob *job = _next_hop_jobs.Begin(); job != _next_hop_jobs.End(); job++) {
+		if (job->station == st->index && job->cid == cid) return;
+	}
+
+	NextHopJob *job = _next_hop_jobs.Append();
+	job->station = st->index;
+	job->cid = cid;
+}
+
+/**
+ * Queue a route search for a cargo packet unless the route table of the
+ * station already has the answer or the same search is already queued.
+ * @param st Station the route starts at.
+ * @param cid Cargo type.
+ * @param cp Cargo packet with destination information.
+ */
+void QueueRouteSearch(Station *st, CargoID cid, const CargoPacket *cp)
+{
+	if (cp->DestinationID() == INVALID_SOURCE) return;
+
+	TileArea area = GetCargoDestinationArea(cp);
+	RouteSearch search(st->index, cid, RouteTableKey(area, INVALID_ORDER, cp->Flags()), area);
+
+	if (st->goods[cid].route_table.Find(search.key, cid) != NULL) return;
+	if (!_route_search_set.insert(search).second) return;
+
+	_route_searches.push_back(search);
+}
+
+/**
+ * Do a single route search. Only reads the game state.
+ * @param search The search to do.
+ */
+static void DoRouteSearch(RouteSearch &search)
+{
+	const Station *st = Station::Get(search.station);
+
 	StationList sl;
-	*sl.Append() = st;
+	*sl.Append() = const_cast<Station *>(st);
+
+	RouteLink *link = YapfChooseRouteLink(search.cid, &sl, st->xy, search.area, NULL, &search.result.next_unload, search.key.flags, &search.result.found, search.key.order, INT_MAX, &search.result);
+	if (link != NULL) search.link = link->index;
+}
+
+/** Do queued route searches until none are left. Called from several threads at once. */
+static void DoQueuedRouteSearches()
+{
+	for (;;) {
+		_route_search_mutex->BeginCritical();
+		uint i = _route_search_next++;
+		_route_search_mutex->EndCritical();
 
-	TileArea area = (cp->DestinationType() == ST_INDUSTRY) ? Industry::Get(cp->DestinationID())->location : TileArea(cp->DestinationXY(), 2, 2);
-	return YapfChooseRouteLink(cid, &sl, st->xy, area, NULL, next_unload, cp->Flags(), found, order);
+		if (i >= _route_searches.size()) return;
+		DoRouteSearch(_route_searches[i]);
+	}
+}
+
+/**
+ * Thread procedure of the routing threads. The threads live as long as
+ * the game and wait for work between the ticks.
+ * @param arg The RouteSearchThread of the thread.
+ */
+static void RouteSearchWorker(void *arg)
+{
+	RouteSearchThread *self = (RouteSearchThread *)arg;
+
+	self->mutex->BeginCritical();
+	for (;;) {
+		while (!self->busy) self->mutex->WaitForSignal();
+		self->mutex->EndCritical();
+
+		DoQueuedRouteSearches();
+
+		self->mutex->BeginCritical();
+		self->busy = false;
+		self->mutex->SendSignal();
+	}
+}
+
+/**
+ * Make sure the given number of routing threads is running.
+ * @param count Wanted number of threads.
+ * @return Number of threads available, less than wanted if starting one failed.
+ */
+static uint StartRouteSearchThreads(uint count)
+{
+	while (_route_search_num_threads < count) {
+		RouteSearchThread *t = &_route_search_threads[_route_search_num_threads];
+		if (t->mutex == NULL) t->mutex = ThreadMutex::New();
+		t->busy = false;
+		if (!ThreadObject::New(&RouteSearchWorker, t, &t->thread)) break;
+		_route_search_num_threads++;
+	}
+	return min(count, _route_search_num_threads);
+}
+
+/**
+ * Do all queued route searches, spread over several threads. The game
+ * state doesn't change until all searches are done, so the results don't
+ * depend on the number of threads or the order the searches finish in.
+ */
+static void DoRouteSearches()
+{
+	if (_route_search_mutex == NULL) _route_search_mutex = ThreadMutex::New();
+	_route_search_next = 0;
+
+	/* The pathfinder debug output isn't thread safe. */
+	uint num_threads = _debug_yapf_level >= 2 ? 1 : Clamp<uint>(GetCPUCoreCount(), 1, MAX_ROUTING_THREADS);
+	num_threads = min(num_threads, max<uint>(1, (uint)_route_searches.size() / MIN_SEARCHES_PER_THREAD));
+
+	/* This thread does its part of the work as well. */
+	uint num_workers = StartRouteSearchThreads(num_threads - 1);
+	for (uint i = 0; i < num_workers; i++) {
+		RouteSearchThread *t = &_route_search_threads[i];
+		t->mutex->BeginCritical();
+		t->busy = true;
+		t->mutex->SendSignal();
+		t->mutex->EndCritical();
+	}
+
+	DoQueuedRouteSearches();
+
+	for (uint i = 0; i < num_workers; i++) {
+		RouteSearchThread *t = &_route_search_threads[i];
+		t->mutex->BeginCritical();
+		while (t->busy) t->mutex->WaitForSignal();
+		t->mutex->EndCritical();
+	}
+}
+
+/**
+ * Run all queued next hop updates. Route searches not answered by the
+ * route tables are done in parallel first, their results are stored in
+ * the route tables in the order they were queued and the cargo is then
+ * updated from the route tables in the order the jobs were queued.
+ * This runs after the vehicle ticks that queue the jobs and before the
+ * station loading at the start of the next vehicle ticks.
+ */
+void RunCargoRoutingJobs()
+{
+	if (_next_hop_jobs.Length() == 0) return;
+
+	for (const NextHopJob *job = _next_hop_jobs.Begin(); job != _next_hop_jobs.End(); job++) {
+		if (!Station::IsValidID(job->station)) continue;
+		Station *st = Station::Get(job->station);
+		st->goods[job->cid].cargo.QueueNextHopSearches(st, job->cid);
+	}
+
+	if (!_route_searches.empty()) {
+		DoRouteSearches();
+
+		for (std::vector<RouteSearch>::const_iterator search = _route_searches.begin(); search != _route_searches.end(); ++search) {
+			RouteTableEntry *entry = Station::Get(search->station)->goods[search->cid].route_table.Insert(search->key);
+			entry->link = search->link;
+			entry->next_unload = search->result.next_unload;
+			entry->found = search->result.found;
+			for (const RouteTableDependency *dep = search->result.deps.Begin(); dep != search->result.deps.End(); dep++) {
+				*entry->deps.Append() = *dep;
+			}
+		}
+
+		_route_searches.clear();
+		_route_search_set.clear();
+	}
+
+	/* The searches are in the route tables now, so this normally doesn't search again. */
+	for (const NextHopJob *job = _next_hop_jobs.Begin(); job != _next_hop_jobs.End(); job++) {
+		if (!Station::IsValidID(job->station)) continue;
+		Station *st = Station::Get(job->station);
+		st->goods[job->cid].cargo.UpdateCargoNextHop(st, job->cid);
+	}
+
+	_next_hop_jobs.Clear();
 }
 
 
@@ -1017,6 +1742,7 @@ void UpdateVehicleRouteLinks(const Vehicle *v, uint32 cargoes, bool clear_others
 					delete *link;
 					from->goods[cid].routes.erase(link);
 				}
+				from->goods[cid].route_table.OnLinksChanged();
 				break;
 			}
 		}
@@ -1024,6 +1750,7 @@ void UpdateVehicleRouteLinks(const Vehicle *v, uint32 cargoes, bool clear_others
 		/* No link found? Append a new one. */
 		if (has_cargo && link == from->goods[cid].routes.end() && RouteLink::CanAllocateItem()) {
 			from->goods[cid].routes.push_back(new RouteLink(to_id, from_oid, to_oid, v->owner, travel_time, v->type));
+			from->goods[cid].route_table.OnLinksChanged();
 		}
 	}
 }
@@ -1054,6 +1781,7 @@ void UpdateVehicleRouteLinks(const Vehicle *v, StationID arrived_at)
 
 		for (RouteLinkList::iterator link = to->goods[cid].routes.begin(); link != to->goods[cid].routes.end(); ++link) {
 			if ((*link)->GetOriginOrderId() == v->current_order.index) {
+				if ((*link)->GetWaitTime() != 0) to->goods[cid].route_table.OnLinksChanged();
 				(*link)->VehicleArrived();
 				break;
 			}
@@ -1122,6 +1850,8 @@ void PrefillRouteLinks(const Vehicle *v)
  */
 void InvalidateStationRouteLinks(Station *station)
 {
+	InvalidateRouteTables();
+
 	/* Delete all outgoing links. */
 	for (CargoID cid = 0; cid < NUM_CARGO; cid++) {
 		for (RouteLinkList::iterator link = station->goods[cid].routes.begin(); link != station->goods[cid].routes.end(); ++link) {
@@ -1162,6 +1892,7 @@ void InvalidateOrderRouteLinks(OrderID order)
 				if ((*link)->GetOriginOrderId() == order || (*link)->GetDestOrderId() == order) {
 					delete *link;
 					link = st->goods[cid].routes.erase(link);
+					st->goods[cid].route_table.OnLinksChanged();
 				} else {
 					++link;
 				}
@@ -1184,6 +1915,9 @@ void AgeRouteLinks(Station *st)
 	}
 
 	for (CargoID cid = 0; cid < NUM_CARGO; cid++) {
+		/* All links get older, so all routing decisions based on them are outdated. */
+		if (!st->goods[cid].routes.empty()) st->goods[cid].route_table.OnLinksChanged();
+
 		/* Don't increment the iterator directly in the for loop as we don't want to increment when deleting a link. */
 		for (RouteLinkList::iterator link = st->goods[cid].routes.begin(); link != st->goods[cid].routes.end(); ) {
 			if ((*link)->wait_time++ > _settings_game.economy.cargodest.max_route_age) {
@@ -1195,3 +1929,81 @@ void AgeRouteLinks(Station *st)
 		}
 	}
 }
+
+
+static CargodestPerfStats _cargodest_perf[CDPE_END]; ///< Profiling counters of the cargo routing.
+
+/** Names of the instrumented parts of the cargo routing. */
+static const char * const _cargodest_perf_names[] = {
+	"route search",
+	"next hop update",
+	"cargo creation",
+	"demand links",
+};
+assert_compile(lengthof(_cargodest_perf_names) == CDPE_END);
+
+/**
+ * Record a measurement of an instrumented part of the cargo routing.
+ * May be called from the routing worker threads.
+ * @param elem The measured part.
+ * @param time CPU cycles spent.
+ * @param nodes_opened Pathfinder nodes opened.
+ * @param nodes_closed Pathfinder nodes closed.
+ * @param found False if a route search didn't find a route.
+ */
+void RecordCargodestPerf(CargodestPerfElement elem, uint64 time, int nodes_opened, int nodes_closed, bool found)
+{
+	/* The mutex exists before the first worker thread is started. */
+	if (_route_search_mutex != NULL) _route_search_mutex->BeginCritical();
+
+	CargodestPerfStats &stats = _cargodest_perf[elem];
+	stats.calls++;
+	if (!found) stats.not_found++;
+	stats.nodes_opened += nodes_opened;
+	stats.nodes_closed += nodes_closed;
+	stats.time += time;
+	stats.tick_time += time;
+
+	if (_route_search_mutex != NULL) _route_search_mutex->EndCritical();
+}
+
+/** Update the worst per-tick times of the cargo routing at the end of a tick. */
+void FinishCargodestPerfTick()
+{
+	if (_debug_cargodest_level == 0) return;
+
+	for (uint i = 0; i < CDPE_END; i++) {
+		CargodestPerfStats &stats = _cargodest_perf[i];
+		stats.max_tick_time = max(stats.max_tick_time, stats.tick_time);
+		if (stats.tick_time != 0) DEBUG(cargodest, 3, "[%s] " OTTD_PRINTF64 " cycles this tick", _cargodest_perf_names[i], stats.tick_time);
+		stats.tick_time = 0;
+	}
+}
+
+/** Clear all profiling counters of the cargo routing. */
+void ResetCargodestPerfStats()
+{
+	MemSetT(_cargodest_perf, 0, lengthof(_cargodest_perf));
+}
+
+/**
+ * Get the profiling counters of an instrumented part of the cargo routing.
+ * @param elem The part.
+ * @return The counters.
+ */
+const CargodestPerfStats &GetCargodestPerfStats(CargodestPerfElement elem)
+{
+	assert(elem < CDPE_END);
+	return _cargodest_perf[elem];
+}
+
+/**
+ * Get the name of an instrumented part of the cargo routing.
+ * @param elem The part.
+ * @return The name.
+ */
+const char *GetCargodestPerfName(CargodestPerfElement elem)
+{
+	assert(elem < CDPE_END);
+	return _cargodest_perf_names[elem];
+}
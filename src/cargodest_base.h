@@ -21,6 +21,8 @@
 #include "station_type.h"
 #include "company_type.h"
 #include "vehicle_type.h"
+#include "tilearea_type.h"
+#include <map>
 
 struct CargoSourceSink;
 
@@ -46,6 +48,8 @@ struct CargoSourceSink {
 	SmallVector<CargoLink, 8> cargo_links[NUM_CARGO];
 	/** Sum of the destination weights for each cargo type. */
 	uint cargo_links_weight[NUM_CARGO];
+	/** NOSAVE: Running sum of the link weights for each cargo type, used to pick a random link. */
+	SmallVector<uint, 8> cargo_links_cum_weight[NUM_CARGO];
 
 	/** NOSAVE: Desired link count for each cargo. */
 	uint16 num_links_expected[NUM_CARGO];
@@ -79,6 +83,17 @@ struct CargoSourceSink {
 	/** Get the link weight for this as a destination for a specific cargo. */
 	virtual uint GetDestinationWeight(CargoID cid, byte weight_mod) const = 0;
 
+	/**
+	 * Mark the running link weight sums of a cargo as outdated.
+	 * Must be called each time a link is added, removed or reweighted.
+	 * @param cid Cargo type whose links changed.
+	 */
+	inline void InvalidateLinkWeightIndex(CargoID cid)
+	{
+		this->cargo_links_cum_weight[cid].Clear();
+	}
+
+	void UpdateLinkWeightIndex(CargoID cid);
 	CargoLink *GetRandomLink(CargoID cid, bool allow_self);
 
 	/** Create the special cargo links for a cargo if not already present. */
@@ -166,6 +181,82 @@ public:
 };
 
 
+/** Key of a cached routing decision. */
+struct RouteTableKey {
+	TileIndex dest_tile; ///< North tile of the destination area.
+	uint16    dest_w;    ///< Width of the destination area.
+	uint16    dest_h;    ///< Height of the destination area.
+	OrderID   order;     ///< Order the cargo arrived with.
+	byte      flags;     ///< Routing flags of the cargo.
+
+	RouteTableKey(const TileArea &dest, OrderID order, byte flags) : dest_tile(dest.tile), dest_w(dest.w), dest_h(dest.h), order(order), flags(flags) {}
+
+	/** Compare two keys for sorting. */
+	bool operator <(const RouteTableKey &other) const
+	{
+		if (this->dest_tile != other.dest_tile) return this->dest_tile < other.dest_tile;
+		if (this->dest_w != other.dest_w) return this->dest_w < other.dest_w;
+		if (this->dest_h != other.dest_h) return this->dest_h < other.dest_h;
+		if (this->order != other.order) return this->order < other.order;
+		return this->flags < other.flags;
+	}
+};
+
+/** A routing input a cached routing decision depends on. */
+struct RouteTableDependency {
+	StationID station; ///< Station of the input or INVALID_STATION for the flags of an order.
+	OrderID   order;   ///< Next hop of the waiting cargo or INVALID_ORDER for the route link stamp of the station.
+	uint32    value;   ///< Value of the input at the time the decision was made.
+};
+
+/** A cached routing decision of a station for one destination. */
+struct RouteTableEntry {
+	RouteLinkID link;        ///< Preferred route link or #INVALID_ROUTE_LINK if the cargo should not be moved on.
+	StationID   next_unload; ///< Next station the cargo should be unloaded at.
+	bool        found;       ///< Was any route to the destination found?
+	uint32      epoch;       ///< Route table epoch the decision was made in.
+	uint32      memo;        ///< Memo generation the decision was last made or confirmed in.
+	SmallVector<RouteTableDependency, 16> deps; ///< Routing inputs the decision depends on.
+
+	void AddStation(const Station *st, CargoID cid);
+	bool IsValid(CargoID cid) const;
+};
+
+/**
+ * Cache of the routing decisions for one cargo type at a station.
+ * Each entry remembers every routing input the pathfinder looked at,
+ * so a cached decision is only used as long as a new search would
+ * come to the exact same result. Within a single tick, a decision is
+ * reused without looking at the waiting cargo again until the route
+ * links change, so identical packets share one answer.
+ */
+class RouteTable {
+	typedef std::map<RouteTableKey, RouteTableEntry> EntryMap;
+
+	EntryMap entries;   ///< The cached routing decisions.
+	uint32 links_stamp; ///< Changed each time the route links originating here change.
+
+public:
+	/** Maximum number of cached decisions per table. */
+	static const uint MAX_ENTRIES = 256;
+
+	RouteTable() : links_stamp(0) {}
+
+	/**
+	 * Get the current route link stamp.
+	 * @return The route link stamp.
+	 */
+	inline uint32 GetLinksStamp() const
+	{
+		return this->links_stamp;
+	}
+
+	void OnLinksChanged();
+	RouteTableEntry *Find(const RouteTableKey &key, CargoID cid);
+	RouteTableEntry *Insert(const RouteTableKey &key);
+};
+
+
 /**
  * Iterate over all valid route links from a given start.
  * @param var   The variable to use as the "iterator".
@@ -17,6 +17,9 @@
 #include "vehicle_type.h"
 #include "station_type.h"
 #include "order_type.h"
+#include "town_type.h"
+#include "industry_type.h"
+#include "debug.h"
 
 bool CargoHasDestinations(CargoID cid);
 
@@ -28,8 +31,67 @@ void PrefillRouteLinks(const Vehicle *v);
 void InvalidateStationRouteLinks(Station *station);
 void InvalidateOrderRouteLinks(OrderID order);
 void AgeRouteLinks(Station *st);
+void InvalidateRouteTables();
+void ResetRouteTableMemo();
+void QueueCargoNextHopUpdate(Station *st, CargoID cid);
+void QueueRouteSearch(Station *st, CargoID cid, const struct CargoPacket *cp);
+void RunCargoRoutingJobs();
+
+void RecordCargodestPerf(CargodestPerfElement elem, uint64 time, int nodes_opened, int nodes_closed, bool found);
+void FinishCargodestPerfTick();
+void ResetCargodestPerfStats();
+const CargodestPerfStats &GetCargodestPerfStats(CargodestPerfElement elem);
+const char *GetCargodestPerfName(CargodestPerfElement elem);
 
 void RebuildCargoLinkCounts();
+void AddToNearbyIndex(const Town *t);
+void AddToNearbyIndex(const Industry *ind);
+void RemoveFromNearbyIndex(const Town *t);
+void RemoveFromNearbyIndex(const Industry *ind);
+void RebuildNearbyIndex();
 void UpdateCargoLinks();
 
+/**
+ * Measures an instrumented part of the cargo routing while it is in scope.
+ * Does nothing unless the cargodest debug level is at least 1.
+ */
+class CargodestPerfTimer {
+	CargodestPerfElement elem; ///< The measured part.
+	uint64 start;              ///< Cycle count at construction or 0 if disabled.
+	int nodes_opened;          ///< Pathfinder nodes opened.
+	int nodes_closed;          ///< Pathfinder nodes closed.
+	bool found;                ///< Did the measured search find a route?
+
+public:
+	/**
+	 * Start measuring.
+	 * @param elem The measured part.
+	 */
+	CargodestPerfTimer(CargodestPerfElement elem) : elem(elem), start(0), nodes_opened(0), nodes_closed(0), found(true)
+	{
+#ifndef NO_DEBUG_MESSAGES
+		if (_debug_cargodest_level > 0) this->start = ottd_rdtsc();
+#endif /* NO_DEBUG_MESSAGES */
+	}
+
+	/** Stop measuring and record the result. */
+	~CargodestPerfTimer()
+	{
+		if (this->start != 0) RecordCargodestPerf(this->elem, ottd_rdtsc() - this->start, this->nodes_opened, this->nodes_closed, this->found);
+	}
+
+	/**
+	 * Set the outcome of a measured route search.
+	 * @param nodes_opened Pathfinder nodes opened.
+	 * @param nodes_closed Pathfinder nodes closed.
+	 * @param found Was a route found?
+	 */
+	inline void SetSearchResult(int nodes_opened, int nodes_closed, bool found)
+	{
+		this->nodes_opened = nodes_opened;
+		this->nodes_closed = nodes_closed;
+		this->found = found;
+	}
+};
+
 #endif /* CARGODEST_FUNC_H */
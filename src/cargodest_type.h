@@ -28,4 +28,26 @@ enum RoutingFlags {
 typedef uint32 RouteLinkID;
 struct RouteLink;
 
+static const RouteLinkID INVALID_ROUTE_LINK = UINT32_MAX; ///< Sentinel for an invalid route link.
+
+/** Instrumented parts of the cargo routing. */
+enum CargodestPerfElement {
+	CDPE_CHOOSE_ROUTE_LINK, ///< Route searches by YapfChooseRouteLink.
+	CDPE_UPDATE_NEXT_HOP,   ///< Next hop updates of the cargo waiting at a station.
+	CDPE_MOVE_TO_STATION,   ///< Routing of newly created cargo by MoveCargoWithDestinationToStation.
+	CDPE_UPDATE_LINKS,      ///< Demand link updates by UpdateCargoLinks and its daily slices.
+	CDPE_END,
+};
+
+/** Profiling counters of one instrumented part of the cargo routing. */
+struct CargodestPerfStats {
+	uint64 calls;         ///< Number of calls.
+	uint64 not_found;     ///< Number of route searches that didn't find a route.
+	uint64 nodes_opened;  ///< Number of pathfinder nodes opened.
+	uint64 nodes_closed;  ///< Number of pathfinder nodes closed.
+	uint64 time;          ///< Accumulated CPU cycles.
+	uint64 tick_time;     ///< CPU cycles spent in the current tick.
+	uint64 max_tick_time; ///< Most CPU cycles spent in a single tick.
+};
+
 #endif /* CARGODEST_TYPE_H */
@@ -180,8 +180,8 @@ inline void CargoPacket::Merge(CargoPacket *cp)
 /**
  * Destroy the cargolist ("frees" all cargo packets).
  */
-template <class Tinst>
-CargoList<Tinst>::~CargoList()
+template <class Tinst, class Tcont>
+CargoList<Tinst, Tcont>::~CargoList()
 {
 	for (Iterator it(this->packets.begin()); it != this->packets.end(); ++it) {
 		delete *it;
@@ -192,8 +192,8 @@ CargoList<Tinst>::~CargoList()
  * Empty the cargo list, but don't free the cargo packets;
  * the cargo packets are cleaned by CargoPacket's CleanPool.
  */
-template <class Tinst>
-void CargoList<Tinst>::OnCleanPool()
+template <class Tinst, class Tcont>
+void CargoList<Tinst, Tcont>::OnCleanPool()
 {
 	this->packets.clear();
 }
@@ -203,8 +203,8 @@ void CargoList<Tinst>::OnCleanPool()
  * Decreases count and days_in_transit.
  * @param cp Packet to be removed from cache.
  */
-template <class Tinst>
-void CargoList<Tinst>::RemoveFromCache(const CargoPacket *cp)
+template <class Tinst, class Tcont>
+void CargoList<Tinst, Tcont>::RemoveFromCache(const CargoPacket *cp)
 {
 	this->count                 -= cp->count;
 	this->cargo_days_in_transit -= cp->days_in_transit * cp->count;
@@ -215,46 +215,20 @@ void CargoList<Tinst>::RemoveFromCache(const CargoPacket *cp)
  * Increases count and days_in_transit.
  * @param cp New packet to be inserted.
  */
-template <class Tinst>
-void CargoList<Tinst>::AddToCache(const CargoPacket *cp)
+template <class Tinst, class Tcont>
+void CargoList<Tinst, Tcont>::AddToCache(const CargoPacket *cp)
 {
 	this->count                 += cp->count;
 	this->cargo_days_in_transit += cp->days_in_transit * cp->count;
 }
 
-/**
- * Appends the given cargo packet. Tries to merge it with another one in the
- * packets list. If no fitting packet is found, appends it.
- * @warning After appending this packet may not exist anymore!
- * @note Do not use the cargo packet anymore after it has been appended to this CargoList!
- * @param cp Cargo packet to add.
- * @pre cp != NULL
- */
-template <class Tinst>
-void CargoList<Tinst>::Append(CargoPacket *cp)
-{
-	assert(cp != NULL);
-	static_cast<Tinst *>(this)->AddToCache(cp);
-
-	for (List::reverse_iterator it(this->packets.rbegin()); it != this->packets.rend(); it++) {
-		CargoPacket *icp = *it;
-		if (Tinst::AreMergable(icp, cp) && icp->count + cp->count <= CargoPacket::MAX_COUNT) {
-			icp->Merge(cp);
-			return;
-		}
-	}
-
-	/* The packet could not be merged with another one */
-	this->packets.push_back(cp);
-}
-
 /**
  * Truncates the cargo in this list to the given amount. It leaves the
  * first count cargo entities and removes the rest.
  * @param max_remaining Maximum amount of entities to be in the list after the command.
  */
-template <class Tinst>
-void CargoList<Tinst>::Truncate(uint max_remaining)
+template <class Tinst, class Tcont>
+void CargoList<Tinst, Tcont>::Truncate(uint max_remaining)
 {
 	for (Iterator it(packets.begin()); it != packets.end(); /* done during loop*/) {
 		CargoPacket *cp = *it;
@@ -302,9 +276,9 @@ void CargoList<Tinst>::Truncate(uint max_remaining)
  * @pre st != INVALID_STATION || (mta != MTA_CARGO_LOAD && payment == NULL)
  * @return True if there are still packets that might be moved from this cargo list.
  */
-template <class Tinst>
+template <class Tinst, class Tcont>
 template <class Tother_inst>
-bool CargoList<Tinst>::MoveTo(Tother_inst *dest, uint max_move, MoveToAction mta, CargoPayment *payment, StationID st, OrderID cur_order, CargoID cid, bool *did_transfer)
+bool CargoList<Tinst, Tcont>::MoveTo(Tother_inst *dest, uint max_move, MoveToAction mta, CargoPayment *payment, StationID st, OrderID cur_order, CargoID cid, bool *did_transfer)
 {
 	assert(mta == MTA_FINAL_DELIVERY || dest != NULL);
 	assert(mta == MTA_UNLOAD || mta == MTA_CARGO_LOAD || payment != NULL);
@@ -457,13 +431,13 @@ restart:;
 }
 
 /** Invalidates the cached data and rebuilds it. */
-template <class Tinst>
-void CargoList<Tinst>::InvalidateCache()
+template <class Tinst, class Tcont>
+void CargoList<Tinst, Tcont>::InvalidateCache()
 {
 	this->count = 0;
 	this->cargo_days_in_transit = 0;
 
-	for (ConstIterator it(this->packets.begin()); it != this->packets.end(); it++) {
+	for (ConstIterator it(this->packets.begin()); it != this->packets.end(); ++it) {
 		static_cast<Tinst *>(this)->AddToCache(*it);
 	}
 }
@@ -490,6 +464,31 @@ void VehicleCargoList::AddToCache(const CargoPacket *cp)
 	this->Parent::AddToCache(cp);
 }
 
+/**
+ * Appends the given cargo packet. Tries to merge it with another one in the
+ * packets list. If no fitting packet is found, appends it.
+ * @warning After appending this packet may not exist anymore!
+ * @note Do not use the cargo packet anymore after it has been appended to this CargoList!
+ * @param cp Cargo packet to add.
+ * @pre cp != NULL
+ */
+void VehicleCargoList::Append(CargoPacket *cp)
+{
+	assert(cp != NULL);
+	this->AddToCache(cp);
+
+	for (List::reverse_iterator it(this->packets.rbegin()); it != this->packets.rend(); it++) {
+		CargoPacket *icp = *it;
+		if (VehicleCargoList::AreMergable(icp, cp) && icp->count + cp->count <= CargoPacket::MAX_COUNT) {
+			icp->Merge(cp);
+			return;
+		}
+	}
+
+	/* The packet could not be merged with another one */
+	this->packets.push_back(cp);
+}
+
 /**
  * Ages the all cargo in this list.
  */
@@ -520,6 +519,203 @@ void VehicleCargoList::InvalidateNextStation()
 	}
 }
 
+/**
+ * Find the first place that isn't before a given one.
+ * @param position The place to look for.
+ * @return Index of the place counted from the first one, or #Length if all places are before it.
+ */
+uint StationCargoPacketMap::PositionVector::LowerBound(uint32 position) const
+{
+	return (uint)(std::lower_bound(this->items.begin() + this->first, this->items.end(), position) - this->items.begin()) - this->first;
+}
+
+/**
+ * Add a place.
+ * @param position The place; it must not be in the vector yet.
+ */
+void StationCargoPacketMap::PositionVector::Insert(uint32 position)
+{
+	uint index = this->first + this->LowerBound(position);
+	if (index == this->items.size()) {
+		this->items.push_back(position);
+	} else if (this->first > 0 && index - this->first < this->items.size() - index) {
+		/* Closer to the front and there is room left there. */
+		this->first--;
+		std::copy(this->items.begin() + this->first + 1, this->items.begin() + index, this->items.begin() + this->first);
+		this->items[index - 1] = position;
+	} else {
+		this->items.insert(this->items.begin() + index, position);
+	}
+}
+
+/**
+ * Remove a place.
+ * @param position The place; it must be in the vector.
+ */
+void StationCargoPacketMap::PositionVector::Erase(uint32 position)
+{
+	uint index = this->first + this->LowerBound(position);
+	assert(index < this->items.size() && this->items[index] == position);
+	if (index - this->first < this->items.size() - index) {
+		std::copy_backward(this->items.begin() + this->first, this->items.begin() + index, this->items.begin() + index + 1);
+		this->first++;
+	} else {
+		this->items.erase(this->items.begin() + index);
+	}
+
+	/* Drop the unused front once it is the larger part. */
+	if (this->first * 2 > this->items.size()) {
+		this->items.erase(this->items.begin(), this->items.begin() + this->first);
+		this->first = 0;
+	}
+}
+
+/**
+ * Get the index a packet belongs in.
+ * @param cp The packet.
+ * @return The index.
+ */
+StationCargoPacketMap::PositionVector &StationCargoPacketMap::GetIndex(const CargoPacket *cp)
+{
+	if (cp->NextHop() == INVALID_ORDER && cp->DestinationID() != INVALID_SOURCE) return this->unrouted;
+	return this->buckets[cp->NextHop()];
+}
+
+/**
+ * Find the index a packet belongs in.
+ * @param cp The packet.
+ * @return The index, or NULL if there are no packets for its next hop.
+ */
+const StationCargoPacketMap::PositionVector *StationCargoPacketMap::FindIndex(const CargoPacket *cp) const
+{
+	if (cp->NextHop() == INVALID_ORDER && cp->DestinationID() != INVALID_SOURCE) return &this->unrouted;
+	BucketMap::const_iterator bucket = this->buckets.find(cp->NextHop());
+	return bucket != this->buckets.end() ? &bucket->second : NULL;
+}
+
+/**
+ * Add a packet to the index of its next hop.
+ * @param it Iterator pointing to the packet.
+ */
+void StationCargoPacketMap::Link(iterator it)
+{
+	this->GetIndex(*it).Insert(it.GetPosition());
+}
+
+/**
+ * Remove a packet from the index of its next hop. Has to be called before
+ * the next hop or the destination of the packet are changed; call #Link
+ * afterwards to index it again.
+ * @param it Iterator pointing to the packet.
+ */
+void StationCargoPacketMap::Unlink(iterator it)
+{
+	const CargoPacket *cp = *it;
+	if (cp->NextHop() == INVALID_ORDER && cp->DestinationID() != INVALID_SOURCE) {
+		this->unrouted.Erase(it.GetPosition());
+		return;
+	}
+
+	BucketMap::iterator bucket = this->buckets.find(cp->NextHop());
+	assert(bucket != this->buckets.end());
+	bucket->second.Erase(it.GetPosition());
+	if (bucket->second.Length() == 0) this->buckets.erase(bucket);
+}
+
+/**
+ * Remove a packet, without freeing it.
+ * @param it Iterator pointing to the packet.
+ * @return Iterator pointing to the next packet.
+ */
+StationCargoPacketMap::iterator StationCargoPacketMap::erase(iterator it)
+{
+	this->Unlink(it);
+	uint32 position = it.GetPosition();
+	this->packets[position] = NULL;
+	this->gaps++;
+
+	++it;
+	if (position == this->first) this->first = it.GetPosition();
+	return it;
+}
+
+/**
+ * Add a packet after all other packets.
+ * @param cp Packet to add.
+ */
+void StationCargoPacketMap::push_back(CargoPacket *cp)
+{
+	/* Close the gaps of removed packets once they take more room than the packets. */
+	if (this->gaps > 64 && this->gaps > this->size()) this->Rebuild();
+
+	this->packets.push_back(cp);
+	this->Link(iterator(&this->packets, (uint32)this->packets.size() - 1));
+}
+
+/**
+ * Find the first packet at or after a place in the arrival order that is
+ * either for a next hop or still needs a next hop.
+ * @param order The next hop.
+ * @param position The place to start looking at.
+ * @return Iterator pointing to the packet, or #end if there is none.
+ */
+StationCargoPacketMap::iterator StationCargoPacketMap::FindNext(OrderID order, uint32 position) const
+{
+	uint32 next = (uint32)this->packets.size();
+
+	BucketMap::const_iterator bucket = this->buckets.find(order);
+	if (bucket != this->buckets.end()) {
+		uint index = bucket->second.LowerBound(position);
+		if (index < bucket->second.Length()) next = bucket->second[index];
+	}
+
+	uint index = this->unrouted.LowerBound(position);
+	if (index < this->unrouted.Length()) next = min(next, this->unrouted[index]);
+
+	return iterator(&this->packets, next);
+}
+
+/**
+ * Number the packets from the start, closing the gaps of removed packets,
+ * and index them again. Has to be called after the next hop or the
+ * destination of packets has been changed without #Unlink and #Link.
+ */
+void StationCargoPacketMap::Rebuild()
+{
+	PacketVector old;
+	old.swap(this->packets);
+	this->clear();
+
+	this->packets.reserve(old.size());
+	for (PacketVector::const_iterator it = old.begin(); it != old.end(); ++it) {
+		if (*it != NULL) this->push_back(*it);
+	}
+}
+
+/**
+ * Replace the packets by packets that are not indexed. Used for loading
+ * games, as the loaded packets can't be indexed before their references
+ * are resolved.
+ * @param list The packets in arrival order.
+ */
+void StationCargoPacketMap::StoreUnresolved(const std::list<CargoPacket *> &list)
+{
+	this->clear();
+	this->packets.assign(list.begin(), list.end());
+}
+
+/**
+ * Take all packets out of the container.
+ * @param list List to append the packets to, in arrival order.
+ */
+void StationCargoPacketMap::TakeUnresolved(std::list<CargoPacket *> *list)
+{
+	for (PacketVector::const_iterator it = this->packets.begin(); it != this->packets.end(); ++it) {
+		if (*it != NULL) list->push_back(*it);
+	}
+	this->clear();
+}
+
 /**
  * Update the local next-hop count cache.
  * @param cp Packet the be removed.
@@ -553,38 +749,95 @@ void StationCargoList::AddToCache(const CargoPacket *cp)
 	this->Parent::AddToCache(cp);
 }
 
-/** Invalidates the cached data and rebuild it. */
+/**
+ * Invalidates the cached data and rebuild it. The entries of the next hop
+ * counts are reused, so the cache compares equal to a valid one.
+ */
 void StationCargoList::InvalidateCache()
 {
-	this->order_cache.clear();
+	for (OrderMap::iterator it = this->order_cache.begin(); it != this->order_cache.end(); ++it) {
+		it->second = 0;
+	}
 	this->Parent::InvalidateCache();
+	for (OrderMap::iterator it = this->order_cache.begin(); it != this->order_cache.end();) {
+		if (it->second == 0) {
+			this->order_cache.erase(it++);
+		} else {
+			++it;
+		}
+	}
+}
+
+/**
+ * Appends the given cargo packet. Tries to merge it with another one in the
+ * packets list. If no fitting packet is found, appends it. Only packets with
+ * the same next hop can be merged, so only those are looked at.
+ * @warning After appending this packet may not exist anymore!
+ * @note Do not use the cargo packet anymore after it has been appended to this CargoList!
+ * @param cp Cargo packet to add.
+ * @pre cp != NULL
+ */
+void StationCargoList::Append(CargoPacket *cp)
+{
+	assert(cp != NULL);
+	this->AddToCache(cp);
+
+	const StationCargoPacketMap::PositionVector *index = this->packets.FindIndex(cp);
+	if (index != NULL) {
+		for (uint i = index->Length(); i > 0; i--) {
+			CargoPacket *icp = this->packets.Get((*index)[i - 1]);
+			if (StationCargoList::AreMergable(icp, cp) && icp->count + cp->count <= CargoPacket::MAX_COUNT) {
+				icp->Merge(cp);
+				return;
+			}
+		}
+	}
+
+	/* The packet could not be merged with another one */
+	this->packets.push_back(cp);
+}
+
+/**
+ * Change the next hop of a packet. The packet keeps its place in the list.
+ * @param it Iterator pointing to the packet.
+ * @param next_order New next hop.
+ * @param next_station New next unload station.
+ */
+void StationCargoList::SetNextHop(Iterator it, OrderID next_order, StationID next_station)
+{
+	CargoPacket *cp = *it;
+	this->RemoveFromCache(cp);
+	this->packets.Unlink(it);
+	cp->next_station = next_station;
+	cp->next_order = next_order;
+	this->packets.Link(it);
+	this->AddToCache(cp);
 }
 
 /**
  * Recompute the desired next hop of a cargo packet.
- * @param cp  Cargo packet to update.
+ * @param it  Iterator pointing to the cargo packet to update.
  * @param st  Station of  this list.
  * @param cid Cargo type of this list.
  * @return False if the packet was deleted, true otherwise.
  */
-bool StationCargoList::UpdateCargoNextHop(CargoPacket *cp, Station *st, CargoID cid)
+bool StationCargoList::UpdateNextHop(Iterator it, Station *st, CargoID cid)
 {
+	CargoPacket *cp = *it;
+
 	StationID next_unload;
 	RouteLink *l = FindRouteLinkForCargo(st, cid, cp, &next_unload);
 
 	if (l == NULL) {
 		/* No link to destination, drop packet. */
 		this->RemoveFromCache(cp);
+		this->packets.erase(it);
 		delete cp;
 		return false;
 	}
 
 	/* Update next hop info. */
-	this->RemoveFromCache(cp);
-	cp->next_station = next_unload;
-	cp->next_order = l->GetOriginOrderId();
-	this->AddToCache(cp);
-
+	this->SetNextHop(it, l->GetOriginOrderId(), next_unload);
 	return true;
 }
 
@@ -595,19 +848,15 @@ bool StationCargoList::UpdateCargoNextHop(CargoPacket *cp, Station *st, CargoID
  */
 void StationCargoList::UpdateCargoNextHop(Station *st, CargoID cid)
 {
+	CargodestPerfTimer perf(CDPE_UPDATE_NEXT_HOP);
+
 	uint count = 0;
 	StationCargoList::Iterator iter;
 	for (iter = this->packets.begin(); count < this->next_start + _settings_game.economy.cargodest.route_recalc_chunk && iter != this->packets.end(); count++) {
 		if (count < this->next_start) continue;
-		if ((*iter)->DestinationID() != INVALID_SOURCE) {
-			if (this->UpdateCargoNextHop(*iter, st, cid)) {
-				++iter;
-			} else {
-				iter = this->packets.erase(iter);
-			}
-		} else {
-			++iter;
-		}
+		Iterator cur = iter++;
+		if ((*cur)->DestinationID() == INVALID_SOURCE) continue;
+		this->UpdateNextHop(cur, st, cid);
 	}
 
 	/* Update start counter for next loop. */
@@ -615,6 +864,109 @@ void StationCargoList::UpdateCargoNextHop(Station *st, CargoID cid)
 	if (this->next_start >= this->packets.size()) this->next_start = 0;
 }
 
+/**
+ * Queue the route searches the next call to UpdateCargoNextHop will need.
+ * @param st  Station of this list.
+ * @param cid Cargo type of this list.
+ */
+void StationCargoList::QueueNextHopSearches(Station *st, CargoID cid) const
+{
+	uint count = 0;
+	StationCargoList::ConstIterator iter;
+	for (iter = this->packets.begin(); count < this->next_start + _settings_game.economy.cargodest.route_recalc_chunk && iter != this->packets.end(); count++) {
+		if (count < this->next_start) continue;
+		QueueRouteSearch(st, cid, *iter);
+		++iter;
+	}
+}
+
+/**
+ * Load the packets for a next hop onto a vehicle, in the order they arrived.
+ * Packets that still need a next hop are routed on the way, and loaded if
+ * their new next hop is the one being loaded.
+ * @param dest Cargo list of the vehicle.
+ * @param max_move Amount of cargo entities to move.
+ * @param order Next hop to load the packets of.
+ * @param st Station where we are loading.
+ * @param cid Cargo type of this list.
+ * @return Amount of cargo entities that is still to be moved.
+ */
+uint StationCargoList::LoadPackets(VehicleCargoList *dest, uint max_move, OrderID order, Station *st, CargoID cid)
+{
+	for (Iterator it = this->packets.FindNext(order, 0); max_move > 0 && it != this->packets.end();) {
+		CargoPacket *cp = *it;
+		uint32 next = it.GetPosition() + 1;
+
+		/* Invalid next hop but valid destination? Recompute next hop. */
+		if (cp->NextHop() == INVALID_ORDER && cp->DestinationID() != INVALID_SOURCE) {
+			/* Failed to find destination? Then the packet was dropped. */
+			if (!this->UpdateNextHop(it, st, cid)) {
+				it = this->packets.FindNext(order, next);
+				continue;
+			}
+		}
+
+		/* Not for the current vehicle? Skip. */
+		if (cp->NextHop() != order) {
+			it = this->packets.FindNext(order, next);
+			continue;
+		}
+
+		if (cp->count <= max_move) {
+			/* Can move the complete packet */
+			max_move -= cp->count;
+			this->RemoveFromCache(cp);
+			this->packets.erase(it);
+			cp->loaded_at_xy = st->xy;
+			dest->Append(cp);
+			it = this->packets.FindNext(order, next);
+			continue;
+		}
+
+		/* Can move only part of the packet, so split it. */
+		CargoPacket *cp_new = cp->Split(max_move);
+
+		/* We could not allocate a CargoPacket? Is the map that full? */
+		if (cp_new == NULL) return 0;
+
+		this->RemoveFromCache(cp_new); // this reflects the changes in cp.
+		cp_new->loaded_at_xy = st->xy;
+		dest->Append(cp_new);
+		max_move = 0;
+	}
+
+	return max_move;
+}
+
+/**
+ * Load cargo from this station onto a vehicle. Only the packets waiting
+ * for the order of the vehicle, the packets that still need a next hop
+ * and the packets without destination are looked at, in that order.
+ * @param dest  Cargo list of the vehicle.
+ * @param max_move Amount of cargo entities to move.
+ * @param mta   How to handle the moving, has to be MTA_CARGO_LOAD.
+ * @param payment The payment helper, has to be NULL.
+ * @param st    Station ID where we are loading.
+ * @param cur_order The current order of the loading vehicle.
+ * @param cid   Cargo type of this list.
+ * @param did_transfer Unused.
+ * @return True if there are still packets that might be moved from this cargo list.
+ */
+bool StationCargoList::MoveTo(VehicleCargoList *dest, uint max_move, MoveToAction mta, CargoPayment *payment, StationID st, OrderID cur_order, CargoID cid, bool *did_transfer)
+{
+	assert(mta == MTA_CARGO_LOAD && payment == NULL && st != INVALID_STATION);
+
+	Station *station = Station::Get(st);
+	max_move = this->LoadPackets(dest, max_move, cur_order, station, cid);
+
+	if (max_move > 0 && cur_order != INVALID_ORDER && this->CountForNextHop(INVALID_ORDER) > 0) {
+		/* We loaded all packets for the next hop, now load all packets without destination. */
+		max_move = this->LoadPackets(dest, max_move, INVALID_ORDER, station, cid);
+	}
+
+	return max_move == 0 && !this->Empty();
+}
+
 /**
  * Invalidates the next hop info of all cargo packets with a given next order or unload station.
  * @param order Next order to invalidate.
@@ -625,15 +977,13 @@ void StationCargoList::UpdateCargoNextHop(Station *st, CargoID cid)
 	Station *st;
 	FOR_ALL_STATIONS(st) {
 		for (CargoID cid = 0; cid < NUM_CARGO; cid++) {
-			for (StationCargoList::Iterator it = st->goods[cid].cargo.packets.begin(); it != st->goods[cid].cargo.packets.end(); ++it) {
+			StationCargoList &list = st->goods[cid].cargo;
+			for (StationCargoList::Iterator it = list.packets.begin(); it != list.packets.end(); ++it) {
 				CargoPacket *cp = *it;
 				if (cp->next_order == order || cp->next_station == st_unload) {
 					/* Invalidate both order and unload station as both likely
 					 * don't make sense anymore. */
-					st->goods[cid].cargo.RemoveFromCache(cp);
-					cp->next_order = INVALID_ORDER;
-					cp->next_station = INVALID_STATION;
-					st->goods[cid].cargo.AddToCache(cp);
+					list.SetNextHop(it, INVALID_ORDER, INVALID_STATION);
 				}
 			}
 		}
@@ -641,23 +991,32 @@ void StationCargoList::UpdateCargoNextHop(Station *st, CargoID cid)
 }
 
 /**
- * Invalidates the next hop info of all cargo packets for a given destination.
- * @param order Next order to invalidate.
+ * Invalidates the next hop info and the destination of all cargo packets
+ * for a given destination.
+ * @param type Type of the destination.
+ * @param dest Index of the destination.
  */
 /* static */ void StationCargoList::InvalidateAllTo(SourceType type, SourceID dest)
 {
 	Station *st;
 	FOR_ALL_STATIONS(st) {
 		for (CargoID cid = 0; cid < NUM_CARGO; cid++) {
-			for (StationCargoList::Iterator it = st->goods[cid].cargo.packets.begin(); it != st->goods[cid].cargo.packets.end(); ++it) {
+			StationCargoList &list = st->goods[cid].cargo;
+			for (StationCargoList::Iterator it = list.packets.begin(); it != list.packets.end(); ++it) {
 				CargoPacket *cp = *it;
 				if (cp->dest_id == dest && cp->dest_type == type) {
 					/* Invalidate both next order and unload station as we
-					 * want the packets to be not routed anymore. */
-					st->goods[cid].cargo.RemoveFromCache(cp);
+					 * want the packets to be not routed anymore. The
+					 * destination goes too, so the packet is indexed as
+					 * one without destination. */
+					list.RemoveFromCache(cp);
+					list.packets.Unlink(it);
 					cp->next_order = INVALID_ORDER;
 					cp->next_station = INVALID_STATION;
-					st->goods[cid].cargo.AddToCache(cp);
+					cp->dest_id = INVALID_SOURCE;
+					cp->dest_xy = INVALID_TILE;
+					list.packets.Link(it);
+					list.AddToCache(cp);
 				}
 			}
 		}
@@ -667,12 +1026,10 @@ void StationCargoList::UpdateCargoNextHop(Station *st, CargoID cid)
 /*
  * We have to instantiate everything we want to be usable.
  */
-template class CargoList<VehicleCargoList>;
-template class CargoList<StationCargoList>;
+template class CargoList<VehicleCargoList, CargoPacketList>;
+template class CargoList<StationCargoList, StationCargoPacketMap>;
 
 /** Autoreplace Vehicle -> Vehicle 'transfer'. */
-template bool CargoList<VehicleCargoList>::MoveTo(VehicleCargoList *, uint max_move, MoveToAction mta, CargoPayment *payment, StationID st, OrderID cur_order, CargoID cid, bool *did_transfer);
+template bool CargoList<VehicleCargoList, CargoPacketList>::MoveTo(VehicleCargoList *, uint max_move, MoveToAction mta, CargoPayment *payment, StationID st, OrderID cur_order, CargoID cid, bool *did_transfer);
 /** Cargo unloading at a station. */
-template bool CargoList<VehicleCargoList>::MoveTo(StationCargoList *, uint max_move, MoveToAction mta, CargoPayment *payment, StationID st, OrderID cur_order, CargoID cid, bool *did_transfer);
-/** Cargo loading at a station. */
-template bool CargoList<StationCargoList>::MoveTo(VehicleCargoList *, uint max_move, MoveToAction mta, CargoPayment *payment, StationID st, OrderID cur_order, CargoID cid, bool *did_transfer);
+template bool CargoList<VehicleCargoList, CargoPacketList>::MoveTo(StationCargoList *, uint max_move, MoveToAction mta, CargoPayment *payment, StationID st, OrderID cur_order, CargoID cid, bool *did_transfer);
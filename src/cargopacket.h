@@ -21,6 +21,7 @@
 #include "cargotype.h"
 #include <list>
 #include <map>
+#include <vector>
 
 /** Unique identifier for a single cargo packet. */
 typedef uint32 CargoPacketID;
@@ -31,7 +32,7 @@ typedef Pool<CargoPacket, CargoPacketID, 1024, 0xFFF000, PT_NORMAL, true, false>
 /** The actual pool with cargo packets. */
 extern CargoPacketPool _cargopacket_pool;
 
-template <class Tinst> class CargoList;
+template <class Tinst, class Tcont> class CargoList;
 extern const struct SaveLoad *GetCargoPacketDesc();
 
 /**
@@ -55,7 +56,7 @@ private:
 	StationID next_station;     ///< Unload at this station next.
 
 	/** The CargoList caches, thus needs to know about it. */
-	template <class Tinst> friend class CargoList;
+	template <class Tinst, class Tcont> friend class CargoList;
 	friend class VehicleCargoList;
 	friend class StationCargoList;
 	/** We want this to be saved, right? */
@@ -222,19 +223,213 @@ public:
  */
 #define FOR_ALL_CARGOPACKETS(var) FOR_ALL_CARGOPACKETS_FROM(var, 0)
 
+/** Container with the cargo packets of a vehicle. */
+typedef std::list<CargoPacket *> CargoPacketList;
+
+/**
+ * Container with the cargo packets of a station. The packets are kept in
+ * the order they arrived at the station. Every packet is also indexed by
+ * its next hop, so loading a vehicle only has to look at the packets for
+ * its order and at the packets that still need a next hop. A packet keeps
+ * its place in the arrival order when its next hop changes, so the packets
+ * of each next hop are always in FIFO order.
+ *
+ * All storage is contiguous: the packets are in one vector indexed by their
+ * place in the arrival order, and each next hop has a sorted vector of the
+ * places of its packets. Removed packets leave a gap in the packet vector
+ * until they take more room than the packets, then all are closed at once.
+ */
+class StationCargoPacketMap {
+public:
+	/** Packets by their place in the arrival order; NULL for removed packets. */
+	typedef std::vector<CargoPacket *> PacketVector;
+
+	/**
+	 * Sorted places of the packets of one next hop. Places are removed by
+	 * moving the shorter side of the vector, so taking packets from the
+	 * front is as cheap as adding them to the back.
+	 */
+	class PositionVector {
+		std::vector<uint32> items; ///< The places; the ones before #first are unused.
+		uint first;                ///< Index of the first used place.
+
+	public:
+		PositionVector() : first(0) {}
+
+		/**
+		 * Get the number of places.
+		 * @return The number of places.
+		 */
+		inline uint Length() const
+		{
+			return (uint)this->items.size() - this->first;
+		}
+
+		/**
+		 * Get a place.
+		 * @param index Index of the place, counted from the first one.
+		 * @return The place.
+		 */
+		inline uint32 operator [](uint index) const
+		{
+			return this->items[this->first + index];
+		}
+
+		uint LowerBound(uint32 position) const;
+		void Insert(uint32 position);
+		void Erase(uint32 position);
+	};
+
+	/** The packets of each next hop. */
+	typedef std::map<OrderID, PositionVector> BucketMap;
+
+	/** Iterator over the packets in arrival order. */
+	class Iterator {
+		friend class StationCargoPacketMap;
+
+		const PacketVector *packets; ///< The packets iterated over.
+		uint32 index;                ///< Place of the current packet.
+
+	public:
+		Iterator() : packets(NULL), index(0) {}
+
+		/**
+		 * Create an iterator pointing to a packet.
+		 * @param packets The packets.
+		 * @param index Place of the packet.
+		 */
+		Iterator(const PacketVector *packets, uint32 index) : packets(packets), index(index) {}
+
+		/**
+		 * Get the place of the current packet in the arrival order.
+		 * @return The place.
+		 */
+		inline uint32 GetPosition() const
+		{
+			return this->index;
+		}
+
+		inline CargoPacket *operator *() const
+		{
+			return (*this->packets)[this->index];
+		}
+
+		inline Iterator &operator ++()
+		{
+			do {
+				this->index++;
+			} while (this->index < this->packets->size() && (*this->packets)[this->index] == NULL);
+			return *this;
+		}
+
+		inline Iterator operator ++(int)
+		{
+			Iterator old = *this;
+			++*this;
+			return old;
+		}
+
+		inline bool operator ==(const Iterator &other) const
+		{
+			return this->index == other.index;
+		}
+
+		inline bool operator !=(const Iterator &other) const
+		{
+			return this->index != other.index;
+		}
+	};
+
+	typedef Iterator iterator;
+	typedef Iterator const_iterator;
+
+private:
+	PacketVector packets;  ///< All packets, in arrival order.
+	uint32 first;          ///< Place of the first packet that wasn't removed.
+	uint32 gaps;           ///< Number of removed packets still in #packets.
+	BucketMap buckets;     ///< The places of the packets with a next hop or without a destination, by next hop.
+	PositionVector unrouted; ///< The places of the packets with a destination but without a next hop.
+
+	PositionVector &GetIndex(const CargoPacket *cp);
+
+public:
+	StationCargoPacketMap() : first(0), gaps(0) {}
+
+	inline iterator begin() const
+	{
+		return iterator(&this->packets, this->first);
+	}
+
+	inline iterator end() const
+	{
+		return iterator(&this->packets, (uint32)this->packets.size());
+	}
+
+	/**
+	 * Get the packet that arrived first.
+	 * @pre The container is not empty.
+	 * @return The packet.
+	 */
+	inline CargoPacket *front() const
+	{
+		return this->packets[this->first];
+	}
+
+	/**
+	 * Get the number of packets.
+	 * @return The number of packets.
+	 */
+	inline uint size() const
+	{
+		return (uint)this->packets.size() - this->gaps;
+	}
+
+	/** Remove all packets, without freeing them. */
+	inline void clear()
+	{
+		this->packets.clear();
+		this->first = 0;
+		this->gaps = 0;
+		this->buckets.clear();
+		this->unrouted = PositionVector();
+	}
+
+	/**
+	 * Get the packet at a place in the arrival order.
+	 * @param position The place.
+	 * @return The packet, or NULL if it was removed.
+	 */
+	inline CargoPacket *Get(uint32 position) const
+	{
+		return this->packets[position];
+	}
+
+	iterator erase(iterator it);
+	void push_back(CargoPacket *cp);
+	iterator FindNext(OrderID order, uint32 position) const;
+	const PositionVector *FindIndex(const CargoPacket *cp) const;
+	void Unlink(iterator it);
+	void Link(iterator it);
+	void Rebuild();
+
+	void StoreUnresolved(const std::list<CargoPacket *> &list);
+	void TakeUnresolved(std::list<CargoPacket *> *list);
+};
+
 /**
  * Simple collection class for a list of cargo packets.
  * @tparam Tinst Actual instantiation of this cargo list.
+ * @tparam Tcont Container the packets are stored in.
  */
-template <class Tinst>
+template <class Tinst, class Tcont>
 class CargoList {
 public:
 	/** Container with cargo packets. */
-	typedef std::list<CargoPacket *> List;
+	typedef Tcont List;
 	/** The iterator for our container. */
-	typedef List::iterator Iterator;
+	typedef typename List::iterator Iterator;
 	/** The const iterator for our container. */
-	typedef List::const_iterator ConstIterator;
+	typedef typename List::const_iterator ConstIterator;
 
 	/** Kind of actions that could be done with packets on move. */
 	enum MoveToAction {
@@ -318,7 +513,6 @@ public:
 	}
 
 
-	void Append(CargoPacket *cp);
 	void Truncate(uint max_remaining);
 
 	template <class Tother_inst>
@@ -330,10 +524,10 @@ public:
 /**
  * CargoList that is used for vehicles.
  */
-class VehicleCargoList : public CargoList<VehicleCargoList> {
+class VehicleCargoList : public CargoList<VehicleCargoList, CargoPacketList> {
 protected:
 	/** The (direct) parent of this class. */
-	typedef CargoList<VehicleCargoList> Parent;
+	typedef CargoList<VehicleCargoList, CargoPacketList> Parent;
 
 	Money feeder_share; ///< Cache for the feeder share.
 
@@ -342,7 +536,7 @@ protected:
 
 public:
 	/** The super class ought to know what it's doing. */
-	friend class CargoList<VehicleCargoList>;
+	friend class CargoList<VehicleCargoList, CargoPacketList>;
 	/** The vehicles have a cargo list (and we want that saved). */
 	friend const struct SaveLoad *GetVehicleDescription(VehicleType vt);
 
@@ -355,6 +549,8 @@ public:
 		return this->feeder_share;
 	}
 
+	void Append(CargoPacket *cp);
+
 	void AgeCargo();
 
 	void InvalidateCache();
@@ -387,13 +583,13 @@ public:
 /**
  * CargoList that is used for stations.
  */
-class StationCargoList : public CargoList<StationCargoList> {
+class StationCargoList : public CargoList<StationCargoList, StationCargoPacketMap> {
 public:
 	typedef std::map<OrderID, int> OrderMap;
 
 protected:
 	/** The (direct) parent of this class. */
-	typedef CargoList<StationCargoList> Parent;
+	typedef CargoList<StationCargoList, StationCargoPacketMap> Parent;
 
 	OrderMap order_cache;
 	uint32 next_start;        ///< Packet number to start the next hop update loop from.
@@ -402,17 +598,23 @@ protected:
 	void RemoveFromCache(const CargoPacket *cp);
 	void RemoveFromCacheLocal(const CargoPacket *cp, uint amount);
 
-	/* virtual */ bool UpdateCargoNextHop(CargoPacket *cp, Station *st, CargoID cid);
+	bool UpdateNextHop(Iterator it, Station *st, CargoID cid);
+	void SetNextHop(Iterator it, OrderID next_order, StationID next_station);
+	uint LoadPackets(VehicleCargoList *dest, uint max_move, OrderID order, Station *st, CargoID cid);
 
 public:
 	/** The super class ought to know what it's doing. */
-	friend class CargoList<StationCargoList>;
+	friend class CargoList<StationCargoList, StationCargoPacketMap>;
 	/** The stations, via GoodsEntry, have a CargoList. */
 	friend const struct SaveLoad *GetGoodsDesc();
 
+	void Append(CargoPacket *cp);
+	bool MoveTo(VehicleCargoList *dest, uint max_move, MoveToAction mta, CargoPayment *payment, StationID st, OrderID cur_order, CargoID cid, bool *did_transfer = NULL);
+
 	void InvalidateCache();
 
 	void UpdateCargoNextHop(Station *st, CargoID cid);
+	void QueueNextHopSearches(Station *st, CargoID cid) const;
 
 	/**
 	 * Gets the cargo counts per next hop.
@@ -38,6 +38,9 @@
 #include "console_func.h"
 #include "engine_base.h"
 #include "game/game.hpp"
+#include "cargodest_func.h"
+#include "vehicle_base.h"
+#include "pathfinder/pf_telemetry.h"
 #include "table/strings.h"
 
 /* scriptfile handling */
@@ -1325,6 +1328,120 @@ DEF_CONSOLE_CMD(ConGetDate)
 	return true;
 }
 
+DEF_CONSOLE_CMD(ConCargodestStats)
+{
+	if (argc == 0) {
+		IConsoleHelp("Show the cargo routing profiling counters. Usage: 'cargodest_stats [reset]'");
+		IConsoleHelp("The counters are only collected while the 'cargodest' debug level is at least 1.");
+		return true;
+	}
+
+	if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+		ResetCargodestPerfStats();
+		IConsolePrint(CC_DEFAULT, "Cargo routing counters reset.");
+		return true;
+	}
+	if (argc != 1) return false;
+
+	if (_debug_cargodest_level == 0) IConsoleWarning("Counters are disabled, enable them with 'debug_level cargodest=1'.");
+
+	for (uint i = 0; i < CDPE_END; i++) {
+		const CargodestPerfStats &stats = GetCargodestPerfStats((CargodestPerfElement)i);
+		IConsolePrintF(CC_DEFAULT, "%-16s calls: " OTTD_PRINTF64 ", total: " OTTD_PRINTF64 " kcycles, avg: " OTTD_PRINTF64 " kcycles, worst tick: " OTTD_PRINTF64 " kcycles",
+				GetCargodestPerfName((CargodestPerfElement)i), stats.calls, stats.time / 1000, stats.calls == 0 ? 0 : stats.time / stats.calls / 1000, stats.max_tick_time / 1000);
+		if (i == CDPE_CHOOSE_ROUTE_LINK) {
+			IConsolePrintF(CC_DEFAULT, "%-16s nodes opened: " OTTD_PRINTF64 ", nodes closed: " OTTD_PRINTF64 ", not found: " OTTD_PRINTF64,
+					"", stats.nodes_opened, stats.nodes_closed, stats.not_found);
+		}
+	}
+	return true;
+}
+
+/**
+ * Print a histogram of the pathfinder telemetry on one line.
+ * @param name Name of the histogram.
+ * @param histogram The buckets.
+ */
+static void PrintPathfinderHistogram(const char *name, const uint64 *histogram)
+{
+	char buf[512];
+	char *p = buf + seprintf(buf, lastof(buf), "%8s%-10s", "", name);
+	for (uint i = 0; i < PF_TELEMETRY_BUCKETS; i++) {
+		if (histogram[i] == 0) continue;
+		if (i == 0) {
+			p += seprintf(p, lastof(buf), " 0:" OTTD_PRINTF64, histogram[i]);
+		} else if (i == PF_TELEMETRY_BUCKETS - 1) {
+			p += seprintf(p, lastof(buf), " >=%u:" OTTD_PRINTF64, 1U << (i - 1), histogram[i]);
+		} else {
+			p += seprintf(p, lastof(buf), " <%u:" OTTD_PRINTF64, 1U << i, histogram[i]);
+		}
+	}
+	IConsolePrint(CC_DEFAULT, buf);
+}
+
+DEF_CONSOLE_CMD(ConPathfinderStats)
+{
+	if (argc == 0) {
+		IConsoleHelp("Show the pathfinder telemetry. Usage: 'pathfinder_stats [on | off | reset | top [<count>]]'");
+		IConsoleHelp("'on' and 'off' start and stop collecting, 'reset' clears the collected telemetry.");
+		IConsoleHelp("'top' lists the vehicles that spent the most time in path searches, 10 unless <count> is given.");
+		return true;
+	}
+
+	if (argc == 2 && strcmp(argv[1], "on") == 0) {
+		EnablePathfinderTelemetry(true);
+		IConsolePrint(CC_DEFAULT, "Pathfinder telemetry enabled.");
+		return true;
+	}
+	if (argc == 2 && strcmp(argv[1], "off") == 0) {
+		EnablePathfinderTelemetry(false);
+		IConsolePrint(CC_DEFAULT, "Pathfinder telemetry disabled.");
+		return true;
+	}
+	if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+		ResetPathfinderTelemetry();
+		IConsolePrint(CC_DEFAULT, "Pathfinder telemetry reset.");
+		return true;
+	}
+
+	if (!_pf_telemetry_enabled) IConsoleWarning("Telemetry is disabled, enable it with 'pathfinder_stats on'.");
+
+	if (argc >= 2 && strcmp(argv[1], "top") == 0) {
+		if (argc > 3) return false;
+
+		uint count = 10;
+		if (argc == 3 && (!GetArgumentInteger(&count, argv[2]) || count == 0)) return false;
+		count = min(count, 1000U);
+
+		PathfinderVehicleCost *list = AllocaM(PathfinderVehicleCost, count);
+		count = GetPathfinderTelemetryTopVehicles(list, count);
+		for (uint i = 0; i < count; i++) {
+			const Vehicle *v = Vehicle::GetIfValid(list[i].index);
+			if (v == NULL) continue;
+
+			char name[64];
+			SetDParam(0, v->index);
+			GetString(name, STR_VEHICLE_NAME, lastof(name));
+			IConsolePrintF(CC_DEFAULT, "%3u) %-24s company: %d, calls: %u, total: " OTTD_PRINTF64 " us, avg: " OTTD_PRINTF64 " us, avg nodes: %u",
+					i + 1, name, v->owner + 1, list[i].calls, list[i].time / 1000, list[i].time / list[i].calls / 1000, list[i].nodes / list[i].calls);
+		}
+		return true;
+	}
+	if (argc != 1) return false;
+
+	for (uint i = 0; i < PFTT_END; i++) {
+		PathfinderTelemetryStats stats;
+		GetPathfinderTelemetryStats((PathfinderTelemetryType)i, &stats);
+		IConsolePrintF(CC_DEFAULT, "%-6s calls: " OTTD_PRINTF64 ", not found: " OTTD_PRINTF64 ", avg: " OTTD_PRINTF64 " us, max: " OTTD_PRINTF64 " us, avg nodes: " OTTD_PRINTF64 ", max nodes: " OTTD_PRINTF64,
+				GetPathfinderTelemetryName((PathfinderTelemetryType)i), stats.calls, stats.not_found,
+				stats.calls == 0 ? 0 : stats.time / stats.calls / 1000, stats.max_time / 1000,
+				stats.calls == 0 ? 0 : stats.nodes / stats.calls, stats.max_nodes);
+		if (stats.calls == 0) continue;
+		PrintPathfinderHistogram("time (us):", stats.time_histogram);
+		PrintPathfinderHistogram("nodes:", stats.nodes_histogram);
+	}
+	return true;
+}
 
 DEF_CONSOLE_CMD(ConAlias)
 {
@@ -1901,6 +2018,8 @@ void IConsoleStdLibRegister()
 	IConsoleCmdRegister("restart",      ConRestart);
 	IConsoleCmdRegister("getseed",      ConGetSeed);
 	IConsoleCmdRegister("getdate",      ConGetDate);
+	IConsoleCmdRegister("cargodest_stats", ConCargodestStats);
+	IConsoleCmdRegister("pathfinder_stats", ConPathfinderStats);
 	IConsoleCmdRegister("quit",         ConExit);
 	IConsoleCmdRegister("resetengines", ConResetEngines, ConHookNoNetwork);
 	IConsoleCmdRegister("reset_enginepool", ConResetEnginePool, ConHookNoNetwork);
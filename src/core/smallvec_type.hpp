@@ -144,6 +144,23 @@ public:
 		return &this->data[begin];
 	}
 
+	/**
+	 * Insert a new item at a specific position into the vector, moving all following items.
+	 * @param item Position at which the new item should be inserted
+	 * @return pointer to the new item
+	 */
+	inline T *Insert(T *item)
+	{
+		assert(item >= this->Begin() && item <= this->End());
+
+		uint start = item - this->Begin();
+		uint to_move = this->items - start;
+
+		this->Append();
+		if (to_move > 0) MemMoveT(this->data + start + 1, this->data + start, to_move);
+		return &this->data[start];
+	}
+
 	/**
 	 * Search for the first occurrence of an item.
 	 * The '!=' operator of T is used for comparison.
@@ -212,6 +229,21 @@ public:
 		*item = this->data[--this->items];
 	}
 
+	/**
+	 * Remove items from the vector while preserving the order of the other items.
+	 * @param pos First item to remove.
+	 * @param count Number of consecutive items to remove.
+	 */
+	inline void ErasePreservingOrder(uint pos, uint count = 1)
+	{
+		if (count == 0) return;
+		assert(pos + count <= this->items);
+
+		this->items -= count;
+		uint to_move = this->items - pos;
+		if (to_move > 0) MemMoveT(this->data + pos, this->data + pos + count, to_move);
+	}
+
 	/**
 	 * Tests whether a item is present in the vector, and appends it to the end if not.
 	 * The '!=' operator of T is used for comparison.
@@ -19,7 +19,6 @@
 #include "vehicle_base.h"
 #include "rail_gui.h"
 #include "saveload/saveload.h"
-#include "cargodest_func.h"
 
 Year      _cur_year;   ///< Current year, starting at 0
 Month     _cur_month;  ///< Current month (0..11)
@@ -249,7 +248,6 @@ static void OnNewMonth()
 	IndustryMonthlyLoop();
 	SubsidyMonthlyLoop();
 	StationMonthlyLoop();
-	UpdateCargoLinks();
 #ifdef ENABLE_NETWORK
 	if (_network_server) NetworkServerMonthlyLoop();
 #endif /* ENABLE_NETWORK */
@@ -72,6 +72,13 @@ const char *GetDebugString();
  */
 uint64 ottd_rdtsc();
 
+/**
+ * Get the time of a monotonic clock, which isn't affected by changes of the
+ * system time or the CPU frequency.
+ * @return The time in nanoseconds since an unspecified moment.
+ */
+uint64 ottd_monotonic_ns();
+
 /* Used for profiling
  *
  * Usage:
@@ -35,6 +35,7 @@
 #include "cargo_type.h"
 #include "departures_func.h"
 #include "departures_type.h"
+#include "core/sort_func.hpp"
 
 /** A scheduled order. */
 typedef struct OrderDate
@@ -46,6 +47,111 @@ typedef struct OrderDate
 	DepartureStatus status; ///< Whether the vehicle has arrived to carry out the order yet
 } OrderDate;
 
+/** Entry of the index of vehicles calling at stations while it is built. */
+struct DepartureIndexEntry {
+	uint key;         ///< Station and vehicle type, see #GetDepartureIndexKey.
+	const Vehicle *v; ///< The vehicle.
+};
+
+static SmallVector<const Vehicle *, 256> _departure_vehicles; ///< Primary vehicles with orders for each station, by station and vehicle type.
+static SmallVector<uint, 256> _departure_vehicles_first;      ///< Position in #_departure_vehicles of the first vehicle of each station and vehicle type.
+static bool _departure_index_valid = false;                    ///< Is the index of vehicles calling at stations up to date?
+
+/**
+ * Get the key of a station and vehicle type in the index of vehicles calling at stations.
+ * @param station The station or waypoint.
+ * @param type The vehicle type.
+ * @return The key.
+ */
+static inline uint GetDepartureIndexKey(StationID station, VehicleType type)
+{
+	return station * 4 + (type - VEH_TRAIN);
+}
+
+/** Sort the entries of the index by key and vehicle index. */
+static int CDECL DepartureIndexEntrySorter(const DepartureIndexEntry *a, const DepartureIndexEntry *b)
+{
+	if (a->key != b->key) return a->key < b->key ? -1 : 1;
+	return (int)a->v->index - (int)b->v->index;
+}
+
+/**
+ * Mark the index of vehicles calling at stations out of date.
+ * Call this whenever the orders of a vehicle or the vehicles sharing an order list change.
+ */
+void InvalidateDepartureIndex()
+{
+	_departure_index_valid = false;
+}
+
+/**
+ * Build the index of vehicles calling at stations. A vehicle calls at a
+ * station if it has an order to go to or via it, like in the station's
+ * vehicle lists. Orders that are changed in place, e.g. into dummy orders,
+ * leave extra vehicles in the index; that is harmless, as the departure
+ * lists check the orders of the vehicles anyway.
+ */
+static void RebuildDepartureIndex()
+{
+	SmallVector<DepartureIndexEntry, 256> entries;
+	uint num_keys = GetDepartureIndexKey((StationID)BaseStation::GetPoolSize(), VEH_TRAIN);
+
+	const Vehicle *v;
+	FOR_ALL_VEHICLES(v) {
+		if (!v->IsPrimaryVehicle()) continue;
+
+		const Order *order;
+		FOR_VEHICLE_ORDERS(v, order) {
+			if ((order->IsType(OT_GOTO_STATION) || order->IsType(OT_GOTO_WAYPOINT) || order->IsType(OT_IMPLICIT))
+					&& order->GetDestination() < BaseStation::GetPoolSize()) {
+				DepartureIndexEntry *entry = entries.Append();
+				entry->key = GetDepartureIndexKey(order->GetDestination(), v->type);
+				entry->v = v;
+			}
+		}
+	}
+
+	QSortT(entries.Begin(), entries.Length(), &DepartureIndexEntrySorter);
+
+	_departure_vehicles.Clear();
+	_departure_vehicles_first.Clear();
+	_departure_vehicles_first.Append(num_keys + 1);
+
+	uint key = 0;
+	for (const DepartureIndexEntry *entry = entries.Begin(); entry != entries.End(); entry++) {
+		/* Vehicles with several orders for the same station are listed once. */
+		if (entry != entries.Begin() && entry->key == entry[-1].key && entry->v == entry[-1].v) continue;
+
+		while (key <= entry->key) _departure_vehicles_first[key++] = _departure_vehicles.Length();
+		*_departure_vehicles.Append() = entry->v;
+	}
+	while (key <= num_keys) _departure_vehicles_first[key++] = _departure_vehicles.Length();
+
+	_departure_index_valid = true;
+}
+
+/**
+ * Get the primary vehicles of a type that have orders for a station, sorted by vehicle index.
+ * @param station The station or waypoint.
+ * @param type The vehicle type.
+ * @param[out] begin The first vehicle.
+ * @param[out] end The end of the vehicles.
+ */
+static void GetDepartureVehicles(StationID station, VehicleType type, const Vehicle * const **begin, const Vehicle * const **end)
+{
+	if (!_departure_index_valid) RebuildDepartureIndex();
+
+	uint key = GetDepartureIndexKey(station, type);
+	if (key + 1 >= _departure_vehicles_first.Length()) {
+		/* The station is newer than the index, so nothing goes there yet. */
+		*begin = *end = _departure_vehicles.Begin();
+		return;
+	}
+
+	*begin = _departure_vehicles.Begin() + _departure_vehicles_first[key];
+	*end = _departure_vehicles.Begin() + _departure_vehicles_first[key + 1];
+}
+
 static bool IsDeparture(const Order *order, StationID station) {
 	return (order->GetType() == OT_GOTO_STATION &&
 			(StationID)order->GetDestination() == station &&
@@ -104,22 +210,19 @@ DepartureList* MakeDepartureList(StationID station, bool show_vehicle_types[5],
 	/* This order is stored along with some more information. */
 	/* We keep a pointer to the `least' order (the one with the soonest expected completion time). */
 	for (uint i = 0; i < 4; ++i) {
-		VehicleList vehicles;
-
 		if (!show_vehicle_types[i]) {
 			/* Don't show vehicles whose type we're not interested in. */
 			continue;
 		}
 
-        /* MAX_COMPANIES is probably the wrong thing to put here, but it works. GenerateVehicleSortList doesn't check the company when the type of list is VL_STATION_LIST (r20801). */
-		if (!GenerateVehicleSortList(&vehicles, VehicleListIdentifier(VL_STATION_LIST, (VehicleType)(VEH_TRAIN + i), MAX_COMPANIES, station).Pack())) {
-			/* Something went wrong: panic! */
-			return result;
-		}
+		/* The vehicles of this type with orders for the station, of all companies. */
+		const Vehicle * const *vehicles_begin;
+		const Vehicle * const *vehicles_end;
+		GetDepartureVehicles(station, (VehicleType)(VEH_TRAIN + i), &vehicles_begin, &vehicles_end);
 
 		/* Get the first order for each vehicle for the station we're interested in that doesn't have No Loading set. */
 		/* We find the least order while we're at it. */
-		for (const Vehicle **v = vehicles.Begin(); v != vehicles.End(); v++) {
+		for (const Vehicle * const *v = vehicles_begin; v != vehicles_end; v++) {
 			if (_settings_client.gui.departure_only_passengers) {
 				bool carries_passengers = false;
 
@@ -17,5 +17,6 @@
 #include "departures_type.h"
 
 DepartureList* MakeDepartureList(StationID station, bool show_vehicle_types[4], DepartureType type = D_DEPARTURE, bool show_vehicles_via = false);
+void InvalidateDepartureIndex();
 
 #endif /* DEPARTURES_FUNC_H */
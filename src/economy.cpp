@@ -49,6 +49,7 @@
 #include "cargomonitor.h"
 #include "goal_base.h"
 #include "cargodest_func.h"
+#include "pathfinder/yapf/yapf_cache.h"
 
 #include "table/strings.h"
 #include "table/pricebase.h"
@@ -468,6 +469,10 @@ void ChangeOwnershipOfCompanyItems(Owner old_owner, Owner new_owner)
 			ChangeTileOwner(tile, old_owner, new_owner);
 		} while (++tile != MapSize());
 
+		/* Track followers check the owner of the tiles, so the cached rail and road segments are outdated. */
+		YapfNotifyTrackLayoutChange(INVALID_TILE, INVALID_TRACK);
+		YapfNotifyRoadLayoutChange(INVALID_TILE);
+
 		if (new_owner != INVALID_OWNER) {
 			/* Update all signals because there can be new segment that was owned by two companies
 			 * and signals were not propagated
@@ -500,6 +505,7 @@ void ChangeOwnershipOfCompanyItems(Owner old_owner, Owner new_owner)
 				for (RouteLinkList::iterator itr = st->goods[cid].routes.begin(); itr != st->goods[cid].routes.end(); ++itr) {
 					if ((*itr)->owner == old_owner) (*itr)->owner = new_owner;
 				}
+				st->goods[cid].route_table.OnLinksChanged();
 			}
 		}
 	}
@@ -1365,6 +1371,138 @@ static bool VehicleStayConditional(const Vehicle * v)
 	return false;
 }
 
+/**
+ * Amount of cargo that is virtually left at a station per cargo type and
+ * next hop, while the vehicles at the station load. This is an open
+ * addressing hash table whose memory is reused for all stations, so the
+ * bookkeeping doesn't allocate once it has grown large enough.
+ */
+class CargoLeft {
+	/** A single entry of the table. */
+	struct Slot {
+		uint32 key;    ///< Cargo type and next hop, see #Key.
+		uint32 stamp;  ///< The entry is only used if this equals the stamp of the table.
+		int amount;    ///< Amount of cargo left.
+	};
+
+	static const uint MIN_SIZE = 64; ///< Initial number of slots.
+
+	Slot *slots;  ///< The slots of the table.
+	uint size;    ///< Number of slots, a power of two.
+	uint used;    ///< Number of used slots.
+	uint32 stamp; ///< Stamp of the used slots.
+
+	/** Get the key of a cargo type and next hop. */
+	static inline uint32 Key(CargoID cid, OrderID order)
+	{
+		return cid << 16 | order;
+	}
+
+	/**
+	 * Find the slot of a key.
+	 * @param key Key to look for.
+	 * @return The slot with the key or the free slot the key belongs in.
+	 */
+	inline Slot *Find(uint32 key) const
+	{
+		uint i = (key * 0x9E3779B1U) >> 16;
+		for (;;) {
+			Slot *slot = &this->slots[i & (this->size - 1)];
+			if (slot->stamp != this->stamp || slot->key == key) return slot;
+			i++;
+		}
+	}
+
+	/**
+	 * Get the slot of a key, creating it if needed.
+	 * @param key Key to look for.
+	 * @return The slot with the key.
+	 */
+	Slot *Insert(uint32 key)
+	{
+		Slot *slot = this->Find(key);
+		if (slot->stamp == this->stamp) return slot;
+
+		if ((this->used + 1) * 2 > this->size) {
+			/* Too full, rehash into a table twice the size. */
+			Slot *old_slots = this->slots;
+			uint old_size = this->size;
+			uint32 old_stamp = this->stamp;
+
+			this->size *= 2;
+			this->slots = CallocT<Slot>(this->size);
+			this->stamp = 1;
+			for (uint i = 0; i < old_size; i++) {
+				if (old_slots[i].stamp != old_stamp) continue;
+				Slot *moved = this->Find(old_slots[i].key);
+				*moved = old_slots[i];
+				moved->stamp = this->stamp;
+			}
+			free(old_slots);
+
+			slot = this->Find(key);
+		}
+
+		slot->key = key;
+		slot->stamp = this->stamp;
+		slot->amount = 0;
+		this->used++;
+		return slot;
+	}
+
+public:
+	CargoLeft() : slots(CallocT<Slot>(MIN_SIZE)), size(MIN_SIZE), used(0), stamp(1) {}
+
+	~CargoLeft()
+	{
+		free(this->slots);
+	}
+
+	/**
+	 * Start over with the cargo waiting at a station.
+	 * @param st The station.
+	 */
+	void Fill(const Station *st)
+	{
+		/* Throw away all entries by changing the stamp. */
+		if (++this->stamp == 0) {
+			MemSetT(this->slots, 0, this->size);
+			this->stamp = 1;
+		}
+		this->used = 0;
+
+		for (CargoID cid = 0; cid < NUM_CARGO; cid++) {
+			const StationCargoList::OrderMap &counts = st->goods[cid].cargo.CountForNextHop();
+			for (StationCargoList::OrderMap::const_iterator it = counts.begin(); it != counts.end(); ++it) {
+				this->Insert(Key(cid, it->first))->amount = it->second;
+			}
+		}
+	}
+
+	/**
+	 * Get the amount of cargo left.
+	 * @param cid Cargo type.
+	 * @param order Next hop of the cargo.
+	 * @return The amount.
+	 */
+	inline int Get(CargoID cid, OrderID order) const
+	{
+		const Slot *slot = this->Find(Key(cid, order));
+		return slot->stamp == this->stamp ? slot->amount : 0;
+	}
+
+	/**
+	 * Take some cargo from the amount left.
+	 * @param cid Cargo type.
+	 * @param order Next hop of the cargo.
+	 * @param amount Amount of cargo to take.
+	 */
+	inline void Take(CargoID cid, OrderID order, int amount)
+	{
+		this->Insert(Key(cid, order))->amount -= amount;
+	}
+};
+
 /**
  * Loads/unload the vehicle if possible.
  * @param front the vehicle to be (un)loaded
@@ -1373,7 +1511,7 @@ static bool VehicleStayConditional(const Vehicle * v)
  *                   picked up by another vehicle when all
  *                   previous vehicles have loaded.
  */
-static void LoadUnloadVehicle(Vehicle *front, StationCargoList::OrderMap (&cargo_left)[NUM_CARGO])
+static void LoadUnloadVehicle(Vehicle *front, CargoLeft &cargo_left)
 {
 	assert(front->current_order.IsType(OT_LOADING));
 
@@ -1388,12 +1526,12 @@ static void LoadUnloadVehicle(Vehicle *front, StationCargoList::OrderMap (&cargo
 				if (!HasBit(v->vehicle_flags, VF_CARGO_UNLOADING)) cap_left -= v->cargo.Count();
 				if (cap_left > 0) {
 					/* Try the bucket for our next destination first. */
-					int loaded = min(cap_left, cargo_left[v->cargo_type][last_order]);
-					cargo_left[v->cargo_type][last_order] -= loaded;
+					int loaded = min(cap_left, cargo_left.Get(v->cargo_type, last_order));
+					cargo_left.Take(v->cargo_type, last_order, loaded);
 
 					/* Reserve from the common bucket if still space left. */
-					loaded = min(cap_left - loaded, cargo_left[v->cargo_type][INVALID_ORDER]);
-					cargo_left[v->cargo_type][INVALID_ORDER] -= loaded;
+					loaded = min(cap_left - loaded, cargo_left.Get(v->cargo_type, INVALID_ORDER));
+					cargo_left.Take(v->cargo_type, INVALID_ORDER, loaded);
 				}
 			}
 		}
@@ -1596,13 +1734,13 @@ static void LoadUnloadVehicle(Vehicle *front, StationCargoList::OrderMap (&cargo
 				FOR_EACH_SET_CARGO_ID(cid, refit_mask) {
 					/* Consider refitting to this cargo, if other vehicles of the consist cannot
 					 * already take the cargo without refitting */
-					if (cargo_left[cid][last_order] + cargo_left[cid][INVALID_ORDER] > (int)consist_capleft[cid] + amount) {
+					if (cargo_left.Get(cid, last_order) + cargo_left.Get(cid, INVALID_ORDER) > (int)consist_capleft[cid] + amount) {
 						/* Try to find out if auto-refitting would succeed. In case the refit is allowed,
 						 * the returned refit capacity will be greater than zero. */
 						new_subtype = GetBestFittingSubType(v, v, cid);
 						DoCommand(v_start->tile, v_start->index, cid | 1U << 6 | new_subtype << 8 | 1U << 16, DC_QUERY_COST, GetCmdRefitVeh(v_start)); // Auto-refit and only this vehicle including artic parts.
 						if (_returned_refit_capacity > 0) {
-							amount = cargo_left[cid][last_order] + cargo_left[cid][INVALID_ORDER] - consist_capleft[cid];
+							amount = cargo_left.Get(cid, last_order) + cargo_left.Get(cid, INVALID_ORDER) - consist_capleft[cid];
 							new_cid = cid;
 						}
 					}
@@ -1660,7 +1798,7 @@ static void LoadUnloadVehicle(Vehicle *front, StationCargoList::OrderMap (&cargo
 			/* Skip loading this vehicle if another train/vehicle is already handling
 			 * the same cargo type at this station. Check the buckets for our next
 			 * destination and the general bucket. */
-			if (_settings_game.order.improved_load && cargo_left[v->cargo_type][last_order] <= 0 && cargo_left[v->cargo_type][INVALID_ORDER] <= 0) {
+			if (_settings_game.order.improved_load && cargo_left.Get(v->cargo_type, last_order) <= 0 && cargo_left.Get(v->cargo_type, INVALID_ORDER) <= 0) {
 				SetBit(cargo_not_full, v->cargo_type);
 				continue;
 			}
@@ -1672,23 +1810,23 @@ static void LoadUnloadVehicle(Vehicle *front, StationCargoList::OrderMap (&cargo
 			}
 			if (_settings_game.order.improved_load) {
 				/* Don't load stuff that is already 'reserved' for other vehicles */
-				count = cargo_left[v->cargo_type][last_order] + cargo_left[v->cargo_type][INVALID_ORDER];
+				count = cargo_left.Get(v->cargo_type, last_order) + cargo_left.Get(v->cargo_type, INVALID_ORDER);
 
 				/* Try the bucket for our next destination first. */
-				int load_next = min<uint>(cap, cargo_left[v->cargo_type][last_order]);
+				int load_next = min<uint>(cap, cargo_left.Get(v->cargo_type, last_order));
 
 				/* Reserve from the common bucket if still space left. */
-				int load_common = min<uint>(cap - load_next, cargo_left[v->cargo_type][INVALID_ORDER]);
+				int load_common = min<uint>(cap - load_next, cargo_left.Get(v->cargo_type, INVALID_ORDER));
 
 				cap = load_next + load_common;
-				cargo_left[v->cargo_type][last_order] -= load_next;
+				cargo_left.Take(v->cargo_type, last_order, load_next);
 
 				if (use_autorefit) {
 					/* When using autorefit, reserve all cargo for this wagon to prevent other wagons
 					 * from feeling the need to refit. */
 					uint total_cap_left = v->cargo_cap - v->cargo.Count() - load_common;
 					consist_capleft[v->cargo_type] -= total_cap_left;
-					cargo_left[v->cargo_type][INVALID_ORDER] -= total_cap_left;
+					cargo_left.Take(v->cargo_type, INVALID_ORDER, total_cap_left);
 					if (total_cap_left > cap && count > cap) {
 						/* Remember if there are reservations left so that we don't stop
 						 * loading before they're loaded. */
@@ -1697,7 +1835,7 @@ static void LoadUnloadVehicle(Vehicle *front, StationCargoList::OrderMap (&cargo
 				} else {
 					/* Update cargo left; but don't reserve everything yet, so other wagons
 					 * of the same consist load in parallel. */
-					cargo_left[v->cargo_type][INVALID_ORDER] -= load_common;
+					cargo_left.Take(v->cargo_type, INVALID_ORDER, load_common);
 				}
 			}
 
@@ -1772,12 +1910,12 @@ static void LoadUnloadVehicle(Vehicle *front, StationCargoList::OrderMap (&cargo
 			}
 			if (cap_left > 0) {
 				/* Try the bucket for our next destination first. */
-				int loaded = min(cap_left, cargo_left[v->cargo_type][last_order]);
-				cargo_left[v->cargo_type][last_order] -= loaded;
+				int loaded = min(cap_left, cargo_left.Get(v->cargo_type, last_order));
+				cargo_left.Take(v->cargo_type, last_order, loaded);
 
 				/* Reserve from the common bucket if still space left. */
-				loaded = min(cap_left - loaded, cargo_left[v->cargo_type][INVALID_ORDER]);
-				cargo_left[v->cargo_type][INVALID_ORDER] -= loaded;
+				loaded = min(cap_left - loaded, cargo_left.Get(v->cargo_type, INVALID_ORDER));
+				cargo_left.Take(v->cargo_type, INVALID_ORDER, loaded);
 			}
 		}
 	}
@@ -1897,10 +2035,8 @@ void LoadUnloadStation(Station *st)
 	 */
 	if (last_loading == NULL) return;
 
-	StationCargoList::OrderMap cargo_left[NUM_CARGO];
-	for (CargoID i = 0; i < NUM_CARGO; i++) {
-		cargo_left[i] = st->goods[i].cargo.CountForNextHop();
-	}
+	static CargoLeft cargo_left;
+	cargo_left.Fill(st);
 
 	for (iter = st->loading_vehicles.begin(); iter != st->loading_vehicles.end(); ++iter) {
 		Vehicle *v = *iter;
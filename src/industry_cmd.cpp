@@ -40,6 +40,7 @@
 #include "core/backup_type.hpp"
 #include "object_base.h"
 #include "game/game.hpp"
+#include "cargodest_func.h"
 
 #include "table/strings.h"
 #include "table/industry_land.h"
@@ -132,6 +133,8 @@ const IndustryTileSpec *GetIndustryTileSpec(IndustryGfx gfx)
 
 Industry::~Industry()
 {
+	RemoveFromNearbyIndex(this);
+
 	if (CleaningPool()) return;
 
 	/* Industry can also be destroyed when not fully initialized.
@@ -1796,6 +1799,8 @@ static void DoCreateNewIndustry(Industry *i, TileIndex tile, IndustryType type,
 		}
 	} while ((++it)->ti.x != -0x80);
 
+	AddToNearbyIndex(i);
+
 	if (GetIndustrySpec(i->type)->behaviour & INDUSTRYBEH_PLANT_ON_BUILT) {
 		for (uint j = 0; j != 50; j++) PlantRandomFarmField(i);
 	}
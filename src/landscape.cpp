@@ -32,6 +32,8 @@
 #include "object_base.h"
 #include "company_func.h"
 #include "pathfinder/npf/aystar.h"
+#include "pathfinder/yapf/yapf_cache.h"
+#include "trafficlight_func.h"
 #include <list>
 
 #include "table/strings.h"
@@ -488,9 +490,12 @@ void DoClearSquare(TileIndex tile)
 {
 	/* If the tile can have animation and we clear it, delete it from the animated tile list. */
 	if (_tile_type_procs[GetTileType(tile)]->animate_tile_proc != NULL) DeleteAnimatedTile(tile);
+	if (HasTrafficLights(tile)) InvalidateTrafficLightConsists();
 
 	MakeClear(tile, CLEAR_GRASS, _generating_world ? 3 : 0);
 	MarkTileDirtyByTile(tile);
+	YapfNotifyWaterLayoutChange(tile);
+	YapfNotifyRoadLayoutChange(tile);
 }
 
 /**
@@ -1123,17 +1128,6 @@ static void River_FoundEndNode(AyStar *aystar, OpenListNode *current)
 
 static const uint RIVER_HASH_SIZE = 8; ///< The number of bits the hash for river finding should have.
 
-/**
- * Simple hash function for river tiles to be used by AyStar.
- * @param tile The tile to hash.
- * @param dir The unused direction.
- * @return The hash for the tile.
- */
-static uint River_Hash(uint tile, uint dir)
-{
-	return GB(TileHash(TileX(tile), TileY(tile)), 0, RIVER_HASH_SIZE);
-}
-
 /**
  * Actually build the river between the begin and end tiles using AyStar.
  * @param begin The begin of the river.
@@ -1150,7 +1144,7 @@ static void BuildRiver(TileIndex begin, TileIndex end)
 	finder.FoundEndNode = River_FoundEndNode;
 	finder.user_target = &end;
 
-	finder.Init(River_Hash, 1 << RIVER_HASH_SIZE);
+	finder.Init(RIVER_HASH_SIZE);
 
 	AyStarNode start;
 	start.tile = begin;
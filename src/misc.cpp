@@ -27,6 +27,8 @@
 #include "window_func.h"
 #include "core/pool_type.hpp"
 #include "game/game.hpp"
+#include "pathfinder/yapf/yapf_cache.h"
+#include "trafficlight_func.h"
 
 
 extern TileIndex _cur_tileloop_tile;
@@ -93,6 +95,9 @@ void InitializeGame(uint size_x, uint size_y, bool reset_date, bool reset_settin
 	InitializeBuildingCounts();
 
 	InitializeNPF();
+	YapfNotifyTrackLayoutChange(INVALID_TILE, INVALID_TRACK);
+	YapfNotifyWaterLayoutChange(INVALID_TILE);
+	InvalidateTrafficLightConsists();
 
 	InitializeCompanies();
 	AI::Initialize();
@@ -45,6 +45,13 @@ public:
 	inline SmallArray() { }
 	/** Clear (destroy) all items */
 	inline void Clear() {data.Clear();}
+	/** Destroy all items, but keep the first sub-array allocated for reuse. */
+	inline void Reset()
+	{
+		if (data.Length() == 0) return;
+		data.Truncate(1);
+		data[0].Clear();
+	}
 	/** Return actual number of items */
 	inline uint Length() const
 	{
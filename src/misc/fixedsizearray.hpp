@@ -95,6 +95,18 @@ public:
 		SizeRef() = 0;
 	}
 
+	/**
+	 * Destroy all items past the given number of items, keeping the memory block.
+	 * @param num Number of items to keep.
+	 */
+	inline void Truncate(uint num)
+	{
+		for (T *pItem = this->data + this->Length() - 1; pItem >= this->data + num; pItem--) {
+			pItem->~T();
+		}
+		if (num < this->Length()) SizeRef() = num;
+	}
+
 	/** return number of used items */
 	inline uint Length() const { return Hdr().items; }
 	/** return true if array is full */
@@ -63,12 +63,15 @@
 #include "town.h"
 #include "subsidy_func.h"
 #include "gfx_layout.h"
+#include "cargodest_func.h"
+#include "pathfinder/pf_query_log.h"
 
 
 #include <stdarg.h>
 
 
 void CallLandscapeTick();
+void OnTick_CargoLinks();
 void IncreaseDate();
 void DoPaletteAnimations();
 void MusicLoop();
@@ -175,6 +178,8 @@ static void ShowHelp()
 		"  -c config_file      = Use 'config_file' instead of 'openttd.cfg'\n"
 		"  -x                  = Do not automatically save to config file on exit\n"
 		"  -q savegame         = Write some information about the savegame and exit\n"
+		"  -Y record:file      = Record the path searches of vehicles to 'file'\n"
+		"  -Y replay:file      = Compare the path searches of vehicles with 'file'\n"
 		"\n",
 		lastof(buf)
 	);
@@ -525,6 +530,7 @@ static const OptionData _options[] = {
 	 GETOPT_SHORT_VALUE('c'),
 	 GETOPT_SHORT_NOVAL('x'),
 	 GETOPT_SHORT_VALUE('q'),
+	 GETOPT_SHORT_VALUE('Y'),
 	 GETOPT_SHORT_NOVAL('h'),
 	GETOPT_END()
 };
@@ -540,6 +546,8 @@ int ttd_main(int argc, char *argv[])
 	char *sounds_set = NULL;
 	char *music_set = NULL;
 	Dimension resolution = {0, 0};
+	const char *pf_query_log = NULL;
+	bool pf_query_replay = false;
 	/* AfterNewGRFScan sets save_config to true after scanning completed. */
 	bool save_config = false;
 	AfterNewGRFScan *scanner = new AfterNewGRFScan(&save_config);
@@ -659,6 +667,14 @@ int ttd_main(int argc, char *argv[])
 
 			return 0;
 		}
+		case 'Y':
+			if (strncmp(mgo.opt, "record:", 7) == 0 || strncmp(mgo.opt, "replay:", 7) == 0) {
+				pf_query_replay = mgo.opt[2] == 'p';
+				pf_query_log = mgo.opt + 7;
+			} else {
+				i = -2; // Force printing of help.
+			}
+			break;
 		case 'G': scanner->generation_seed = atoi(mgo.opt); break;
 		case 'c': _config_file = strdup(mgo.opt); break;
 		case 'x': scanner->save_config = false; break;
@@ -690,6 +706,10 @@ int ttd_main(int argc, char *argv[])
 	SetDebugString("4");
 #endif
 
+	if (pf_query_log != NULL && !StartPathfinderQueryLog(pf_query_log, pf_query_replay)) {
+		usererror("Failed to open pathfinder query log '%s'", pf_query_log);
+	}
+
 	DeterminePaths(argv[0]);
 	TarScanner::DoScan(TarScanner::BASESET);
 
@@ -855,6 +875,8 @@ int ttd_main(int argc, char *argv[])
 
 	_video_driver->MainLoop();
 
+	StopPathfinderQueryLog();
+
 	WaitTillSaved();
 
 	/* only save config if we have to */
@@ -1320,8 +1342,10 @@ static void CheckCaches()
 		for (CargoID c = 0; c < NUM_CARGO; c++) {
 			byte buff[sizeof(StationCargoList)];
 			memcpy(buff, &st->goods[c].cargo, sizeof(StationCargoList));
+			StationCargoList::OrderMap counts = st->goods[c].cargo.CountForNextHop();
 			st->goods[c].cargo.InvalidateCache();
 			assert(memcmp(&st->goods[c].cargo, buff, sizeof(StationCargoList)) == 0);
+			assert(counts == st->goods[c].cargo.CountForNextHop());
 		}
 	}
 }
@@ -1373,6 +1397,14 @@ void StateGameLoop()
 		IncreaseDate();
 		RunTileLoop();
 		CallVehicleTicks();
+		/* Vehicles arriving at a station queue next hop updates during their
+		 * tick, but only load at the start of the next CallVehicleTicks. Run
+		 * the updates now, so the loading sees them and no jobs are left
+		 * over between ticks, i.e. in savegames. */
+		RunCargoRoutingJobs();
+		/* The demand links are updated in slices by the date, so they have
+		 * to be run every tick, even if the landscape ticks are skipped. */
+		OnTick_CargoLinks();
 //		CallLandscapeTick();
 		_tick_skip_counter++;
 		if ( _tick_skip_counter == _settings_game.economy.slow_down_production )
@@ -1390,6 +1422,8 @@ void StateGameLoop()
 
 		CallWindowTickEvent();
 		NewsLoop();
+		ResetRouteTableMemo();
+		FinishCargodestPerfTick();
 		cur_company.Restore();
 	}
 
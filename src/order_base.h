@@ -15,6 +15,7 @@
 #include "order_type.h"
 #include "core/pool_type.hpp"
 #include "core/bitmath_func.hpp"
+#include "core/smallvec_type.hpp"
 #include "cargo_type.h"
 #include "depot_type.h"
 #include "station_type.h"
@@ -249,6 +250,7 @@ private:
 	int GetNumRunningVehicles();
 
 	Order *first;                     ///< First order of the order list.
+	SmallVector<Order *, 16> orders;  ///< NOSAVE: The orders of the list by index, for constant time access.
 	VehicleOrderID num_orders;        ///< NOSAVE: How many orders there are in the list.
 	VehicleOrderID num_manual_orders; ///< NOSAVE: How many manually added orders are there in the list.
 	uint num_vehicles;                ///< NOSAVE: Number of vehicles that share this order list.
@@ -287,7 +289,16 @@ public:
 	 */
 	inline Order *GetFirstOrder() const { return this->first; }
 
-	Order *GetOrderAt(int index) const;
+	/**
+	 * Get a certain order of the order chain.
+	 * @param index zero-based index of the order within the chain.
+	 * @return the order at position index, or \c NULL if there is none.
+	 */
+	inline Order *GetOrderAt(int index) const
+	{
+		if (index < 0 || (uint)index >= this->orders.Length()) return NULL;
+		return this->orders[index];
+	}
 
 	/**
 	 * Get the last order of the order chain.
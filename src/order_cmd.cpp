@@ -33,6 +33,7 @@
 #include "infrastructure_func.h"
 #include "order_backup.h"
 #include "cargodest_func.h"
+#include "departures_func.h"
 
 #include "table/strings.h"
 
@@ -337,8 +338,11 @@ void OrderList::Initialize(Order *chain, Vehicle *v)
 	this->num_manual_orders = 0;
 	this->num_vehicles = 1;
 	this->timetable_duration = 0;
+	this->orders.Clear();
+	InvalidateDepartureIndex();
 
 	for (Order *o = this->first; o != NULL; o = o->next) {
+		*this->orders.Append() = o;
 		++this->num_orders;
 		if (!o->IsType(OT_IMPLICIT)) ++this->num_manual_orders;
 		this->timetable_duration += o->wait_time + o->travel_time;
@@ -364,9 +368,11 @@ void OrderList::FreeChain(bool keep_orderlist)
 		next = o->next;
 		delete o;
 	}
+	InvalidateDepartureIndex();
 
 	if (keep_orderlist) {
 		this->first = NULL;
+		this->orders.Clear();
 		this->num_orders = 0;
 		this->num_manual_orders = 0;
 		this->timetable_duration = 0;
@@ -375,23 +381,6 @@ void OrderList::FreeChain(bool keep_orderlist)
 	}
 }
 
-/**
- * Get a certain order of the order chain.
- * @param index zero-based index of the order within the chain.
- * @return the order at position index.
- */
-Order *OrderList::GetOrderAt(int index) const
-{
-	if (index < 0) return NULL;
-
-	Order *order = this->first;
-
-	while (order != NULL && index-- > 0) {
-		order = order->next;
-	}
-	return order;
-}
-
 /**
  * Insert a new order into the order chain.
  * @param new_order is the order to insert into the chain.
@@ -399,24 +388,22 @@ Order *OrderList::GetOrderAt(int index) const
  */
 void OrderList::InsertOrderAt(Order *new_order, int index)
 {
-	if (this->first == NULL) {
+	/* index is after the last order, add it to the end */
+	if (index > this->num_orders) index = this->num_orders;
+
+	if (index == 0) {
+		/* Insert as first or only order */
+		new_order->next = this->first;
 		this->first = new_order;
 	} else {
-		if (index == 0) {
-			/* Insert as first or only order */
-			new_order->next = this->first;
-			this->first = new_order;
-		} else if (index >= this->num_orders) {
-			/* index is after the last order, add it to the end */
-			this->GetLastOrder()->next = new_order;
-		} else {
-			/* Put the new order in between */
-			Order *order = this->GetOrderAt(index - 1);
-			new_order->next = order->next;
-			order->next = new_order;
-		}
+		/* Put the new order after the one before it */
+		Order *order = this->orders[index - 1];
+		new_order->next = order->next;
+		order->next = new_order;
 	}
+	*this->orders.Insert(this->orders.Begin() + index) = new_order;
 	++this->num_orders;
+	InvalidateDepartureIndex();
 	if (!new_order->IsType(OT_IMPLICIT)) ++this->num_manual_orders;
 	this->timetable_duration += new_order->wait_time + new_order->travel_time;
 
@@ -438,17 +425,16 @@ void OrderList::DeleteOrderAt(int index)
 {
 	if (index >= this->num_orders) return;
 
-	Order *to_remove;
+	Order *to_remove = this->orders[index];
 
 	if (index == 0) {
-		to_remove = this->first;
 		this->first = to_remove->next;
 	} else {
-		Order *prev = GetOrderAt(index - 1);
-		to_remove = prev->next;
-		prev->next = to_remove->next;
+		this->orders[index - 1]->next = to_remove->next;
 	}
+	this->orders.ErasePreservingOrder(index);
 	--this->num_orders;
+	InvalidateDepartureIndex();
 	if (!to_remove->IsType(OT_IMPLICIT)) --this->num_manual_orders;
 	this->timetable_duration -= (to_remove->wait_time + to_remove->travel_time);
 	delete to_remove;
@@ -463,27 +449,26 @@ void OrderList::MoveOrder(int from, int to)
 {
 	if (from >= this->num_orders || to >= this->num_orders || from == to) return;
 
-	Order *moving_one;
+	Order *moving_one = this->orders[from];
 
 	/* Take the moving order out of the pointer-chain */
 	if (from == 0) {
-		moving_one = this->first;
 		this->first = moving_one->next;
 	} else {
-		Order *one_before = GetOrderAt(from - 1);
-		moving_one = one_before->next;
-		one_before->next = moving_one->next;
+		this->orders[from - 1]->next = moving_one->next;
 	}
+	this->orders.ErasePreservingOrder(from);
 
 	/* Insert the moving_order again in the pointer-chain */
 	if (to == 0) {
 		moving_one->next = this->first;
 		this->first = moving_one;
 	} else {
-		Order *one_before = GetOrderAt(to - 1);
+		Order *one_before = this->orders[to - 1];
 		moving_one->next = one_before->next;
 		one_before->next = moving_one;
 	}
+	*this->orders.Insert(this->orders.Begin() + to) = moving_one;
 }
 
 /**
@@ -1539,10 +1524,12 @@ CommandCost CmdModifyOrder(TileIndex tile, DoCommandFlag flags, uint32 p1, uint3
 
 			case MOF_UNLOAD:
 				order->SetUnloadType((OrderUnloadFlags)data);
+				InvalidateRouteTables();
 				break;
 
 			case MOF_LOAD:
 				order->SetLoadType((OrderLoadFlags)data);
+				InvalidateRouteTables();
 				if (data & OLFB_NO_LOAD) order->SetRefit(CT_NO_REFIT);
 				break;
 
@@ -7,7 +7,7 @@
  * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
  */
 
-/** @file os_timer.cpp OS/compiler dependant real time tick sampling. */
+/** @file os_timer.cpp OS/compiler dependant real time tick sampling and monotonic clock. */
 
 #include "stdafx.h"
 
@@ -74,3 +74,55 @@ uint64 ottd_rdtsc()
 # endif
 uint64 ottd_rdtsc() {return 0;}
 #endif
+
+#undef MONOTONIC_AVAILABLE
+
+/* Monotonic clock for Windows, from the performance counter */
+#if defined(WIN32) && !defined(MONOTONIC_AVAILABLE)
+#include <windows.h>
+uint64 ottd_monotonic_ns()
+{
+	static LARGE_INTEGER frequency = {{0, 0}};
+	if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	/* Split the conversion so the multiplication can't overflow. */
+	return (uint64)(counter.QuadPart / frequency.QuadPart) * 1000000000 + (uint64)(counter.QuadPart % frequency.QuadPart) * 1000000000 / frequency.QuadPart;
+}
+# define MONOTONIC_AVAILABLE
+#endif
+
+/* Monotonic clock for OS X, which has no clock_gettime() */
+#if defined(__APPLE__) && !defined(MONOTONIC_AVAILABLE)
+#include <mach/mach_time.h>
+uint64 ottd_monotonic_ns()
+{
+	static mach_timebase_info_data_t timebase = {0, 0};
+	if (timebase.denom == 0) mach_timebase_info(&timebase);
+
+	return mach_absolute_time() * timebase.numer / timebase.denom;
+}
+# define MONOTONIC_AVAILABLE
+#endif
+
+/* Monotonic clock for POSIX systems */
+#include <time.h>
+#if defined(CLOCK_MONOTONIC) && !defined(MONOTONIC_AVAILABLE)
+uint64 ottd_monotonic_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+# define MONOTONIC_AVAILABLE
+#endif
+
+/* In all other cases fall back to the processor time used by the game,
+ * which has a much lower resolution. */
+#if !defined(MONOTONIC_AVAILABLE)
+uint64 ottd_monotonic_ns()
+{
+	return (uint64)clock() * 1000000000 / CLOCKS_PER_SEC;
+}
+#endif
@@ -34,7 +34,7 @@
  */
 PathNode *AyStar::ClosedListIsInList(const AyStarNode *node)
 {
-	return (PathNode*)this->closedlist_hash.Get(node->tile, node->direction);
+	return this->closedlist_hash.Find(node->tile, node->direction);
 }
 
 /**
@@ -45,9 +45,9 @@ PathNode *AyStar::ClosedListIsInList(const AyStarNode *node)
 void AyStar::ClosedListAdd(const PathNode *node)
 {
 	/* Add a node to the ClosedList */
-	PathNode *new_node = MallocT<PathNode>(1);
+	PathNode *new_node = this->closedlist_nodes.Append();
 	*new_node = *node;
-	this->closedlist_hash.Set(node->node.tile, node->node.direction, new_node);
+	this->closedlist_hash.Set(new_node);
 }
 
 /**
@@ -57,7 +57,7 @@ void AyStar::ClosedListAdd(const PathNode *node)
  */
 OpenListNode *AyStar::OpenListIsInList(const AyStarNode *node)
 {
-	return (OpenListNode*)this->openlist_hash.Get(node->tile, node->direction);
+	return this->openlist_hash.Find(node->tile, node->direction);
 }
 
 /**
@@ -68,9 +68,9 @@ OpenListNode *AyStar::OpenListIsInList(const AyStarNode *node)
 OpenListNode *AyStar::OpenListPop()
 {
 	/* Return the item the Queue returns.. the best next OpenList item. */
-	OpenListNode *res = (OpenListNode*)this->openlist_queue.Pop();
+	OpenListNode *res = this->openlist_queue.Pop();
 	if (res != NULL) {
-		this->openlist_hash.DeleteValue(res->path.node.tile, res->path.node.direction);
+		this->openlist_hash.Remove(res->path.node.tile, res->path.node.direction);
 	}
 
 	return res;
@@ -83,11 +83,12 @@ OpenListNode *AyStar::OpenListPop()
 void AyStar::OpenListAdd(PathNode *parent, const AyStarNode *node, int f, int g)
 {
 	/* Add a new Node to the OpenList */
-	OpenListNode *new_node = MallocT<OpenListNode>(1);
+	OpenListNode *new_node = this->openlist_nodes.Append();
 	new_node->g = g;
 	new_node->path.parent = parent;
 	new_node->path.node = *node;
-	this->openlist_hash.Set(node->tile, node->direction, new_node);
+	new_node->heap_index = 0;
+	this->openlist_hash.Set(new_node);
 
 	/* Add it to the queue */
 	this->openlist_queue.Push(new_node, f);
@@ -133,7 +134,7 @@ void AyStar::CheckTile(AyStarNode *current, OpenListNode *parent)
 		uint i;
 		/* Yes, check if this g value is lower.. */
 		if (new_g > check->g) return;
-		this->openlist_queue.Delete(check, 0);
+		this->openlist_queue.Remove(check);
 		/* It is lower, so change it to this item */
 		check->g = new_g;
 		check->path.parent = closedlist_parent;
@@ -172,7 +173,6 @@ int AyStar::Loop()
 		if (this->FoundEndNode != NULL) {
 			this->FoundEndNode(this, current);
 		}
-		free(current);
 		return AYSTAR_FOUND_END_NODE;
 	}
 
@@ -188,9 +188,6 @@ int AyStar::Loop()
 		this->CheckTile(&this->neighbours[i], current);
 	}
 
-	/* Free the node */
-	free(current);
-
 	if (this->max_search_nodes != 0 && this->closedlist_hash.GetSize() >= this->max_search_nodes) {
 		/* We've expanded enough nodes */
 		return AYSTAR_LIMIT_REACHED;
@@ -205,11 +202,11 @@ int AyStar::Loop()
  */
 void AyStar::Free()
 {
-	this->openlist_queue.Free(false);
-	/* 2nd argument above is false, below is true, to free the values only
-	 * once */
-	this->openlist_hash.Delete(true);
-	this->closedlist_hash.Delete(true);
+	this->openlist_queue.Free();
+	this->openlist_hash.Free();
+	this->openlist_nodes.Free();
+	this->closedlist_hash.Free();
+	this->closedlist_nodes.Free();
 #ifdef AYSTAR_DEBUG
 	printf("[AyStar] Memory free'd\n");
 #endif
@@ -221,12 +218,12 @@ void AyStar::Free()
  */
 void AyStar::Clear()
 {
-	/* Clean the Queue, but not the elements within. That will be done by
-	 * the hash. */
-	this->openlist_queue.Clear(false);
-	/* Clean the hashes */
-	this->openlist_hash.Clear(true);
-	this->closedlist_hash.Clear(true);
+	/* Empty the lists, but keep their memory for the next search. */
+	this->openlist_queue.Clear();
+	this->openlist_hash.Clear();
+	this->openlist_nodes.Clear();
+	this->closedlist_hash.Clear();
+	this->closedlist_nodes.Clear();
 
 #ifdef AYSTAR_DEBUG
 	printf("[AyStar] Cleared AyStar\n");
@@ -258,6 +255,7 @@ int AyStar::Main()
 #endif
 	if (r != AYSTAR_STILL_BUSY) {
 		/* We're done, clean up */
+		this->expanded_nodes = this->closedlist_hash.GetSize();
 		this->Clear();
 	}
 
@@ -289,16 +287,18 @@ void AyStar::AddStartNode(AyStarNode *start_node, uint g)
 /**
  * Initialize an #AyStar. You should fill all appropriate fields before
  * calling #Init (see the declaration of #AyStar for which fields are internal).
+ * @param hash_bits Number of bits of the hashes of the open and closed list.
  */
-void AyStar::Init(Hash_HashProc hash, uint num_buckets)
+void AyStar::Init(uint hash_bits)
 {
 	/* Allocated the Hash for the OpenList and ClosedList */
-	this->openlist_hash.Init(hash, num_buckets);
-	this->closedlist_hash.Init(hash, num_buckets);
+	this->openlist_hash.Init(hash_bits);
+	this->closedlist_hash.Init(hash_bits);
+	this->openlist_nodes.Init();
+	this->closedlist_nodes.Init();
 
 	/* Set up our sorting queue
-	 *  BinaryHeap allocates a block of 1024 nodes
-	 *  When that one gets full it reserves another one, till this number
+	 *  The heap grows its memory when needed, till this number
 	 *  That is why it can stay this high */
 	this->openlist_queue.Init(102400);
 }
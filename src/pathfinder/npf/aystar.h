@@ -46,7 +46,10 @@ struct AyStarNode {
 /** A path of nodes. */
 struct PathNode {
 	AyStarNode node;
-	PathNode *parent; ///< The parent of this item.
+	PathNode *parent;    ///< The parent of this item.
+	PathNode *hash_next; ///< Next node in the same bucket of the closed list.
+
+	inline const AyStarNode &GetKey() const { return this->node; }
 };
 
 /**
@@ -57,6 +60,10 @@ struct PathNode {
 struct OpenListNode {
 	int g;
 	PathNode path;
+	OpenListNode *hash_next; ///< Next node in the same bucket of the open list.
+	uint heap_index;         ///< Position in the open queue, 0 if not queued.
+
+	inline const AyStarNode &GetKey() const { return this->path.node; }
 };
 
 struct AyStar;
@@ -144,7 +151,9 @@ struct AyStar {
 	AyStarNode neighbours[12];
 	byte num_neighbours;
 
-	void Init(Hash_HashProc hash, uint num_buckets);
+	uint expanded_nodes; ///< Number of nodes in the closed list when the last search finished.
+
+	void Init(uint hash_bits);
 
 	/* These will contain the methods for manipulating the AyStar. Only
 	 * Main() should be called externally */
@@ -156,9 +165,11 @@ struct AyStar {
 	void CheckTile(AyStarNode *current, OpenListNode *parent);
 
 protected:
-	Hash       closedlist_hash; ///< The actual closed list.
-	BinaryHeap openlist_queue;  ///< The open queue.
-	Hash       openlist_hash;   ///< An extra hash to speed up the process of looking up an element in the open list.
+	NodeHashT<PathNode>       closedlist_hash;  ///< The actual closed list.
+	NodePoolT<PathNode>       closedlist_nodes; ///< Storage of the nodes in the closed list.
+	BinaryHeapT<OpenListNode> openlist_queue;   ///< The open queue.
+	NodeHashT<OpenListNode>   openlist_hash;    ///< An extra hash to speed up the process of looking up an element in the open list.
+	NodePoolT<OpenListNode>   openlist_nodes;   ///< Storage of the nodes in the open list.
 
 	void OpenListAdd(PathNode *parent, const AyStarNode *node, int f, int g);
 	OpenListNode *OpenListIsInList(const AyStarNode *node);
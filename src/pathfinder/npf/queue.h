@@ -7,105 +7,301 @@
  * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
  */
 
-/** @file queue.h Binary heap implementation, hash implementation. */
+/** @file queue.h Binary heap, hash and node storage for %AyStar. */
 
 #ifndef QUEUE_H
 #define QUEUE_H
 
-//#define HASH_STATS
-
-
-struct BinaryHeapNode {
-	void *item;
-	int priority;
-};
+#include "../../core/alloc_func.hpp"
+#include "../../core/math_func.hpp"
+#include "../../core/mem_func.hpp"
+#include "../../tile_type.h"
+#include "../../track_type.h"
 
+/*
+ * All containers below are plain structs without constructors, so they can
+ * be part of a static or zeroed #AyStar. Call Init() before and Free() after
+ * use; Clear() empties them but keeps the memory for the next search.
+ */
 
 /**
- * Binary Heap.
+ * Binary heap of items ordered by priority, lowest first.
  * For information, see: http://www.policyalmanac.org/games/binaryHeaps.htm
+ *
+ * The heap doesn't own the items. Each item keeps its position in the heap
+ * in its \c heap_index member (0 when not in the heap), so it can be removed
+ * without searching for it.
+ * @tparam Titem Type of the items.
  */
-struct BinaryHeap {
-	static const int BINARY_HEAP_BLOCKSIZE;
-	static const int BINARY_HEAP_BLOCKSIZE_BITS;
-	static const int BINARY_HEAP_BLOCKSIZE_MASK;
+template <class Titem>
+struct BinaryHeapT {
+	/** Element of the heap. */
+	struct Node {
+		Titem *item;  ///< The item.
+		int priority; ///< Its priority.
+	};
 
-	void Init(uint max_size);
+	Node *elements; ///< The elements; elements[1] is the first one, elements[0] is unused.
+	uint size;      ///< Number of items in the heap.
+	uint capacity;  ///< Number of items the allocated memory can hold.
+	uint max_size;  ///< Maximum number of items in the heap.
 
-	bool Push(void *item, int priority);
-	void *Pop();
-	bool Delete(void *item, int priority);
-	void Clear(bool free_values);
-	void Free(bool free_values);
+	/**
+	 * Initialize an empty heap.
+	 * @param max_size Maximum number of items; more items are refused.
+	 */
+	void Init(uint max_size)
+	{
+		this->elements = NULL;
+		this->size = 0;
+		this->capacity = 0;
+		this->max_size = max_size;
+	}
+
+	/** Free the memory of the heap. */
+	void Free()
+	{
+		free(this->elements);
+		this->Init(this->max_size);
+	}
+
+	/** Remove all items, but keep the memory. */
+	inline void Clear()
+	{
+		this->size = 0;
+	}
 
 	/**
-	 * Get an element from the #elements.
-	 * @param i Element to access (starts at offset \c 1).
-	 * @return Value of the element.
+	 * Add an item.
+	 * @param item The item.
+	 * @param priority Its priority.
+	 * @return False if the heap is full.
 	 */
-	inline BinaryHeapNode &GetElement(uint i)
+	bool Push(Titem *item, int priority)
 	{
-		assert(i > 0);
-		return this->elements[(i - 1) >> BINARY_HEAP_BLOCKSIZE_BITS][(i - 1) & BINARY_HEAP_BLOCKSIZE_MASK];
+		if (this->size == this->max_size) return false;
+
+		if (this->size == this->capacity) {
+			this->capacity = max(64U, this->capacity * 2);
+			this->elements = ReallocT(this->elements, this->capacity + 1);
+		}
+
+		/* Add the item at the end of the array, and move it up as long as
+		 * the parent isn't smaller. */
+		uint i = ++this->size;
+		while (i > 1 && priority <= this->elements[i / 2].priority) {
+			this->Move(i / 2, i);
+			i /= 2;
+		}
+		this->Set(i, item, priority);
+		return true;
 	}
 
-	uint max_size;
-	uint size;
-	uint blocks; ///< The amount of blocks for which space is reserved in elements
-	BinaryHeapNode **elements;
-};
+	/**
+	 * Remove an item.
+	 * @param item The item.
+	 * @return False if the item wasn't in the heap.
+	 */
+	bool Remove(Titem *item)
+	{
+		uint i = item->heap_index;
+		if (i == 0) return false;
+		item->heap_index = 0;
 
+		/* Put the last item in the gap and move it down as long as one of
+		 * its children is not bigger. */
+		Node last = this->elements[this->size--];
+		if (i > this->size) return true;
 
-/*
- * Hash
- */
-struct HashNode {
-	uint key1;
-	uint key2;
-	void *value;
-	HashNode *next;
+		for (;;) {
+			uint child = 2 * i;
+			if (child > this->size) break;
+			if (child < this->size && this->elements[child].priority >= this->elements[child + 1].priority) child++;
+			if (last.priority < this->elements[child].priority) break;
+			this->Move(child, i);
+			i = child;
+		}
+		this->Set(i, last.item, last.priority);
+		return true;
+	}
+
+	/**
+	 * Remove the item with the lowest priority.
+	 * @return The item, or \c NULL if the heap is empty.
+	 */
+	inline Titem *Pop()
+	{
+		if (this->size == 0) return NULL;
+
+		Titem *result = this->elements[1].item;
+		this->Remove(result);
+		return result;
+	}
+
+private:
+	/** Put an item at a position. */
+	inline void Set(uint i, Titem *item, int priority)
+	{
+		this->elements[i].item = item;
+		this->elements[i].priority = priority;
+		item->heap_index = i;
+	}
+
+	/** Move the item at one position to another. */
+	inline void Move(uint from, uint to)
+	{
+		this->Set(to, this->elements[from].item, this->elements[from].priority);
+	}
 };
+
 /**
- * Generates a hash code from the given key pair. You should make sure that
- * the resulting range is clearly defined.
+ * Hash of nodes by tile and direction.
+ * The nodes are chained through their \c hash_next member; \c GetKey() has to
+ * return the #AyStarNode with the tile and direction.
+ * @tparam Titem Type of the nodes.
  */
-typedef uint Hash_HashProc(uint key1, uint key2);
-struct Hash {
-	/* The hash function used */
-	Hash_HashProc *hash;
-	/* The amount of items in the hash */
-	uint size;
-	/* The number of buckets allocated */
-	uint num_buckets;
-	/* A pointer to an array of num_buckets buckets. */
-	HashNode *buckets;
-	/* A pointer to an array of numbuckets booleans, which will be true if
-	 * there are any Nodes in the bucket */
-	bool *buckets_in_use;
-
-	void Init(Hash_HashProc *hash, uint num_buckets);
-
-	void *Get(uint key1, uint key2) const;
-	void *Set(uint key1, uint key2, void *value);
-
-	void *DeleteValue(uint key1, uint key2);
-
-	void Clear(bool free_values);
-	void Delete(bool free_values);
+template <class Titem>
+struct NodeHashT {
+	Titem **buckets; ///< First node of each bucket.
+	uint bits;       ///< Number of bits of the hash; there are 2^bits buckets.
+	uint size;       ///< Number of nodes in the hash.
 
 	/**
-	 * Gets the current size of the hash.
+	 * Initialize an empty hash.
+	 * @param bits Number of bits of the hash.
 	 */
+	void Init(uint bits)
+	{
+		assert(bits > 0 && bits < 32);
+		this->bits = bits;
+		this->size = 0;
+		this->buckets = CallocT<Titem *>(1 << bits);
+	}
+
+	/** Free the memory of the hash. */
+	void Free()
+	{
+		free(this->buckets);
+		this->buckets = NULL;
+		this->size = 0;
+	}
+
+	/** Remove all nodes, but keep the memory. */
+	inline void Clear()
+	{
+		if (this->size != 0) MemSetT(this->buckets, 0, 1 << this->bits);
+		this->size = 0;
+	}
+
+	/** Get the number of nodes in the hash. */
 	inline uint GetSize() const
 	{
 		return this->size;
 	}
 
-protected:
-#ifdef HASH_STATS
-	void PrintStatistics() const;
-#endif
-	HashNode *FindNode(uint key1, uint key2, HashNode** prev_out) const;
+	/**
+	 * Find the node of a tile and direction.
+	 * @return The node, or \c NULL if there is none.
+	 */
+	inline Titem *Find(TileIndex tile, Trackdir direction) const
+	{
+		for (Titem *item = this->buckets[this->Hash(tile, direction)]; item != NULL; item = item->hash_next) {
+			if (item->GetKey().tile == tile && item->GetKey().direction == direction) return item;
+		}
+		return NULL;
+	}
+
+	/**
+	 * Add a node; it replaces the node with the same tile and direction.
+	 * @param new_item The node.
+	 */
+	void Set(Titem *new_item)
+	{
+		Titem **link = &this->buckets[this->Hash(new_item->GetKey().tile, new_item->GetKey().direction)];
+		for (Titem *item = *link; item != NULL; link = &item->hash_next, item = *link) {
+			if (item->GetKey().tile == new_item->GetKey().tile && item->GetKey().direction == new_item->GetKey().direction) {
+				new_item->hash_next = item->hash_next;
+				*link = new_item;
+				return;
+			}
+		}
+		new_item->hash_next = NULL;
+		*link = new_item;
+		this->size++;
+	}
+
+	/**
+	 * Remove the node of a tile and direction.
+	 * @return The removed node, or \c NULL if there was none.
+	 */
+	Titem *Remove(TileIndex tile, Trackdir direction)
+	{
+		Titem **link = &this->buckets[this->Hash(tile, direction)];
+		for (Titem *item = *link; item != NULL; link = &item->hash_next, item = *link) {
+			if (item->GetKey().tile == tile && item->GetKey().direction == direction) {
+				*link = item->hash_next;
+				this->size--;
+				return item;
+			}
+		}
+		return NULL;
+	}
+
+private:
+	/** Calculate the bucket of a tile and direction. */
+	inline uint Hash(TileIndex tile, Trackdir direction) const
+	{
+		return ((tile << 4) ^ direction) * 0x9E3779B1U >> (32 - this->bits);
+	}
+};
+
+/**
+ * Storage for nodes that keeps their addresses while more nodes are added.
+ * @tparam Titem Type of the nodes.
+ */
+template <class Titem>
+struct NodePoolT {
+	static const uint BLOCK_BITS = 10; ///< log2 of the number of nodes allocated at a time.
+
+	Titem **blocks;  ///< The allocated blocks of nodes.
+	uint num_blocks; ///< Number of allocated blocks.
+	uint used;       ///< Number of nodes in use.
+
+	/** Initialize an empty pool. */
+	void Init()
+	{
+		this->blocks = NULL;
+		this->num_blocks = 0;
+		this->used = 0;
+	}
+
+	/** Free the memory of the pool. */
+	void Free()
+	{
+		for (uint i = 0; i < this->num_blocks; i++) free(this->blocks[i]);
+		free(this->blocks);
+		this->Init();
+	}
+
+	/** Forget all nodes, but keep the memory. */
+	inline void Clear()
+	{
+		this->used = 0;
+	}
+
+	/**
+	 * Get storage for a new node.
+	 * @return The uninitialized node.
+	 */
+	inline Titem *Append()
+	{
+		uint block = this->used >> BLOCK_BITS;
+		if (block == this->num_blocks) {
+			this->blocks = ReallocT(this->blocks, this->num_blocks + 1);
+			this->blocks[this->num_blocks++] = MallocT<Titem>(1 << BLOCK_BITS);
+		}
+		return &this->blocks[block][this->used++ & ((1 << BLOCK_BITS) - 1)];
+	}
 };
 
 #endif /* QUEUE_H */
@@ -14,6 +14,7 @@
 
 #include "../debug.h"
 
+/** Accumulating timer measuring wall clock time with the monotonic clock. */
 struct CPerformanceTimer
 {
 	int64    m_start;
@@ -38,12 +39,12 @@ struct CPerformanceTimer
 
 	inline int64 QueryTime()
 	{
-		return ottd_rdtsc();
+		return ottd_monotonic_ns();
 	}
 
 	inline int64 QueryFrequency()
 	{
-		return ((int64)2200 * 1000000);
+		return (int64)1000000000;
 	}
 };
 
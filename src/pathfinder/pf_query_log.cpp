@@ -0,0 +1,303 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file pf_query_log.cpp Recording and replaying of the path searches of vehicles. */
+
+#include "../stdafx.h"
+#include "../openttd.h"
+#include "../date_func.h"
+#include "../vehicle_base.h"
+#include "../core/smallvec_type.hpp"
+#include "pf_query_log.h"
+
+/** First line of a query log. */
+static const char * const PF_QUERY_LOG_HEADER = "OpenTTD pathfinder query log 1\n";
+
+static const uint MAX_REPORTED_DIFFS = 20; ///< Number of differing answers and of unmatched searches that are reported individually.
+
+/** One logged path search. */
+struct PathfinderQueryRecord {
+	/* When and what was asked. */
+	Date date;             ///< Date of the search.
+	uint date_fract;       ///< Tick within the day of the search.
+	uint type;             ///< #PathfinderQueryType of the search.
+	TileIndex tile;        ///< Tile the search starts at.
+	uint dir;              ///< Direction the search starts in.
+
+	/* Snapshot of the vehicle. */
+	VehicleID veh;         ///< Vehicle searching.
+	TileIndex veh_tile;    ///< Tile of the vehicle.
+	TileIndex dest_tile;   ///< Destination tile of the vehicle.
+	uint order_type;       ///< Type of the current order.
+	uint order_dest;       ///< Destination of the current order.
+
+	/* The answer. */
+	uint32 result;         ///< Chosen track or found depot.
+	uint found;            ///< 1 if a path was found.
+	int64 time;            ///< Duration in nanoseconds.
+
+	/**
+	 * Is the same question asked by the same vehicle in the same state?
+	 * @param other The other search.
+	 * @return True if the questions are equal.
+	 */
+	bool IsSameQuery(const PathfinderQueryRecord &other) const
+	{
+		return this->date == other.date && this->date_fract == other.date_fract && this->type == other.type &&
+				this->tile == other.tile && this->dir == other.dir && this->veh == other.veh &&
+				this->veh_tile == other.veh_tile && this->dest_tile == other.dest_tile &&
+				this->order_type == other.order_type && this->order_dest == other.order_dest;
+	}
+
+	/**
+	 * Was this search made in an earlier tick than another one?
+	 * @param other The other search.
+	 * @return True if this search is earlier.
+	 */
+	bool IsEarlierThan(const PathfinderQueryRecord &other) const
+	{
+		return this->date < other.date || (this->date == other.date && this->date_fract < other.date_fract);
+	}
+};
+
+/** Totals of one kind of search. */
+struct PathfinderQueryTotals {
+	uint64 calls;         ///< Number of searches.
+	uint64 time;          ///< Time of the searches in nanoseconds.
+	uint64 compared_time; ///< Time of the searches compared with the log, while replaying.
+	uint64 recorded_time; ///< Time of the compared searches in the log, while replaying.
+};
+
+bool _pf_query_log_active = false; ///< Is a query log recorded or replayed?
+
+static FILE *_pf_query_log = NULL;                    ///< The log file.
+static bool _pf_query_replay;                         ///< Is the log replayed instead of recorded?
+static PathfinderQueryTotals _pf_query_totals[PFQ_END]; ///< Totals by kind of search.
+static uint64 _pf_query_diffs;                        ///< Number of replayed searches with a different answer.
+static uint64 _pf_query_unlogged;                     ///< Number of replayed searches that aren't in the log.
+static uint64 _pf_query_unreplayed;                   ///< Number of logged searches that weren't replayed.
+static SmallVector<PathfinderQueryRecord, 16> _pf_query_pending; ///< Logged searches of the tick being replayed that weren't matched yet.
+static PathfinderQueryRecord _pf_query_next;          ///< Next logged search after the pending ones.
+static bool _pf_query_next_valid;                     ///< Is #_pf_query_next read from the log?
+
+/** Names of the kinds of searches. */
+static const char * const _pf_query_names[] = {
+	"train track",
+	"train depot",
+	"road track",
+	"road depot",
+	"ship track",
+};
+assert_compile(lengthof(_pf_query_names) == PFQ_END);
+
+/**
+ * Read the next search from the log.
+ * @param[out] q The search.
+ * @return False at the end of the log.
+ */
+static bool ReadPathfinderQuery(PathfinderQueryRecord *q)
+{
+	char line[256];
+	if (fgets(line, sizeof(line), _pf_query_log) == NULL) return false;
+
+	return sscanf(line, "%d %u %u %u %u %u %u %u %u %u %u %u " OTTD_PRINTF64,
+			&q->date, &q->date_fract, &q->type, &q->tile, &q->dir, &q->veh, &q->veh_tile, &q->dest_tile,
+			&q->order_type, &q->order_dest, &q->result, &q->found, &q->time) == 13 && q->type < PFQ_END;
+}
+
+/**
+ * Collect the logged searches of the tick of a replayed search in #_pf_query_pending.
+ * Logged searches of earlier ticks that weren't matched are counted as not replayed.
+ * @param q The replayed search.
+ */
+static void FetchLoggedQueries(const PathfinderQueryRecord &q)
+{
+	if (_pf_query_pending.Length() > 0 && _pf_query_pending[0].IsEarlierThan(q)) {
+		_pf_query_unreplayed += _pf_query_pending.Length();
+		_pf_query_pending.Clear();
+	}
+
+	for (;;) {
+		if (!_pf_query_next_valid) {
+			_pf_query_next_valid = ReadPathfinderQuery(&_pf_query_next);
+			if (!_pf_query_next_valid) return;
+		}
+		if (q.IsEarlierThan(_pf_query_next)) return;
+
+		if (_pf_query_next.IsEarlierThan(q)) {
+			_pf_query_unreplayed++;
+		} else {
+			*_pf_query_pending.Append() = _pf_query_next;
+		}
+		_pf_query_next_valid = false;
+	}
+}
+
+/**
+ * Write a search to the log.
+ * @param q The search.
+ */
+static void WritePathfinderQuery(const PathfinderQueryRecord &q)
+{
+	fprintf(_pf_query_log, "%d %u %u %u %u %u %u %u %u %u %u %u " OTTD_PRINTF64 "\n",
+			q.date, q.date_fract, q.type, q.tile, q.dir, q.veh, q.veh_tile, q.dest_tile,
+			q.order_type, q.order_dest, q.result, q.found, q.time);
+}
+
+/**
+ * Start recording or replaying a query log.
+ * @param filename The log file.
+ * @param replay True to replay the log, false to record it.
+ * @return False if the log couldn't be opened.
+ */
+bool StartPathfinderQueryLog(const char *filename, bool replay)
+{
+	assert(_pf_query_log == NULL);
+
+	_pf_query_log = fopen(filename, replay ? "r" : "w");
+	if (_pf_query_log == NULL) return false;
+
+	if (replay) {
+		char line[64];
+		if (fgets(line, sizeof(line), _pf_query_log) == NULL || strcmp(line, PF_QUERY_LOG_HEADER) != 0) {
+			fclose(_pf_query_log);
+			_pf_query_log = NULL;
+			return false;
+		}
+	} else {
+		fputs(PF_QUERY_LOG_HEADER, _pf_query_log);
+	}
+
+	_pf_query_replay = replay;
+	_pf_query_diffs = 0;
+	_pf_query_unlogged = 0;
+	_pf_query_unreplayed = 0;
+	_pf_query_pending.Clear();
+	_pf_query_next_valid = false;
+	MemSetT(_pf_query_totals, 0, lengthof(_pf_query_totals));
+	_pf_query_log_active = true;
+	return true;
+}
+
+/**
+ * Log a path search of a vehicle.
+ * Only the searches of the game itself are logged, not those of the intro game.
+ * @param type Kind of search.
+ * @param v Vehicle searching.
+ * @param tile Tile the search starts at.
+ * @param dir Direction the search starts in.
+ * @param result The answer.
+ * @param found Was a path found?
+ * @param time Duration in nanoseconds.
+ */
+void LogPathfinderQuery(PathfinderQueryType type, const Vehicle *v, TileIndex tile, uint dir, uint32 result, bool found, uint64 time)
+{
+	if (_game_mode != GM_NORMAL) return;
+
+	PathfinderQueryRecord q;
+	q.date = _date;
+	q.date_fract = _date_fract;
+	q.type = type;
+	q.tile = tile;
+	q.dir = dir;
+	q.veh = v->index;
+	q.veh_tile = v->tile;
+	q.dest_tile = v->dest_tile;
+	q.order_type = v->current_order.GetType();
+	q.order_dest = v->current_order.GetDestination();
+	q.result = result;
+	q.found = found ? 1 : 0;
+	q.time = time;
+
+	PathfinderQueryTotals &totals = _pf_query_totals[type];
+	totals.calls++;
+	totals.time += time;
+
+	if (!_pf_query_replay) {
+		WritePathfinderQuery(q);
+		return;
+	}
+
+	/* The searches of a tick needn't be in the same order if the game took
+	 * another course, so look for the question among all of the tick. */
+	FetchLoggedQueries(q);
+	uint i = 0;
+	while (i < _pf_query_pending.Length() && !q.IsSameQuery(_pf_query_pending[i])) i++;
+	if (i == _pf_query_pending.Length()) {
+		if (_pf_query_unlogged < MAX_REPORTED_DIFFS) {
+			DEBUG(yapf, 0, "[query log] %s of vehicle %u at date %d, tick %u, tile 0x%X isn't in the log",
+					_pf_query_names[type], q.veh, q.date, q.date_fract, q.tile);
+		}
+		_pf_query_unlogged++;
+		return;
+	}
+
+	PathfinderQueryRecord recorded = _pf_query_pending[i];
+	_pf_query_pending.ErasePreservingOrder(i);
+
+	totals.compared_time += time;
+	totals.recorded_time += recorded.time;
+	if (q.result != recorded.result || q.found != recorded.found) {
+		if (_pf_query_diffs < MAX_REPORTED_DIFFS) {
+			DEBUG(yapf, 0, "[query log] %s of vehicle %u at date %d, tick %u, tile 0x%X: answer %u%s, logged %u%s",
+					_pf_query_names[type], q.veh, q.date, q.date_fract, q.tile,
+					q.result, q.found ? "" : " (no path)", recorded.result, recorded.found ? "" : " (no path)");
+		}
+		_pf_query_diffs++;
+	}
+}
+
+/** Stop recording or replaying the query log and report the totals. */
+void StopPathfinderQueryLog()
+{
+	if (_pf_query_log == NULL) return;
+
+	_pf_query_log_active = false;
+
+	uint64 calls = 0;
+	uint64 time = 0;
+	uint64 compared_time = 0;
+	uint64 recorded_time = 0;
+	for (uint i = 0; i < PFQ_END; i++) {
+		const PathfinderQueryTotals &totals = _pf_query_totals[i];
+		if (totals.calls == 0) continue;
+
+		if (_pf_query_replay) {
+			DEBUG(yapf, 0, "[query log] %-11s " OTTD_PRINTF64 " searches, " OTTD_PRINTF64 " us, compared " OTTD_PRINTF64 " us, logged " OTTD_PRINTF64 " us",
+					_pf_query_names[i], totals.calls, totals.time / 1000, totals.compared_time / 1000, totals.recorded_time / 1000);
+		} else {
+			DEBUG(yapf, 0, "[query log] %-11s " OTTD_PRINTF64 " searches, " OTTD_PRINTF64 " us",
+					_pf_query_names[i], totals.calls, totals.time / 1000);
+		}
+		calls += totals.calls;
+		time += totals.time;
+		compared_time += totals.compared_time;
+		recorded_time += totals.recorded_time;
+	}
+
+	DEBUG(yapf, 0, "[query log] total " OTTD_PRINTF64 " searches in " OTTD_PRINTF64 " ms, " OTTD_PRINTF64 " searches per second",
+			calls, time / 1000000, time == 0 ? 0 : calls * 1000000000 / time);
+
+	if (_pf_query_replay) {
+		_pf_query_unreplayed += _pf_query_pending.Length();
+		_pf_query_pending.Clear();
+		if (_pf_query_next_valid) _pf_query_unreplayed++;
+		PathfinderQueryRecord recorded;
+		while (ReadPathfinderQuery(&recorded)) _pf_query_unreplayed++;
+
+		if (recorded_time != 0) {
+			DEBUG(yapf, 0, "[query log] compared searches took %.1f%% of the logged time", (double)compared_time * 100 / recorded_time);
+		}
+		DEBUG(yapf, 0, "[query log] " OTTD_PRINTF64 " different answers, " OTTD_PRINTF64 " searches not in the log, " OTTD_PRINTF64 " logged searches weren't replayed",
+				_pf_query_diffs, _pf_query_unlogged, _pf_query_unreplayed);
+	}
+
+	fclose(_pf_query_log);
+	_pf_query_log = NULL;
+}
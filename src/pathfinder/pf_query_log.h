@@ -0,0 +1,82 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file pf_query_log.h Recording and replaying of the path searches of vehicles.
+ *
+ * While recording, every path search a vehicle makes is written to a log:
+ * when it was made, the question asked, a snapshot of the vehicle, the answer
+ * and how long it took. While replaying, the same savegame is played again
+ * for the same number of ticks (e.g. with the null video driver). As the game
+ * is deterministic the same searches are made again; they are compared with
+ * the log and the differences in answers and time are reported at the end.
+ * Searches are matched with the logged ones of the same tick, so if the game
+ * takes another course the remaining searches are still compared and the
+ * unmatched ones on either side are counted.
+ */
+
+#ifndef PF_QUERY_LOG_H
+#define PF_QUERY_LOG_H
+
+#include "../vehicle_type.h"
+#include "../tile_type.h"
+#include "../debug.h"
+
+/** Kinds of logged path searches. */
+enum PathfinderQueryType {
+	PFQ_TRAIN_TRACK, ///< Track choice of a train.
+	PFQ_TRAIN_DEPOT, ///< Nearest depot of a train.
+	PFQ_ROAD_TRACK,  ///< Track choice of a road vehicle.
+	PFQ_ROAD_DEPOT,  ///< Nearest depot of a road vehicle.
+	PFQ_SHIP_TRACK,  ///< Track choice of a ship.
+	PFQ_END,
+};
+
+extern bool _pf_query_log_active;
+
+bool StartPathfinderQueryLog(const char *filename, bool replay);
+void StopPathfinderQueryLog();
+void LogPathfinderQuery(PathfinderQueryType type, const Vehicle *v, TileIndex tile, uint dir, uint32 result, bool found, uint64 time);
+
+/**
+ * Logs a path search of a vehicle, started at construction and finished by
+ * #Finish. Does nothing unless a query log is being recorded or replayed.
+ */
+class PathfinderQuery {
+	PathfinderQueryType type; ///< Kind of search.
+	const Vehicle *v;         ///< Vehicle searching.
+	TileIndex tile;           ///< Tile the search starts at.
+	uint dir;                 ///< Direction the search starts in.
+	uint64 start;             ///< Time at construction or 0 if not logged.
+
+public:
+	/**
+	 * Start a search.
+	 * @param type Kind of search.
+	 * @param v Vehicle searching.
+	 * @param tile Tile the search starts at.
+	 * @param dir Direction the search starts in, if any.
+	 */
+	PathfinderQuery(PathfinderQueryType type, const Vehicle *v, TileIndex tile, uint dir) : type(type), v(v), tile(tile), dir(dir), start(0)
+	{
+		if (_pf_query_log_active) this->start = ottd_monotonic_ns();
+	}
+
+	/**
+	 * Finish the search and log it.
+	 * @param result The answer, e.g. the chosen track or the found depot.
+	 * @param found Was a path found?
+	 */
+	inline void Finish(uint32 result, bool found)
+	{
+		if (this->start != 0) LogPathfinderQuery(this->type, this->v, this->tile, this->dir, result, found, ottd_monotonic_ns() - this->start);
+	}
+};
+
+#endif /* PF_QUERY_LOG_H */
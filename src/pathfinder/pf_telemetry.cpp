@@ -0,0 +1,184 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file pf_telemetry.cpp Collection of pathfinder timings and node counts. */
+
+#include "../stdafx.h"
+#include "../core/alloc_func.hpp"
+#include "../core/bitmath_func.hpp"
+#include "../core/math_func.hpp"
+#include "../core/mem_func.hpp"
+#include "../core/smallvec_type.hpp"
+#include "../core/sort_func.hpp"
+#include "../thread/thread.h"
+#include "pf_telemetry.h"
+
+bool _pf_telemetry_enabled = false; ///< Is the pathfinder telemetry collected?
+
+static PathfinderTelemetryStats _pf_telemetry[PFTT_END]; ///< Telemetry by kind of search.
+static PathfinderVehicleCost *_pf_vehicle_costs = NULL;  ///< Telemetry by vehicle, indexed by vehicle index.
+static uint _pf_vehicle_costs_size = 0;                   ///< Number of entries in #_pf_vehicle_costs.
+
+/**
+ * Mutex protecting the telemetry, as searches also run on worker threads.
+ * It is created when the telemetry is enabled for the first time and never freed.
+ */
+static ThreadMutex *_pf_telemetry_mutex = NULL;
+
+/** Names of the kinds of searches. */
+static const char * const _pf_telemetry_names[] = {
+	"rail",
+	"road",
+	"ship",
+	"cargo",
+};
+assert_compile(lengthof(_pf_telemetry_names) == PFTT_END);
+
+/**
+ * Get the histogram bucket of a value.
+ * @param value The value.
+ * @return The bucket.
+ */
+static inline uint GetTelemetryBucket(uint64 value)
+{
+	return value == 0 ? 0 : min<uint>(FindLastBit(value) + 1, PF_TELEMETRY_BUCKETS - 1);
+}
+
+/**
+ * Start or stop collecting the pathfinder telemetry.
+ * The collected telemetry is kept when it is stopped.
+ * @param enable True to start collecting.
+ */
+void EnablePathfinderTelemetry(bool enable)
+{
+	if (_pf_telemetry_mutex == NULL) _pf_telemetry_mutex = ThreadMutex::New();
+	_pf_telemetry_enabled = enable;
+}
+
+/** Clear all collected pathfinder telemetry. */
+void ResetPathfinderTelemetry()
+{
+	if (_pf_telemetry_mutex != NULL) _pf_telemetry_mutex->BeginCritical();
+
+	MemSetT(_pf_telemetry, 0, lengthof(_pf_telemetry));
+	free(_pf_vehicle_costs);
+	_pf_vehicle_costs = NULL;
+	_pf_vehicle_costs_size = 0;
+
+	if (_pf_telemetry_mutex != NULL) _pf_telemetry_mutex->EndCritical();
+}
+
+/**
+ * Record a path search. May be called from worker threads.
+ * @param type Kind of search.
+ * @param veh Vehicle searching, or #INVALID_VEHICLE.
+ * @param time Duration in nanoseconds.
+ * @param nodes Number of expanded nodes.
+ * @param found False if the search didn't find a path.
+ */
+void RecordPathfinderTelemetry(PathfinderTelemetryType type, VehicleID veh, uint64 time, uint nodes, bool found)
+{
+	assert(type < PFTT_END);
+	_pf_telemetry_mutex->BeginCritical();
+
+	PathfinderTelemetryStats &stats = _pf_telemetry[type];
+	stats.calls++;
+	if (!found) stats.not_found++;
+	stats.time += time;
+	stats.max_time = max(stats.max_time, time);
+	stats.nodes += nodes;
+	stats.max_nodes = max<uint64>(stats.max_nodes, nodes);
+	stats.time_histogram[GetTelemetryBucket(time / 1000)]++;
+	stats.nodes_histogram[GetTelemetryBucket(nodes)]++;
+
+	if (veh != INVALID_VEHICLE) {
+		if (veh >= _pf_vehicle_costs_size) {
+			uint new_size = Align(veh + 1, 256);
+			_pf_vehicle_costs = ReallocT(_pf_vehicle_costs, new_size);
+			MemSetT(_pf_vehicle_costs + _pf_vehicle_costs_size, 0, new_size - _pf_vehicle_costs_size);
+			_pf_vehicle_costs_size = new_size;
+		}
+
+		PathfinderVehicleCost &cost = _pf_vehicle_costs[veh];
+		cost.index = veh;
+		cost.time += time;
+		cost.calls++;
+		cost.nodes += nodes;
+	}
+
+	_pf_telemetry_mutex->EndCritical();
+}
+
+/**
+ * Drop the telemetry of a vehicle, so its index can be reused by another one.
+ * @param veh The vehicle.
+ */
+void ForgetPathfinderTelemetryVehicle(VehicleID veh)
+{
+	if (_pf_telemetry_mutex == NULL) return;
+
+	_pf_telemetry_mutex->BeginCritical();
+	if (veh < _pf_vehicle_costs_size) MemSetT(&_pf_vehicle_costs[veh], 0);
+	_pf_telemetry_mutex->EndCritical();
+}
+
+/**
+ * Get a copy of the telemetry of a kind of search.
+ * @param type Kind of search.
+ * @param[out] stats The telemetry.
+ */
+void GetPathfinderTelemetryStats(PathfinderTelemetryType type, PathfinderTelemetryStats *stats)
+{
+	assert(type < PFTT_END);
+
+	if (_pf_telemetry_mutex != NULL) _pf_telemetry_mutex->BeginCritical();
+	*stats = _pf_telemetry[type];
+	if (_pf_telemetry_mutex != NULL) _pf_telemetry_mutex->EndCritical();
+}
+
+/** Sort vehicles by descending pathfinder time. */
+static int CDECL VehicleCostSorter(const PathfinderVehicleCost *a, const PathfinderVehicleCost *b)
+{
+	if (a->time != b->time) return a->time < b->time ? 1 : -1;
+	return a->index < b->index ? -1 : 1;
+}
+
+/**
+ * Get the vehicles that spent the most time in path searches.
+ * @param[out] list Buffer for the telemetry of the vehicles, most expensive first.
+ * @param count Size of \a list.
+ * @return Number of vehicles put in \a list.
+ */
+uint GetPathfinderTelemetryTopVehicles(PathfinderVehicleCost *list, uint count)
+{
+	SmallVector<PathfinderVehicleCost, 64> costs;
+
+	if (_pf_telemetry_mutex != NULL) _pf_telemetry_mutex->BeginCritical();
+	for (uint i = 0; i < _pf_vehicle_costs_size; i++) {
+		if (_pf_vehicle_costs[i].calls != 0) *costs.Append() = _pf_vehicle_costs[i];
+	}
+	if (_pf_telemetry_mutex != NULL) _pf_telemetry_mutex->EndCritical();
+
+	QSortT(costs.Begin(), costs.Length(), &VehicleCostSorter);
+
+	count = min(count, costs.Length());
+	MemCpyT(list, costs.Begin(), count);
+	return count;
+}
+
+/**
+ * Get the name of a kind of search.
+ * @param type Kind of search.
+ * @return The name.
+ */
+const char *GetPathfinderTelemetryName(PathfinderTelemetryType type)
+{
+	assert(type < PFTT_END);
+	return _pf_telemetry_names[type];
+}
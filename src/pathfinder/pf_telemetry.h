@@ -0,0 +1,104 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file pf_telemetry.h Collection of pathfinder timings and node counts. */
+
+#ifndef PF_TELEMETRY_H
+#define PF_TELEMETRY_H
+
+#include "../vehicle_type.h"
+#include "../debug.h"
+
+/** Kinds of path searches the telemetry is collected for. */
+enum PathfinderTelemetryType {
+	PFTT_RAIL,  ///< Train path searches.
+	PFTT_ROAD,  ///< Road vehicle path searches.
+	PFTT_SHIP,  ///< Ship path searches, each including its water region search.
+	PFTT_CARGO, ///< Cargo route searches.
+	PFTT_END,
+};
+
+/**
+ * Number of buckets of the histograms. Bucket 0 counts values of 0, bucket
+ * \c i counts values from 2^(i-1) up to 2^i, the last bucket also counts all
+ * larger values.
+ */
+static const uint PF_TELEMETRY_BUCKETS = 20;
+
+/** Telemetry of all searches of one kind. */
+struct PathfinderTelemetryStats {
+	uint64 calls;                                  ///< Number of searches.
+	uint64 not_found;                              ///< Number of searches that didn't find a path.
+	uint64 time;                                   ///< Accumulated time in nanoseconds.
+	uint64 max_time;                               ///< Longest search in nanoseconds.
+	uint64 nodes;                                  ///< Accumulated number of expanded nodes.
+	uint64 max_nodes;                              ///< Most expanded nodes of a search.
+	uint64 time_histogram[PF_TELEMETRY_BUCKETS];   ///< Searches by duration in microseconds.
+	uint64 nodes_histogram[PF_TELEMETRY_BUCKETS];  ///< Searches by number of expanded nodes.
+};
+
+/** Telemetry of all searches for one vehicle. */
+struct PathfinderVehicleCost {
+	VehicleID index; ///< The vehicle.
+	uint64 time;     ///< Accumulated time in nanoseconds.
+	uint32 calls;    ///< Number of searches.
+	uint32 nodes;    ///< Accumulated number of expanded nodes.
+};
+
+extern bool _pf_telemetry_enabled;
+
+void EnablePathfinderTelemetry(bool enable);
+void ResetPathfinderTelemetry();
+void RecordPathfinderTelemetry(PathfinderTelemetryType type, VehicleID veh, uint64 time, uint nodes, bool found);
+void ForgetPathfinderTelemetryVehicle(VehicleID veh);
+void GetPathfinderTelemetryStats(PathfinderTelemetryType type, PathfinderTelemetryStats *stats);
+uint GetPathfinderTelemetryTopVehicles(PathfinderVehicleCost *list, uint count);
+const char *GetPathfinderTelemetryName(PathfinderTelemetryType type);
+
+/**
+ * Measures a path search while it is in scope.
+ * Does nothing unless the telemetry is enabled.
+ */
+class PathfinderTelemetryTimer {
+	PathfinderTelemetryType type; ///< Kind of search.
+	VehicleID veh;                ///< Vehicle searching, or #INVALID_VEHICLE.
+	uint64 start;                 ///< Time at construction or 0 if disabled.
+	uint nodes;                   ///< Expanded nodes.
+	bool found;                   ///< Did the search find a path?
+
+public:
+	/**
+	 * Start measuring.
+	 * @param type Kind of search, #PFTT_END if the search is measured as part of another one.
+	 * @param veh Vehicle searching, or #INVALID_VEHICLE.
+	 */
+	PathfinderTelemetryTimer(PathfinderTelemetryType type, VehicleID veh) : type(type), veh(veh), start(0), nodes(0), found(true)
+	{
+		if (_pf_telemetry_enabled && type != PFTT_END) this->start = ottd_monotonic_ns();
+	}
+
+	/** Stop measuring and record the result. */
+	~PathfinderTelemetryTimer()
+	{
+		if (this->start != 0) RecordPathfinderTelemetry(this->type, this->veh, ottd_monotonic_ns() - this->start, this->nodes, this->found);
+	}
+
+	/**
+	 * Set the outcome of the search.
+	 * @param nodes Expanded nodes.
+	 * @param found Was a path found?
+	 */
+	inline void SetResult(uint nodes, bool found)
+	{
+		this->nodes = nodes;
+		this->found = found;
+	}
+};
+
+#endif /* PF_TELEMETRY_H */
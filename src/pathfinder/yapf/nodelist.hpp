@@ -15,6 +15,8 @@
 #include "../../misc/array.hpp"
 #include "../../misc/hashtable.hpp"
 #include "../../misc/binaryheap.hpp"
+#include "../../core/smallvec_type.hpp"
+#include "../../thread/thread.h"
 
 /**
  * Hash table based node list multi-container class.
@@ -61,6 +63,16 @@ public:
 	{
 	}
 
+	/** forget all nodes, but keep the allocated memory for the next search */
+	inline void Clear()
+	{
+		m_arr.Reset();
+		m_open.Clear();
+		m_closed.Clear();
+		m_open_queue.Clear();
+		m_new_node = NULL;
+	}
+
 	/** return number of open nodes */
 	inline int OpenCount()
 	{
@@ -163,4 +175,42 @@ public:
 	}
 };
 
+/**
+ * Pool of node lists. Path finder instances take their node list from
+ * here and give it back when they are done, so the node storage of one
+ * search is reused by the following ones instead of being allocated and
+ * freed for each search. Safe to use from several threads at once.
+ */
+template <class Tnodelist>
+class CNodeListPoolT {
+	static SmallVector<Tnodelist *, 4> s_free; ///< node lists ready for reuse
+	static ThreadMutex *s_mutex;               ///< protects s_free
+
+public:
+	/** get an empty node list */
+	static Tnodelist *Acquire()
+	{
+		Tnodelist *nodes = NULL;
+		s_mutex->BeginCritical();
+		if (s_free.Length() > 0) {
+			nodes = *s_free.Get(s_free.Length() - 1);
+			s_free.Erase(s_free.Get(s_free.Length() - 1));
+		}
+		s_mutex->EndCritical();
+		return nodes != NULL ? nodes : new Tnodelist();
+	}
+
+	/** return a node list that is no longer used */
+	static void Release(Tnodelist *nodes)
+	{
+		nodes->Clear();
+		s_mutex->BeginCritical();
+		*s_free.Append() = nodes;
+		s_mutex->EndCritical();
+	}
+};
+
+template <class Tnodelist> SmallVector<Tnodelist *, 4> CNodeListPoolT<Tnodelist>::s_free;
+template <class Tnodelist> ThreadMutex *CNodeListPoolT<Tnodelist>::s_mutex = ThreadMutex::New();
+
 #endif /* NODELIST_HPP */
@@ -14,8 +14,10 @@
 
 #include "../../debug.h"
 #include "../../settings_type.h"
+#include "../pf_telemetry.h"
 
 extern int _total_pf_time_us;
+void AddTotalPfTime(int us);
 
 /**
  * CYapfBaseT - A-star type path finder base class.
@@ -58,8 +60,9 @@ public:
 	typedef typename Node::Key Key;            ///< key to hash tables
 
 
-	NodeList             m_nodes;              ///< node list multi-container
+	NodeList            *m_nodes;              ///< node list multi-container, taken from the node list pool; NULL once released
 protected:
+	Node                *m_path;               ///< copy of the best path kept after the node list is released
 	Node                *m_pBestDestNode;      ///< pointer to the destination node found at last round
 	Node                *m_pBestIntermediateNode; ///< here should be node closest to the destination if path not found
 	const YAPFSettings  *m_settings;           ///< current settings (_settings_game.yapf)
@@ -81,7 +84,9 @@ public:
 public:
 	/** default constructor */
 	inline CYapfBaseT()
-		: m_pBestDestNode(NULL)
+		: m_nodes(CNodeListPoolT<NodeList>::Acquire())
+		, m_path(NULL)
+		, m_pBestDestNode(NULL)
 		, m_pBestIntermediateNode(NULL)
 		, m_settings(&_settings_game.pf.yapf)
 		, m_max_search_nodes(PfGetSettings().max_search_nodes)
@@ -92,8 +97,12 @@ public:
 	{
 	}
 
-	/** default destructor */
-	~CYapfBaseT() {}
+	/** default destructor, hands the node list back to the pool */
+	~CYapfBaseT()
+	{
+		if (m_nodes != NULL) CNodeListPoolT<NodeList>::Release(m_nodes);
+		delete[] m_path;
+	}
 
 protected:
 	/** to access inherited path finder */
@@ -102,6 +111,18 @@ protected:
 		return *static_cast<Tpf*>(this);
 	}
 
+	/** kind of search for the pathfinder telemetry, from the transport type character */
+	static inline PathfinderTelemetryType GetTelemetryType(char ttc)
+	{
+		switch (ttc) {
+			case 't': return PFTT_RAIL;
+			case 'r': return PFTT_ROAD;
+			case 'c': return PFTT_CARGO;
+			/* Ship searches are made of several searches, they are measured as a whole by the caller. */
+			default:  return PFTT_END;
+		}
+	}
+
 public:
 	/** return current settings (can be custom - company based - but later) */
 	inline const YAPFSettings& PfGetSettings() const
@@ -122,6 +143,8 @@ public:
 	{
 		m_veh = v;
 
+		PathfinderTelemetryTimer telemetry(GetTelemetryType(Yapf().TransportTypeChar()), (m_veh != NULL) ? m_veh->index : INVALID_VEHICLE);
+
 #ifndef NO_DEBUG_MESSAGES
 		CPerformanceTimer perf;
 		perf.Start();
@@ -132,7 +155,7 @@ public:
 
 		for (;;) {
 			m_num_steps++;
-			Node *n = m_nodes.GetBestOpenNode();
+			Node *n = m_nodes->GetBestOpenNode();
 			if (n == NULL) {
 				break;
 			}
@@ -143,9 +166,9 @@ public:
 			}
 
 			Yapf().PfFollowNode(*n);
-			if (m_max_search_nodes == 0 || m_nodes.ClosedCount() < m_max_search_nodes) {
-				m_nodes.PopOpenNode(n->GetKey());
-				m_nodes.InsertClosedNode(*n);
+			if (m_max_search_nodes == 0 || m_nodes->ClosedCount() < m_max_search_nodes) {
+				m_nodes->PopOpenNode(n->GetKey());
+				m_nodes->InsertClosedNode(*n);
 			} else {
 				bDestFound = false;
 				break;
@@ -153,12 +176,13 @@ public:
 		}
 
 		bDestFound &= (m_pBestDestNode != NULL);
+		telemetry.SetResult(m_nodes->ClosedCount(), bDestFound);
 
 #ifndef NO_DEBUG_MESSAGES
 		perf.Stop();
 		if (_debug_yapf_level >= 2) {
 			int t = perf.Get(1000000);
-			_total_pf_time_us += t;
+			AddTotalPfTime(t);
 
 			if (_debug_yapf_level >= 3) {
 				UnitID veh_idx = (m_veh != NULL) ? m_veh->unitnumber : 0;
@@ -168,7 +192,7 @@ public:
 				int dist = bDestFound ? m_pBestDestNode->m_estimate - m_pBestDestNode->m_cost : -1;
 
 				DEBUG(yapf, 3, "[YAPF%c]%c%4d- %d us - %d rounds - %d open - %d closed - CHR %4.1f%% - C %d D %d - c%d(sc%d, ts%d, o%d) -- ",
-					ttc, bDestFound ? '-' : '!', veh_idx, t, m_num_steps, m_nodes.OpenCount(), m_nodes.ClosedCount(),
+					ttc, bDestFound ? '-' : '!', veh_idx, t, m_num_steps, m_nodes->OpenCount(), m_nodes->ClosedCount(),
 					cache_hit_ratio, cost, dist, m_perf_cost.Get(1000000), m_perf_slope_cost.Get(1000000),
 					m_perf_ts_cost.Get(1000000), m_perf_other_cost.Get(1000000)
 				);
@@ -187,13 +211,46 @@ public:
 		return (m_pBestDestNode != NULL) ? m_pBestDestNode : m_pBestIntermediateNode;
 	}
 
+	/**
+	 * Copy the best node and its parents out of the node list and hand the
+	 * node list back to the pool. Afterwards only GetBestNode() and the
+	 * m_parent chain of the result may be used; no further searches.
+	 */
+	void ReleaseNodes()
+	{
+		if (m_nodes == NULL) return;
+
+		uint length = 0;
+		for (const Node *n = GetBestNode(); n != NULL; n = n->m_parent) length++;
+
+		if (length > 0) {
+			m_path = new Node[length];
+			Node *copy = m_path;
+			for (const Node *n = GetBestNode(); n != NULL; n = n->m_parent, copy++) {
+				*copy = *n;
+				copy->m_hash_next = NULL;
+				copy->m_parent = (n->m_parent != NULL) ? copy + 1 : NULL;
+			}
+		}
+
+		if (m_pBestDestNode != NULL) {
+			m_pBestDestNode = m_path;
+			m_pBestIntermediateNode = NULL;
+		} else {
+			m_pBestIntermediateNode = m_path;
+		}
+
+		CNodeListPoolT<NodeList>::Release(m_nodes);
+		m_nodes = NULL;
+	}
+
 	/**
 	 * Calls NodeList::CreateNewNode() - allocates new node that can be filled and used
 	 *  as argument for AddStartupNode() or AddNewNode()
 	 */
 	inline Node& CreateNewNode()
 	{
-		Node& node = *m_nodes.CreateNewNode();
+		Node& node = *m_nodes->CreateNewNode();
 		return node;
 	}
 
@@ -202,8 +259,8 @@ public:
 	{
 		Yapf().PfNodeCacheFetch(n);
 		/* insert the new node only if it is not there */
-		if (m_nodes.FindOpenNode(n.m_key) == NULL) {
-			m_nodes.InsertOpenNode(n);
+		if (m_nodes->FindOpenNode(n.m_key) == NULL) {
+			m_nodes->InsertOpenNode(n);
 		} else {
 			/* if we are here, it means that node is already there - how it is possible?
 			 *   probably the train is in the position that both its ends point to the same tile/exit-dir
@@ -254,7 +311,7 @@ public:
 			if (m_pBestDestNode == NULL || n < *m_pBestDestNode) {
 				m_pBestDestNode = &n;
 			}
-			m_nodes.FoundBestNode(n);
+			m_nodes->FoundBestNode(n);
 			return;
 		}
 
@@ -263,22 +320,22 @@ public:
 		}
 
 		/* check new node against open list */
-		Node *openNode = m_nodes.FindOpenNode(n.GetKey());
+		Node *openNode = m_nodes->FindOpenNode(n.GetKey());
 		if (openNode != NULL) {
 			/* another node exists with the same key in the open list
 			 * is it better than new one? */
 			if (n.GetCostEstimate() < openNode->GetCostEstimate()) {
 				/* update the old node by value from new one */
-				m_nodes.PopOpenNode(n.GetKey());
+				m_nodes->PopOpenNode(n.GetKey());
 				*openNode = n;
 				/* add the updated old node back to open list */
-				m_nodes.InsertOpenNode(*openNode);
+				m_nodes->InsertOpenNode(*openNode);
 			}
 			return;
 		}
 
 		/* check new node against closed list */
-		Node *closedNode = m_nodes.FindClosedNode(n.GetKey());
+		Node *closedNode = m_nodes->FindClosedNode(n.GetKey());
 		if (closedNode != NULL) {
 			/* another node exists with the same key in the closed list
 			 * is it better than new one? */
@@ -297,7 +354,7 @@ public:
 		}
 		/* the new node is really new
 		 * add it to the open list */
-		m_nodes.InsertOpenNode(n);
+		m_nodes->InsertOpenNode(n);
 	}
 
 	const VehicleType * GetVehicle() const
@@ -307,7 +364,7 @@ public:
 
 	void DumpBase(DumpTarget &dmp) const
 	{
-		dmp.WriteStructT("m_nodes", &m_nodes);
+		dmp.WriteStructT("m_nodes", m_nodes);
 		dmp.WriteLine("m_num_steps = %d", m_num_steps);
 	}
 
@@ -318,18 +375,18 @@ public:
 	inline void PfSetStartupNodes()
 	{
 		/* example: */
-		Node& n1 = *base::m_nodes.CreateNewNode();
+		Node& n1 = *base::m_nodes->CreateNewNode();
 		.
 		. // setup node members here
 		.
-		base::m_nodes.InsertOpenNode(n1);
+		base::m_nodes->InsertOpenNode(n1);
 	}
 
 	/** Example: PfFollowNode() - set following (child) nodes of the given node */
 	inline void PfFollowNode(Node& org)
 	{
 		for (each follower of node org) {
-			Node& n = *base::m_nodes.CreateNewNode();
+			Node& n = *base::m_nodes->CreateNewNode();
 			.
 			. // setup node members here
 			.
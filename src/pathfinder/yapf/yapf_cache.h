@@ -21,4 +21,16 @@
  */
 void YapfNotifyTrackLayoutChange(TileIndex tile, Track track);
 
+/**
+ * Use this function to notify YAPF that the water on a tile has changed.
+ * @param tile the tile that is changed, or INVALID_TILE if the whole map changed
+ */
+void YapfNotifyWaterLayoutChange(TileIndex tile);
+
+/**
+ * Use this function to notify YAPF that the road layout on a tile (or its slope) has changed.
+ * @param tile the tile that is changed, or INVALID_TILE if the whole map changed
+ */
+void YapfNotifyRoadLayoutChange(TileIndex tile);
+
 #endif /* YAPF_CACHE_H */
@@ -11,6 +11,7 @@
 
 #include "../../stdafx.h"
 #include "../../cargodest_base.h"
+#include "../../cargodest_func.h"
 #include "../../station_base.h"
 #include "../../town.h"
 #include "yapf.hpp"
@@ -334,15 +335,22 @@ class CYapfFollowRouteLinkT {
 	typedef typename Types::TrackFollower Follower;      ///< The route follower.
 	typedef typename Types::NodeList::Titem Node;        ///< This will be our node type.
 
+	RouteTableEntry *m_deps; ///< Routing decision to record the inputs of the search in or NULL.
+
 	/** To access inherited path finder. */
 	inline Tpf& Yapf() { return *static_cast<Tpf*>(this); }
 
 public:
+	CYapfFollowRouteLinkT() : m_deps(NULL) {}
+
 	/** Called by YAPF to move from the given node to the next nodes. */
 	inline void PfFollowNode(Node& old_node)
 	{
 		Follower f(this->Yapf().GetCargoID());
 
+		/* Everything about the station we follow from is an input to the result. */
+		if (this->m_deps != NULL) this->m_deps->AddStation(Station::Get(old_node.GetRouteLink()->GetDestination()), this->Yapf().GetCargoID());
+
 		if (this->Yapf().PfDetectDestination(old_node.GetRouteLink()->GetDestination()) && (old_node.GetRouteLink()->GetDestOrderId() == INVALID_ORDER || (Order::Get(old_node.GetRouteLink()->GetDestOrderId())->GetUnloadType() & OUFB_NO_UNLOAD) == 0)) {
 			/* Possible destination? Add sentinel node for final delivery. */
 			Node &n = this->Yapf().CreateNewNode();
@@ -367,17 +375,20 @@ public:
 	}
 
 	/** Find the best cargo routing from a station to a destination. */
-	static RouteLink *ChooseRouteLink(CargoID cid, const StationList *stations, TileIndex src, const TileArea &dest, StationID *start_station, StationID *next_unload, byte flags, bool *found, OrderID order, int max_cost)
+	static RouteLink *ChooseRouteLink(CargoID cid, const StationList *stations, TileIndex src, const TileArea &dest, StationID *start_station, StationID *next_unload, byte flags, bool *found, OrderID order, int max_cost, RouteTableEntry *deps)
 	{
 		/* Initialize pathfinder instance. */
 		Tpf pf;
 		pf.SetOrigin(cid, src, stations, start_station != NULL, order, flags);
 		pf.SetDestination(dest, max_cost);
+		pf.m_deps = deps;
 
 		*next_unload = INVALID_STATION;
 
 		/* Do it. Exit if we didn't find a path. */
+		CargodestPerfTimer perf(CDPE_CHOOSE_ROUTE_LINK);
 		bool res = pf.FindPath(NULL);
+		perf.SetSearchResult(pf.m_nodes->OpenCount() + pf.m_nodes->ClosedCount(), pf.m_nodes->ClosedCount(), res);
 		if (found != NULL) *found = res;
 		if (!res) return NULL;
 
@@ -434,9 +445,10 @@ struct CYapfRouteLink : CYapfT<CYapfRouteLink_TypesT<CYapfRouteLink> > {};
  * @param[out] found True if a link was found.
  * @param order    Order the vehicle arrived at the origin station.
  * @param max_cost Maxmimum allowed node cost.
+ * @param deps     Routing decision to record all inputs of the search in or NULL.
  * @return The best RouteLink to the target or NULL if either no link found or one of the origin stations is the best destination.
  */
-RouteLink *YapfChooseRouteLink(CargoID cid, const StationList *stations, TileIndex src, const TileArea &dest, StationID *start_station, StationID *next_unload, byte flags, bool *found, OrderID order, int max_cost)
+RouteLink *YapfChooseRouteLink(CargoID cid, const StationList *stations, TileIndex src, const TileArea &dest, StationID *start_station, StationID *next_unload, byte flags, bool *found, OrderID order, int max_cost, RouteTableEntry *deps)
 {
-	return CYapfRouteLink::ChooseRouteLink(cid, stations, src, dest, start_station, next_unload, flags, found, order, max_cost);
+	return CYapfRouteLink::ChooseRouteLink(cid, stations, src, dest, start_station, next_unload, flags, found, order, max_cost, deps);
 }
@@ -0,0 +1,443 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file yapf_connectivity.cpp Connected components of the rail network and distances to depots.
+ *
+ * Tiles are linked if their tracks meet at the common edge (or they are the
+ * ends of the same tunnel/bridge) and their rail types are in the same
+ * compatibility class. Track direction, signals and owners are ignored, so a
+ * train can never leave the component it is in; a destination in another
+ * component is unreachable without searching.
+ *
+ * Building track only adds links, which just joins components. When a link
+ * disappears the components of the tiles at its ends are flooded again the
+ * next time they are needed, as they might be split now; the rest of the map
+ * is left alone. So the answers only depend on the map and are the same for all
+ * clients of a network game.
+ *
+ * The number of tiles to the nearest depot over the same links is kept for
+ * every tile too. New links and depots can only shorten the distances, which
+ * is spread from the changed tile; otherwise the distances are recalculated
+ * with the components.
+ */
+
+#include "../../stdafx.h"
+#include "../../rail_map.h"
+#include "../../tunnelbridge_map.h"
+#include "../../base_station_base.h"
+#include "../../core/alloc_func.hpp"
+#include "../../core/smallvec_type.hpp"
+#include "yapf_connectivity.h"
+
+/** Bits of the per tile link information. */
+enum RailComponentLinks {
+	RCL_WORMHOLE = 1 << DIAGDIR_END,       ///< Linked with the other end of the tunnel/bridge; lower bits are the linked edges.
+	RCL_DEPOT    = 1 << (DIAGDIR_END + 1), ///< The tile is a rail depot.
+};
+
+static const uint32 RC_ROOT = 1U << 31; ///< Set for the root tile of a component; the lower bits are the number of depots in the component.
+static const uint32 RC_MARK = 1U << 30; ///< Set for tiles already flooded while flooding components again.
+static const byte RDD_FAR = UINT8_MAX;  ///< Depot distance of tiles that are this far or farther from any depot.
+
+static uint32 *_rail_component_parent = NULL; ///< Parent tile of each tile in its component, or #RC_ROOT plus depot count for roots.
+static byte *_rail_component_links = NULL;     ///< #RailComponentLinks of each tile.
+static uint _rail_component_map_size = 0;      ///< Number of tiles the arrays are allocated for.
+static bool _rail_components_valid = false;    ///< Do the components match the map?
+static byte *_rail_depot_distance = NULL;      ///< Number of tiles to the nearest depot of each tile, at most #RDD_FAR.
+static bool _rail_depot_distances_valid = false; ///< Do the depot distances match the components?
+static byte _rail_type_class[RAILTYPE_END];    ///< Compatibility class of each rail type, as used for the components.
+static SmallVector<TileIndex, 16> _rail_component_seeds; ///< Tiles at removed links, their components are flooded again before the next query.
+
+/**
+ * Group the rail types into classes of (indirectly) compatible rail types.
+ * @param classes [out] Lowest rail type in the class of each rail type.
+ */
+static void CalcRailTypeClasses(byte *classes)
+{
+	for (RailType rt = RAILTYPE_BEGIN; rt != RAILTYPE_END; rt++) classes[rt] = rt;
+
+	bool changed;
+	do {
+		changed = false;
+		for (RailType a = RAILTYPE_BEGIN; a != RAILTYPE_END; a++) {
+			RailTypes compatible = GetRailTypeInfo(a)->compatible_railtypes;
+			for (RailType b = RAILTYPE_BEGIN; b != RAILTYPE_END; b++) {
+				if (!HasBit(compatible, b) || classes[a] == classes[b]) continue;
+				classes[a] = classes[b] = min(classes[a], classes[b]);
+				changed = true;
+			}
+		}
+	} while (changed);
+}
+
+/**
+ * Get the edges of a tile its tracks lead to.
+ * @param tile The tile.
+ * @param rt_class [out] Compatibility class of the rail type of the tile.
+ * @return Edge bits, #RCL_WORMHOLE for tunnel/bridge ends and #RCL_DEPOT for depots.
+ */
+static byte GetRailSides(TileIndex tile, byte *rt_class)
+{
+	RailType rt = GetTileRailType(tile);
+	if (rt == INVALID_RAILTYPE) return 0;
+	*rt_class = _rail_type_class[rt];
+
+	if (IsTileType(tile, MP_TUNNELBRIDGE)) return RCL_WORMHOLE | (1 << ReverseDiagDir(GetTunnelBridgeDirection(tile)));
+	if (IsRailDepotTile(tile)) return RCL_DEPOT | (1 << GetRailDepotDirection(tile));
+
+	TrackBits tracks = TrackStatusToTrackBits(GetTileTrackStatus(tile, TRANSPORT_RAIL, 0));
+	byte sides = 0;
+	for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
+		if ((tracks & DiagdirReachesTracks(ReverseDiagDir(dir))) != TRACK_BIT_NONE) SetBit(sides, dir);
+	}
+	return sides;
+}
+
+/**
+ * Get the links of a tile to its neighbours according to the map.
+ * @param tile The tile.
+ * @return #RailComponentLinks of the tile.
+ */
+static byte GetRailLinks(TileIndex tile)
+{
+	byte rt_class;
+	byte sides = GetRailSides(tile, &rt_class);
+	byte links = sides & RCL_DEPOT;
+
+	for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
+		if (!HasBit(sides, dir)) continue;
+		TileIndex neighbour = AddTileIndexDiffCWrap(tile, TileIndexDiffCByDiagDir(dir));
+		if (neighbour == INVALID_TILE) continue;
+		byte neighbour_class;
+		if (HasBit(GetRailSides(neighbour, &neighbour_class), ReverseDiagDir(dir)) && neighbour_class == rt_class) SetBit(links, dir);
+	}
+
+	if ((sides & RCL_WORMHOLE) != 0) {
+		byte other_class;
+		if (GetRailSides(GetOtherTunnelBridgeEnd(tile), &other_class) != 0 && other_class == rt_class) links |= RCL_WORMHOLE;
+	}
+
+	return links;
+}
+
+/**
+ * Find the root tile of the component of a tile.
+ * @param tile The tile.
+ * @return The root tile.
+ */
+static TileIndex FindRailComponent(TileIndex tile)
+{
+	for (;;) {
+		uint32 parent = _rail_component_parent[tile];
+		if ((parent & RC_ROOT) != 0) return tile;
+		uint32 grandparent = _rail_component_parent[parent];
+		if ((grandparent & RC_ROOT) != 0) return parent;
+		/* Halve the path on the way. */
+		_rail_component_parent[tile] = grandparent;
+		tile = grandparent;
+	}
+}
+
+/**
+ * Join the components of two tiles.
+ * @param tile1 First tile.
+ * @param tile2 Second tile.
+ */
+static void JoinRailComponents(TileIndex tile1, TileIndex tile2)
+{
+	TileIndex root1 = FindRailComponent(tile1);
+	TileIndex root2 = FindRailComponent(tile2);
+	if (root1 == root2) return;
+	if (root1 > root2) Swap(root1, root2);
+
+	_rail_component_parent[root1] += _rail_component_parent[root2] & ~RC_ROOT;
+	_rail_component_parent[root2] = root1;
+}
+
+/** Calculate all components from scratch. */
+static void RebuildRailComponents()
+{
+	if (_rail_component_map_size != MapSize()) {
+		free(_rail_component_parent);
+		free(_rail_component_links);
+		free(_rail_depot_distance);
+		_rail_component_map_size = MapSize();
+		_rail_component_parent = MallocT<uint32>(_rail_component_map_size);
+		_rail_component_links = MallocT<byte>(_rail_component_map_size);
+		_rail_depot_distance = MallocT<byte>(_rail_component_map_size);
+	}
+
+	for (TileIndex tile = 0; tile < _rail_component_map_size; tile++) {
+		_rail_component_parent[tile] = RC_ROOT;
+	}
+
+	for (TileIndex tile = 0; tile < _rail_component_map_size; tile++) {
+		byte links = GetRailLinks(tile);
+		_rail_component_links[tile] = links;
+		if (links == 0) continue;
+
+		/* Each link is seen from both ends, join only once. */
+		if (HasBit(links, DIAGDIR_SE)) JoinRailComponents(tile, TileAddByDiagDir(tile, DIAGDIR_SE));
+		if (HasBit(links, DIAGDIR_SW)) JoinRailComponents(tile, TileAddByDiagDir(tile, DIAGDIR_SW));
+		if ((links & RCL_WORMHOLE) != 0) {
+			TileIndex other = GetOtherTunnelBridgeEnd(tile);
+			if (other > tile) JoinRailComponents(tile, other);
+		}
+	}
+
+	for (TileIndex tile = 0; tile < _rail_component_map_size; tile++) {
+		if ((_rail_component_links[tile] & RCL_DEPOT) != 0) _rail_component_parent[FindRailComponent(tile)]++;
+	}
+
+	_rail_component_seeds.Clear();
+	_rail_components_valid = true;
+	_rail_depot_distances_valid = false;
+}
+
+/**
+ * Spread shorter depot distances over the links to the neighbouring tiles.
+ * @param queue Tiles whose distance got shorter; more tiles are added while spreading.
+ */
+static void SpreadRailDepotDistances(SmallVector<TileIndex, 64> &queue)
+{
+	for (uint i = 0; i < queue.Length(); i++) {
+		TileIndex tile = queue[i];
+		if (_rail_depot_distance[tile] >= RDD_FAR - 1) continue;
+		byte distance = _rail_depot_distance[tile] + 1;
+
+		byte links = _rail_component_links[tile];
+		for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
+			if (!HasBit(links, dir)) continue;
+			TileIndex neighbour = TileAddByDiagDir(tile, dir);
+			if (_rail_depot_distance[neighbour] <= distance) continue;
+			_rail_depot_distance[neighbour] = distance;
+			*queue.Append() = neighbour;
+		}
+		if ((links & RCL_WORMHOLE) != 0) {
+			TileIndex other = GetOtherTunnelBridgeEnd(tile);
+			if (_rail_depot_distance[other] <= distance) continue;
+			_rail_depot_distance[other] = distance;
+			*queue.Append() = other;
+		}
+	}
+}
+
+/** Calculate all depot distances from scratch. */
+static void RebuildRailDepotDistances()
+{
+	SmallVector<TileIndex, 64> queue;
+	for (TileIndex tile = 0; tile < _rail_component_map_size; tile++) {
+		if ((_rail_component_links[tile] & RCL_DEPOT) != 0) {
+			_rail_depot_distance[tile] = 0;
+			*queue.Append() = tile;
+		} else {
+			_rail_depot_distance[tile] = RDD_FAR;
+		}
+	}
+	SpreadRailDepotDistances(queue);
+
+	_rail_depot_distances_valid = true;
+}
+
+/**
+ * Mark a tile as flooded and add it to the tiles still to follow.
+ * @param tile The tile.
+ * @param root Root tile of the component being flooded.
+ * @param flooded Tiles flooded so far.
+ */
+static inline void FloodRailComponentTile(TileIndex tile, TileIndex root, SmallVector<TileIndex, 64> &flooded)
+{
+	if ((_rail_component_parent[tile] & RC_MARK) != 0) return;
+	_rail_component_parent[tile] = RC_MARK | root;
+	*flooded.Append() = tile;
+}
+
+/**
+ * Flood the components of the tiles at removed links again. Every tile of
+ * such a component is connected to one of these tiles, so only these
+ * components are touched and afterwards they match the map again.
+ */
+static void RefloodRailComponents()
+{
+	SmallVector<TileIndex, 64> flooded;
+	for (const TileIndex *seed = _rail_component_seeds.Begin(); seed != _rail_component_seeds.End(); seed++) {
+		if ((_rail_component_parent[*seed] & RC_MARK) != 0) continue;
+
+		uint32 depots = 0;
+		uint first = flooded.Length();
+		FloodRailComponentTile(*seed, *seed, flooded);
+		for (uint i = first; i < flooded.Length(); i++) {
+			TileIndex tile = flooded[i];
+			byte links = _rail_component_links[tile];
+			if ((links & RCL_DEPOT) != 0) depots++;
+			for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
+				if (HasBit(links, dir)) FloodRailComponentTile(TileAddByDiagDir(tile, dir), *seed, flooded);
+			}
+			if ((links & RCL_WORMHOLE) != 0) FloodRailComponentTile(GetOtherTunnelBridgeEnd(tile), *seed, flooded);
+		}
+		_rail_component_parent[*seed] = RC_MARK | RC_ROOT | depots;
+	}
+	_rail_component_seeds.Clear();
+
+	SmallVector<TileIndex, 64> queue;
+	for (const TileIndex *tile = flooded.Begin(); tile != flooded.End(); tile++) {
+		_rail_component_parent[*tile] &= ~RC_MARK;
+		if (!_rail_depot_distances_valid) continue;
+
+		/* The depot distances within these components are calculated again as well. */
+		if ((_rail_component_links[*tile] & RCL_DEPOT) != 0) {
+			_rail_depot_distance[*tile] = 0;
+			*queue.Append() = *tile;
+		} else {
+			_rail_depot_distance[*tile] = RDD_FAR;
+		}
+	}
+	if (_rail_depot_distances_valid) SpreadRailDepotDistances(queue);
+}
+
+/** Make sure the components match the current map and rail types. */
+static void UpdateRailComponents()
+{
+	byte classes[RAILTYPE_END];
+	CalcRailTypeClasses(classes);
+	if (!_rail_components_valid || _rail_component_map_size != MapSize() || MemCmpT(classes, _rail_type_class, RAILTYPE_END) != 0) {
+		MemCpyT(_rail_type_class, classes, RAILTYPE_END);
+		RebuildRailComponents();
+	}
+	if (_rail_component_seeds.Length() > 0) RefloodRailComponents();
+}
+
+/**
+ * Update the links of a changed tile.
+ * @param tile The tile.
+ */
+static void UpdateRailTileLinks(TileIndex tile)
+{
+	byte old_links = _rail_component_links[tile];
+	byte new_links = GetRailLinks(tile);
+	if (old_links == new_links) return;
+
+	byte removed = old_links & ~new_links;
+	byte added = new_links & ~old_links;
+	bool wormhole = IsTileType(tile, MP_TUNNELBRIDGE) && GetTunnelBridgeTransportType(tile) == TRANSPORT_RAIL;
+	if ((removed & RCL_WORMHOLE) != 0 && !wormhole) {
+		/* The other end of the removed tunnel/bridge is unknown now. */
+		_rail_components_valid = false;
+		return;
+	}
+
+	_rail_component_links[tile] = new_links;
+	/* The component might be split now. */
+	if (removed != 0) *_rail_component_seeds.Append() = tile;
+
+	SmallVector<TileIndex, 64> queue;
+	*queue.Append() = tile;
+	for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
+		TileIndex neighbour = TileAddByDiagDir(tile, dir);
+		if (HasBit(added, dir)) {
+			SetBit(_rail_component_links[neighbour], ReverseDiagDir(dir));
+			JoinRailComponents(tile, neighbour);
+			*queue.Append() = neighbour;
+		} else if (HasBit(removed, dir)) {
+			ClrBit(_rail_component_links[neighbour], ReverseDiagDir(dir));
+			*_rail_component_seeds.Append() = neighbour;
+		}
+	}
+	if (((added | removed) & RCL_WORMHOLE) != 0) {
+		TileIndex other = GetOtherTunnelBridgeEnd(tile);
+		if ((added & RCL_WORMHOLE) != 0) {
+			_rail_component_links[other] |= RCL_WORMHOLE;
+			JoinRailComponents(tile, other);
+			*queue.Append() = other;
+		} else {
+			_rail_component_links[other] &= ~RCL_WORMHOLE;
+			*_rail_component_seeds.Append() = other;
+		}
+	}
+	if ((added & RCL_DEPOT) != 0) {
+		_rail_component_parent[FindRailComponent(tile)]++;
+		_rail_depot_distance[tile] = 0;
+	}
+
+	/* The new links can only make the way to a depot shorter. */
+	if (_rail_depot_distances_valid) SpreadRailDepotDistances(queue);
+}
+
+/**
+ * The track layout of a tile changed.
+ * @param tile The changed tile or INVALID_TILE if unknown.
+ */
+void NotifyRailConnectivityChange(TileIndex tile)
+{
+	if (!_rail_components_valid) return;
+	if (tile == INVALID_TILE || _rail_component_map_size != MapSize()) {
+		_rail_components_valid = false;
+		return;
+	}
+
+	UpdateRailTileLinks(tile);
+	/* Only one end of a new tunnel/bridge is announced. */
+	if (_rail_components_valid && IsTileType(tile, MP_TUNNELBRIDGE) && GetTunnelBridgeTransportType(tile) == TRANSPORT_RAIL) {
+		UpdateRailTileLinks(GetOtherTunnelBridgeEnd(tile));
+	}
+}
+
+/**
+ * Can a train get from one tile to another at all?
+ * @param tile1 First tile.
+ * @param tile2 Second tile.
+ * @return False if the tiles are definitely not connected by track.
+ */
+bool AreRailTilesConnected(TileIndex tile1, TileIndex tile2)
+{
+	UpdateRailComponents();
+	return FindRailComponent(tile1) == FindRailComponent(tile2);
+}
+
+/**
+ * Can a train get from a tile to a rail station or waypoint at all?
+ * @param tile The tile.
+ * @param station The station or waypoint.
+ * @return False if no platform of the station is connected to the tile by track.
+ */
+bool IsRailStationConnected(TileIndex tile, StationID station)
+{
+	UpdateRailComponents();
+	TileIndex root = FindRailComponent(tile);
+
+	const BaseStation *st = BaseStation::Get(station);
+	TILE_AREA_LOOP(station_tile, st->train_station) {
+		if (st->TileBelongsToRailStation(station_tile) && FindRailComponent(station_tile) == root) return true;
+	}
+	return false;
+}
+
+/**
+ * Can a train get from a tile to any rail depot at all?
+ * @param tile The tile.
+ * @return False if no depot is connected to the tile by track.
+ */
+bool HasConnectedRailDepot(TileIndex tile)
+{
+	UpdateRailComponents();
+	return (_rail_component_parent[FindRailComponent(tile)] & ~RC_ROOT) != 0;
+}
+
+/**
+ * Get the number of tiles between a tile and the nearest rail depot connected to it.
+ * Track direction, signals and owners are ignored, so no train needs fewer tiles.
+ * @param tile The tile.
+ * @return The number of tiles; large distances are all reported as 255.
+ */
+uint GetRailDepotDistance(TileIndex tile)
+{
+	UpdateRailComponents();
+	if (!_rail_depot_distances_valid) RebuildRailDepotDistances();
+	return _rail_depot_distance[tile];
+}
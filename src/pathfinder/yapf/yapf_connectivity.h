@@ -0,0 +1,24 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file yapf_connectivity.h Connected components of the rail network and distances to depots. */
+
+#ifndef YAPF_CONNECTIVITY_H
+#define YAPF_CONNECTIVITY_H
+
+#include "../../tile_type.h"
+#include "../../station_type.h"
+
+void NotifyRailConnectivityChange(TileIndex tile);
+bool AreRailTilesConnected(TileIndex tile1, TileIndex tile2);
+bool IsRailStationConnected(TileIndex tile, StationID station);
+bool HasConnectedRailDepot(TileIndex tile);
+uint GetRailDepotDistance(TileIndex tile);
+
+#endif /* YAPF_CONNECTIVITY_H */
@@ -82,6 +82,12 @@ public:
 		return false;
 	}
 
+	/** Get the segments calculated without the global cache by this pathfinder. */
+	inline const LocalCache &GetLocalCache() const
+	{
+		return m_local_cache;
+	}
+
 	/**
 	 * Called by YAPF to flush the cached segment cost data back into cache storage.
 	 *  Current cache implementation doesn't use that.
@@ -101,11 +107,42 @@ public:
  */
 struct CSegmentCostCacheBase
 {
+	static const uint REGION_BITS = 4;      ///< log2 of the side length (in tiles) of one invalidation region
+	static const uint MAX_CHECKED_REGIONS = 64; ///< segments spanning more regions are checked against the last change anywhere
+
 	static int   s_rail_change_counter;
+	static uint32 s_change_stamp;           ///< incremented on every local track layout change
+	static SmallVector<uint32, 1> s_region_stamps; ///< value of s_change_stamp at the last change within each region
+
+	static void NotifyTrackLayoutChange(TileIndex tile, Track track);
 
-	static void NotifyTrackLayoutChange(TileIndex tile, Track track)
+	/**
+	 * Check whether the track layout around the given area is unchanged since a segment was calculated.
+	 * @param x0 Western x coordinate of the area.
+	 * @param y0 Northern y coordinate of the area.
+	 * @param x1 Eastern x coordinate of the area.
+	 * @param y1 Southern y coordinate of the area.
+	 * @param stamp Value of s_change_stamp when the segment was calculated.
+	 * @return True if no region touching the area (or its direct neighbour tiles) changed.
+	 */
+	static inline bool IsAreaUnchanged(uint x0, uint y0, uint x1, uint y1, uint32 stamp)
 	{
-		s_rail_change_counter++;
+		if (stamp == s_change_stamp) return true;
+
+		uint rx0 = (x0 > 0 ? x0 - 1 : 0) >> REGION_BITS;
+		uint ry0 = (y0 > 0 ? y0 - 1 : 0) >> REGION_BITS;
+		uint rx1 = min(x1 + 1, MapMaxX()) >> REGION_BITS;
+		uint ry1 = min(y1 + 1, MapMaxY()) >> REGION_BITS;
+		if ((rx1 - rx0 + 1) * (ry1 - ry0 + 1) > MAX_CHECKED_REGIONS) return false;
+
+		uint width = MapSizeX() >> REGION_BITS;
+		for (uint ry = ry0; ry <= ry1; ry++) {
+			const uint32 *region = s_region_stamps.Get(ry * width + rx0);
+			for (uint rx = rx0; rx <= rx1; rx++, region++) {
+				if (*region > stamp) return false;
+			}
+		}
+		return true;
 	}
 };
 
@@ -149,6 +186,12 @@ struct CSegmentCostCacheT
 			*found = false;
 			item = new (m_heap.Append()) Tsegment(key);
 			m_map.Push(*item);
+		} else if (!item->IsUpToDate()) {
+			/* The track layout around the segment changed, recalculate it in place. */
+			*found = false;
+			Tsegment *next = item->GetHashNext();
+			new (item) Tsegment(key);
+			item->SetHashNext(next);
 		} else {
 			*found = true;
 		}
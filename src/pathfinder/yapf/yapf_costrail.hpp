@@ -385,6 +385,9 @@ public:
 
 no_entry_cost: // jump here at the beginning if the node has no parent (it is the first node)
 
+			/* The cached segment cost depends on this tile. */
+			segment.AddTile(cur.tile);
+
 			/* All other tile costs will be calculated here. */
 			segment_cost += Yapf().OneTileCost(cur.tile, cur.td);
 
@@ -490,6 +493,8 @@ no_entry_cost: // jump here at the beginning if the node has no parent (it is th
 
 			if (!tf_local.Follow(cur.tile, cur.td)) {
 				assert(tf_local.m_err != TrackFollower::EC_NONE);
+				/* The far end of a tunnel/bridge was checked, too. */
+				if (tf_local.m_new_tile != INVALID_TILE) segment.AddTile(tf_local.m_new_tile);
 				/* Can't move to the next tile (EOL?). */
 				if (tf_local.m_err == TrackFollower::EC_RAIL_TYPE) {
 					end_segment_reason |= ESRB_RAIL_TYPE;
@@ -503,6 +508,9 @@ no_entry_cost: // jump here at the beginning if the node has no parent (it is th
 				break;
 			}
 
+			/* The next tile decides where the segment ends. */
+			segment.AddTile(tf_local.m_new_tile);
+
 			/* Check if the next tile is not a choice. */
 			if (KillFirstBit(tf_local.m_new_td_bits) != TRACKDIR_BIT_NONE) {
 				/* More than one segment will follow. Close this one. */
@@ -571,6 +579,7 @@ no_entry_cost: // jump here at the beginning if the node has no parent (it is th
 			/* Write back the segment information so it can be reused the next time. */
 			segment.m_cost = segment_cost;
 			segment.m_end_segment_reason = end_segment_reason & ESRB_CACHED_MASK;
+			segment.m_stamp = CSegmentCostCacheBase::s_change_stamp;
 			/* Save end of segment back to the node. */
 			n.SetLastTileTrackdir(cur.tile, cur.td);
 		}
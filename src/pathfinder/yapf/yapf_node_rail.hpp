@@ -142,6 +142,11 @@ struct CYapfRailSegment
 	TileIndex              m_last_signal_tile;
 	Trackdir               m_last_signal_td;
 	EndSegmentReasonBits   m_end_segment_reason;
+	uint32                 m_stamp;      ///< CSegmentCostCacheBase::s_change_stamp when the cost was calculated
+	uint16                 m_min_x;      ///< western border of the tiles the cost depends on
+	uint16                 m_min_y;      ///< northern border of the tiles the cost depends on
+	uint16                 m_max_x;      ///< eastern border of the tiles the cost depends on
+	uint16                 m_max_y;      ///< southern border of the tiles the cost depends on
 	CYapfRailSegment      *m_hash_next;
 
 	inline CYapfRailSegment(const CYapfRailSegmentKey& key)
@@ -152,6 +157,11 @@ struct CYapfRailSegment
 		, m_last_signal_tile(INVALID_TILE)
 		, m_last_signal_td(INVALID_TRACKDIR)
 		, m_end_segment_reason(ESRB_NONE)
+		, m_stamp(CSegmentCostCacheBase::s_change_stamp)
+		, m_min_x(UINT16_MAX)
+		, m_min_y(UINT16_MAX)
+		, m_max_x(0)
+		, m_max_y(0)
 		, m_hash_next(NULL)
 	{}
 
@@ -175,6 +185,23 @@ struct CYapfRailSegment
 		m_hash_next = next;
 	}
 
+	/** Extend the area the segment cost depends on by the given tile. */
+	inline void AddTile(TileIndex tile)
+	{
+		uint x = TileX(tile);
+		uint y = TileY(tile);
+		if (x < m_min_x) m_min_x = x;
+		if (y < m_min_y) m_min_y = y;
+		if (x > m_max_x) m_max_x = x;
+		if (y > m_max_y) m_max_y = y;
+	}
+
+	/** Is the cached cost still valid for the current track layout? */
+	inline bool IsUpToDate() const
+	{
+		return m_cost < 0 || CSegmentCostCacheBase::IsAreaUnchanged(m_min_x, m_min_y, m_max_x, m_max_y, m_stamp);
+	}
+
 	void Dump(DumpTarget &dmp) const
 	{
 		dmp.WriteStructT("m_key", &m_key);
@@ -12,6 +12,180 @@
 #ifndef YAPF_NODE_ROAD_HPP
 #define YAPF_NODE_ROAD_HPP
 
+/** key for cached road segments: where the segment starts and who drives on it */
+struct CYapfRoadSegmentKey
+{
+	TileIndex m_tile;      ///< first tile of the segment
+	Trackdir  m_td;        ///< trackdir on the first tile
+	RoadTypes m_roadtypes; ///< road types the vehicle can drive on
+	Owner     m_owner;     ///< owner of the vehicle, for the road stops and depots it may use
+
+	inline CYapfRoadSegmentKey(TileIndex tile, Trackdir td, RoadTypes roadtypes, Owner owner)
+		: m_tile(tile)
+		, m_td(td)
+		, m_roadtypes(roadtypes)
+		, m_owner(owner)
+	{}
+
+	inline int32 CalcHash() const
+	{
+		return ((((int)m_tile) << 4) | m_td) ^ (m_roadtypes << 8) ^ (m_owner << 10);
+	}
+
+	inline bool operator == (const CYapfRoadSegmentKey& other) const
+	{
+		return m_tile == other.m_tile && m_td == other.m_td && m_roadtypes == other.m_roadtypes && m_owner == other.m_owner;
+	}
+
+	void Dump(DumpTarget &dmp) const
+	{
+		dmp.WriteTile("m_tile", m_tile);
+		dmp.WriteEnumT("m_td", m_td);
+		dmp.WriteLine("m_roadtypes = %d", m_roadtypes);
+		dmp.WriteLine("m_owner = %d", m_owner);
+	}
+};
+
+/**
+ * Cached road segment for road YAPF: the road from a junction to the next one.
+ *  Only the part of the cost that depends on the map is cached; the tiles of road
+ *  stops and the speed limits on the way are remembered so the cost caused by
+ *  other vehicles and by the speed of the vehicle can be added without walking
+ *  the segment again.
+ */
+struct CYapfRoadSegment
+{
+	typedef CYapfRoadSegmentKey Key;
+
+	static const uint MAX_STOP_TILES   = 8; ///< road stop and depot tiles remembered per segment
+	static const uint MAX_SPEED_LIMITS = 4; ///< different speed limits remembered per segment
+
+	/** Road stop or depot tile on the segment. */
+	struct StopTile {
+		TileIndex tile;    ///< the tile
+		Trackdir  td;      ///< trackdir the tile is driven on
+	};
+
+	/** Number of tiles driven at a certain speed limit. */
+	struct SpeedLimit {
+		int  speed;        ///< the speed limit
+		uint count;        ///< number of tiles with this limit
+	};
+
+	CYapfRoadSegmentKey    m_key;
+	TileIndex              m_last_tile;
+	Trackdir               m_last_td;
+	int                    m_cost;       ///< cost of the segment apart from other vehicles and speed limits, -1 if not calculated
+	bool                   m_loop;       ///< the road is a loop without any junction
+	bool                   m_incomplete; ///< not all stop tiles or speed limits could be remembered
+	byte                   m_num_stop_tiles;
+	byte                   m_num_speed_limits;
+	StopTile               m_stop_tiles[MAX_STOP_TILES];
+	SpeedLimit             m_speed_limits[MAX_SPEED_LIMITS];
+	uint32                 m_stamp;      ///< CSegmentCostCacheBase::s_change_stamp when the segment was calculated
+	uint16                 m_min_x;      ///< western border of the tiles the segment depends on
+	uint16                 m_min_y;      ///< northern border of the tiles the segment depends on
+	uint16                 m_max_x;      ///< eastern border of the tiles the segment depends on
+	uint16                 m_max_y;      ///< southern border of the tiles the segment depends on
+	CYapfRoadSegment      *m_hash_next;
+
+	inline CYapfRoadSegment(const CYapfRoadSegmentKey& key)
+		: m_key(key)
+		, m_last_tile(INVALID_TILE)
+		, m_last_td(INVALID_TRACKDIR)
+		, m_cost(-1)
+		, m_loop(false)
+		, m_incomplete(false)
+		, m_num_stop_tiles(0)
+		, m_num_speed_limits(0)
+		, m_stamp(CSegmentCostCacheBase::s_change_stamp)
+		, m_min_x(UINT16_MAX)
+		, m_min_y(UINT16_MAX)
+		, m_max_x(0)
+		, m_max_y(0)
+		, m_hash_next(NULL)
+	{}
+
+	inline const Key& GetKey() const
+	{
+		return m_key;
+	}
+
+	inline CYapfRoadSegment *GetHashNext()
+	{
+		return m_hash_next;
+	}
+
+	inline void SetHashNext(CYapfRoadSegment *next)
+	{
+		m_hash_next = next;
+	}
+
+	/** Extend the area the segment depends on by the given tile. */
+	inline void AddTile(TileIndex tile)
+	{
+		uint x = TileX(tile);
+		uint y = TileY(tile);
+		if (x < m_min_x) m_min_x = x;
+		if (y < m_min_y) m_min_y = y;
+		if (x > m_max_x) m_max_x = x;
+		if (y > m_max_y) m_max_y = y;
+	}
+
+	/** Is the tile within the area of the segment? */
+	inline bool IsInArea(TileIndex tile) const
+	{
+		uint x = TileX(tile);
+		uint y = TileY(tile);
+		return x >= m_min_x && x <= m_max_x && y >= m_min_y && y <= m_max_y;
+	}
+
+	/** Remember a road stop or depot tile on the segment. */
+	inline void AddStopTile(TileIndex tile, Trackdir td)
+	{
+		if (m_num_stop_tiles == MAX_STOP_TILES) {
+			m_incomplete = true;
+			return;
+		}
+		m_stop_tiles[m_num_stop_tiles].tile = tile;
+		m_stop_tiles[m_num_stop_tiles].td = td;
+		m_num_stop_tiles++;
+	}
+
+	/** Remember that one tile of the segment has the given speed limit. */
+	inline void AddSpeedLimit(int speed)
+	{
+		for (uint i = 0; i < m_num_speed_limits; i++) {
+			if (m_speed_limits[i].speed == speed) {
+				m_speed_limits[i].count++;
+				return;
+			}
+		}
+		if (m_num_speed_limits == MAX_SPEED_LIMITS) {
+			m_incomplete = true;
+			return;
+		}
+		m_speed_limits[m_num_speed_limits].speed = speed;
+		m_speed_limits[m_num_speed_limits].count = 1;
+		m_num_speed_limits++;
+	}
+
+	/** Is the cached segment still valid for the current road layout? */
+	inline bool IsUpToDate() const
+	{
+		return m_cost < 0 || CSegmentCostCacheBase::IsAreaUnchanged(m_min_x, m_min_y, m_max_x, m_max_y, m_stamp);
+	}
+
+	void Dump(DumpTarget &dmp) const
+	{
+		dmp.WriteStructT("m_key", &m_key);
+		dmp.WriteTile("m_last_tile", m_last_tile);
+		dmp.WriteEnumT("m_last_td", m_last_td);
+		dmp.WriteLine("m_cost = %d", m_cost);
+		dmp.WriteLine("m_loop = %s", m_loop ? "Yes" : "No");
+	}
+};
+
 /** Yapf Node for road YAPF */
 template <class Tkey_>
 struct CYapfRoadNodeT
@@ -16,8 +16,12 @@
 #include "yapf_node_rail.hpp"
 #include "yapf_costrail.hpp"
 #include "yapf_destrail.hpp"
+#include "yapf_connectivity.h"
 #include "../../viewport_func.h"
 #include "../../newgrf_station.h"
+#include "../../waypoint_base.h"
+#include "../../core/sort_func.hpp"
+#include "../../thread/thread.h"
 
 #define DEBUG_YAPF_CACHE 0
 
@@ -37,6 +41,18 @@ template <typename Tpf> void DumpState(Tpf &pf1, Tpf &pf2)
 #endif
 
 int _total_pf_time_us = 0;
+static ThreadMutex *_total_pf_time_mutex = ThreadMutex::New(); ///< Protects #_total_pf_time_us against the prefetching threads.
+
+/**
+ * Account pathfinder time for the daily debug statistics.
+ * @param us Time spent in microseconds.
+ */
+void AddTotalPfTime(int us)
+{
+	_total_pf_time_mutex->BeginCritical();
+	_total_pf_time_us += us;
+	_total_pf_time_mutex->EndCritical();
+}
 
 template <class Types>
 class CYapfReserveTrack
@@ -126,6 +142,14 @@ private:
 		return (tile != m_res_dest || td != m_res_dest_td) && (tile != m_res_fail_tile || td != m_res_fail_td);
 	}
 
+	/** Invalidate cached segments around a newly reserved track. */
+	bool NotifyReservedTrack(TileIndex tile, Trackdir td)
+	{
+		/* Reserving doesn't change the connectivity of the network. */
+		CSegmentCostCacheBase::NotifyTrackLayoutChange(tile, TrackdirToTrack(td));
+		return tile != m_res_dest || td != m_res_dest_td;
+	}
+
 public:
 	/** Set the target to where the reservation should be extended. */
 	inline void SetReservationTarget(Node *node, TileIndex tile, Trackdir td)
@@ -182,7 +206,9 @@ public:
 		if (target != NULL) target->okay = true;
 
 		if (Yapf().CanUseGlobalCache(*m_res_node)) {
-			YapfNotifyTrackLayoutChange(INVALID_TILE, INVALID_TRACK);
+			for (Node *node = m_res_node; node->m_parent != NULL; node = node->m_parent) {
+				node->IterateTiles(Yapf().GetVehicle(), Yapf(), *this, &CYapfReserveTrack<Types>::NotifyReservedTrack);
+			}
 		}
 
 		return true;
@@ -427,16 +453,37 @@ public:
 
 	inline Trackdir ChooseRailTrack(const Train *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, bool reserve_track, PBSTileInfo *target)
 	{
-		if (target != NULL) target->tile = INVALID_TILE;
-
 		/* set origin and destination nodes */
-		PBSTileInfo origin = FollowTrainReservation(v);
-		Yapf().SetOrigin(origin.tile, origin.trackdir, INVALID_TILE, INVALID_TRACKDIR, 1, true);
-		Yapf().SetDestination(v);
+		SetChooseRailTrackEnds(v, FollowTrainReservation(v));
 
 		/* find the best path */
 		path_found = Yapf().FindPath(v);
 
+		return ApplyChooseRailTrackResult(path_found, reserve_track, target);
+	}
+
+	/**
+	 * Set up the search of ChooseRailTrack().
+	 * @param v The train.
+	 * @param origin End of the current reservation of the train.
+	 */
+	inline void SetChooseRailTrackEnds(const Train *v, const PBSTileInfo &origin)
+	{
+		Yapf().SetOrigin(origin.tile, origin.trackdir, INVALID_TILE, INVALID_TRACKDIR, 1, true);
+		Yapf().SetDestination(v);
+	}
+
+	/**
+	 * Pick the track and reserve the path once the search of ChooseRailTrack() is done.
+	 * @param path_found [in,out] Was the destination found?
+	 * @param reserve_track Should the path be reserved?
+	 * @param target [out] End of the reserved path.
+	 * @return The trackdir to follow or INVALID_TRACKDIR.
+	 */
+	inline Trackdir ApplyChooseRailTrackResult(bool &path_found, bool reserve_track, PBSTileInfo *target)
+	{
+		if (target != NULL) target->tile = INVALID_TILE;
+
 		/* if path not found - return INVALID_TRACKDIR */
 		Trackdir next_trackdir = INVALID_TRACKDIR;
 		Node *pNode = Yapf().GetBestNode();
@@ -536,8 +583,520 @@ struct CYapfAnySafeTileRail1 : CYapfT<CYapfRail_TypesT<CYapfAnySafeTileRail1, CF
 struct CYapfAnySafeTileRail2 : CYapfT<CYapfRail_TypesT<CYapfAnySafeTileRail2, CFollowTrackFreeRailNo90, CRailNodeListTrackDir, CYapfDestinationAnySafeTileRailT , CYapfFollowAnySafeTileRailT> > {};
 
 
+static const uint PREFETCH_BLOCK_BITS      = 3;   ///< log2 of the side length (in tiles) of the map blocks a prefetched search remembers
+static const uint PREFETCH_BLOCK_SIZE      = 1 << PREFETCH_BLOCK_BITS;
+static const uint MAX_PREFETCH_TILES       = 64;  ///< How far ahead of a reservation to look for the next choice.
+/* A map block takes 64 * (8 + 2) bytes in a snapshot, so all kept searches together take at most about 10 MB. */
+static const uint MAX_PREFETCHED_SEARCHES  = 64;  ///< Maximum number of searches kept at once.
+static const uint MAX_PREFETCH_BLOCKS      = 256; ///< Searches depending on more map blocks than this aren't kept.
+static const uint MAX_PREFETCH_THREADS     = 8;   ///< Maximum number of threads doing train path searches.
+static const uint MIN_PREFETCHES_PER_THREAD = 4;  ///< Don't start a thread for less searches than this.
+
+/**
+ * A ChooseRailTrack() search done in advance for a train that will probably
+ * need it soon. All searches of a tick are done in parallel before the vehicles
+ * move; the result is only used if the train asks the pathfinder the very same
+ * question and the map around everything the search looked at didn't change,
+ * i.e. if a search at that time would give the same answer.
+ */
+struct CYapfRailPrefetch {
+	VehicleID veh;                ///< Train the search is for.
+	PBSTileInfo origin;           ///< End of the reservation the search starts at.
+	OrderType order_type;         ///< Type of the current order of the train.
+	DestinationID order_dest;     ///< Destination of the current order of the train.
+	TileIndex dest_tile;          ///< Destination tile of the train.
+	TileIndex station_tile;       ///< Tile of the destination station closest to the train.
+	RailTypes railtypes;          ///< Rail types the train can use.
+	Owner owner;                  ///< Owner of the train.
+	uint16 length;                ///< Total length of the train.
+	uint16 max_speed;             ///< Maximum speed of the train.
+	bool forbid_90_deg;           ///< Pathfinder setting used for the search.
+	YAPFSettings settings;        ///< Pathfinder settings used for the search.
+	bool path_found;              ///< Result of the search.
+	bool usable;                  ///< Can the result be used at all?
+	SmallVector<uint32, 32> blocks;          ///< Sorted indices of the map blocks the search depends on.
+	SmallVector<Tile, 256> tiles;            ///< Contents of these blocks at search time.
+	SmallVector<TileExtended, 256> tiles_ext; ///< Extended contents of these blocks at search time.
+
+	virtual ~CYapfRailPrefetch() {}
+
+	/** Do the search. Only reads the game state. */
+	virtual void Search() = 0;
+
+	/**
+	 * Use the result of the search, reserving the path if requested.
+	 * @see CYapfFollowRailT::ApplyChooseRailTrackResult
+	 */
+	virtual Trackdir Apply(bool &path_found, bool reserve_track, PBSTileInfo *target) = 0;
+
+	/**
+	 * Set up the key of the search.
+	 * @param v The train.
+	 * @param origin End of the reservation the search will start at.
+	 */
+	void SetKey(const Train *v, const PBSTileInfo &origin)
+	{
+		this->veh = v->index;
+		this->origin = origin;
+		this->order_type = v->current_order.GetType();
+		this->order_dest = v->current_order.GetDestination();
+		this->dest_tile = v->dest_tile;
+		this->station_tile = GetStationTile(v);
+		this->railtypes = v->compatible_railtypes;
+		this->owner = v->owner;
+		this->length = v->gcache.cached_total_length;
+		this->max_speed = v->GetDisplayMaxSpeed();
+		this->forbid_90_deg = _settings_game.pf.forbid_90_deg;
+		MemCpyT(&this->settings, &_settings_game.pf.yapf);
+	}
+
+	/**
+	 * Would a search for the train now get the same input?
+	 * @param v The train.
+	 * @param origin End of the current reservation of the train.
+	 * @return True if everything the search reads from the train and the settings is unchanged.
+	 */
+	bool MatchesKey(const Train *v, const PBSTileInfo &origin) const
+	{
+		return this->veh == v->index && this->origin.tile == origin.tile && this->origin.trackdir == origin.trackdir &&
+				this->order_type == v->current_order.GetType() && this->order_dest == v->current_order.GetDestination() &&
+				this->dest_tile == v->dest_tile && this->station_tile == GetStationTile(v) &&
+				this->railtypes == v->compatible_railtypes && this->owner == v->owner &&
+				this->length == v->gcache.cached_total_length && this->max_speed == v->GetDisplayMaxSpeed() &&
+				this->forbid_90_deg == _settings_game.pf.forbid_90_deg && MemCmpT(&this->settings, &_settings_game.pf.yapf) == 0;
+	}
+
+	/**
+	 * Remember the map blocks around the given segments.
+	 * @param segments The segments calculated by the search.
+	 * @return False if the search looked at too much of the map to remember it.
+	 */
+	template <class Tsegments>
+	bool TakeSnapshot(const Tsegments &segments)
+	{
+		SmallVector<uint32, 64> touched;
+		uint width = MapSizeX() >> PREFETCH_BLOCK_BITS;
+		for (uint i = 0; i < segments.Length(); i++) {
+			const CYapfRailSegment &seg = segments[i];
+			if (seg.m_min_x > seg.m_max_x) continue;
+
+			/* Costs depend on the direct neighbours of the segment tiles as well. */
+			uint bx0 = (seg.m_min_x > 0 ? seg.m_min_x - 1 : 0) >> PREFETCH_BLOCK_BITS;
+			uint by0 = (seg.m_min_y > 0 ? seg.m_min_y - 1 : 0) >> PREFETCH_BLOCK_BITS;
+			uint bx1 = min<uint>(seg.m_max_x + 1, MapMaxX()) >> PREFETCH_BLOCK_BITS;
+			uint by1 = min<uint>(seg.m_max_y + 1, MapMaxY()) >> PREFETCH_BLOCK_BITS;
+			for (uint by = by0; by <= by1; by++) {
+				for (uint bx = bx0; bx <= bx1; bx++) {
+					*touched.Append() = by * width + bx;
+				}
+			}
+		}
+
+		QSortT(touched.Begin(), touched.Length(), &CompareBlocks);
+		for (const uint32 *b = touched.Begin(); b != touched.End(); b++) {
+			if (b == touched.Begin() || *b != b[-1]) *this->blocks.Append() = *b;
+		}
+		if (this->blocks.Length() > MAX_PREFETCH_BLOCKS) return false;
+
+		for (const uint32 *b = this->blocks.Begin(); b != this->blocks.End(); b++) {
+			for (uint row = 0; row < PREFETCH_BLOCK_SIZE; row++) {
+				TileIndex t = GetBlockRow(*b, row);
+				MemCpyT(this->tiles.Append(PREFETCH_BLOCK_SIZE), GetTile(t), PREFETCH_BLOCK_SIZE);
+				MemCpyT(this->tiles_ext.Append(PREFETCH_BLOCK_SIZE), GetTileEx(t), PREFETCH_BLOCK_SIZE);
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Is the map around everything the search looked at unchanged?
+	 * @return True if all remembered map blocks are unchanged.
+	 */
+	bool IsSnapshotValid() const
+	{
+		const Tile *tile = this->tiles.Begin();
+		const TileExtended *tile_ext = this->tiles_ext.Begin();
+		for (const uint32 *b = this->blocks.Begin(); b != this->blocks.End(); b++) {
+			for (uint row = 0; row < PREFETCH_BLOCK_SIZE; row++, tile += PREFETCH_BLOCK_SIZE, tile_ext += PREFETCH_BLOCK_SIZE) {
+				TileIndex t = GetBlockRow(*b, row);
+				if (MemCmpT(tile, GetTile(t), PREFETCH_BLOCK_SIZE) != 0) return false;
+				if (MemCmpT(tile_ext, GetTileEx(t), PREFETCH_BLOCK_SIZE) != 0) return false;
+			}
+		}
+		return true;
+	}
+
+private:
+	/** Get the station tile the pathfinder heads for, see CYapfDestinationTileOrStationRailT::SetDestination. */
+	static TileIndex GetStationTile(const Train *v)
+	{
+		if (!v->current_order.IsType(OT_GOTO_STATION) && !v->current_order.IsType(OT_GOTO_WAYPOINT)) return INVALID_TILE;
+		return CalcClosestStationTile(v->current_order.GetDestination(), v->tile, v->current_order.IsType(OT_GOTO_STATION) ? STATION_RAIL : STATION_WAYPOINT);
+	}
+
+	/** Get the first tile of a row of a map block. */
+	static inline TileIndex GetBlockRow(uint32 block, uint row)
+	{
+		uint width = MapSizeX() >> PREFETCH_BLOCK_BITS;
+		return TileXY((block % width) << PREFETCH_BLOCK_BITS, ((block / width) << PREFETCH_BLOCK_BITS) + row);
+	}
+
+	/** Sort map blocks by index. */
+	static int CDECL CompareBlocks(const uint32 *a, const uint32 *b)
+	{
+		return (*a > *b) - (*a < *b);
+	}
+};
+
+/** Prefetched search with a specific pathfinder type. */
+template <class Tpf>
+struct CYapfRailPrefetchT : CYapfRailPrefetch {
+	Tpf pf; ///< The pathfinder doing the search.
+
+	/**
+	 * Set up a search for the given train.
+	 * @param v The train.
+	 * @param origin End of the reservation the search will start at.
+	 */
+	CYapfRailPrefetchT(const Train *v, const PBSTileInfo &origin)
+	{
+		this->SetKey(v, origin);
+		this->usable = false;
+		/* The global segment cache isn't thread safe, everything is calculated locally. */
+		this->pf.DisableCache(true);
+		this->pf.SetChooseRailTrackEnds(v, origin);
+	}
+
+	/* virtual */ void Search()
+	{
+		this->path_found = this->pf.FindPath(Train::Get(this->veh));
+		this->usable = this->TakeSnapshot(this->pf.GetLocalCache());
+		/* Only the best path is needed later on, the node list can be reused right away. */
+		this->pf.ReleaseNodes();
+	}
+
+	/* virtual */ Trackdir Apply(bool &path_found, bool reserve_track, PBSTileInfo *target)
+	{
+		/* A search without prefetching would have used the global cache. */
+		this->pf.DisableCache(false);
+		path_found = this->path_found;
+		return this->pf.ApplyChooseRailTrackResult(path_found, reserve_track, target);
+	}
+};
+
+static SmallVector<CYapfRailPrefetch *, 64> _rail_prefetches; ///< Prefetched searches, sorted by vehicle index; NULL once used.
+static CYapfRailPrefetch **_rail_prefetch_queue;               ///< New searches still to do.
+static uint _rail_prefetch_queue_length;                       ///< Number of new searches.
+static uint _rail_prefetch_next;                               ///< Next search to hand to a thread.
+static ThreadMutex *_rail_prefetch_mutex = NULL;               ///< Mutex protecting #_rail_prefetch_next.
+
+/** A thread of the pool doing prefetched searches. */
+struct RailPrefetchThread {
+	ThreadObject *thread; ///< The thread.
+	ThreadMutex *mutex;   ///< Mutex protecting #busy, signalled whenever it changes.
+	bool busy;            ///< Does the thread have to work on the queue? Cleared by the thread when it's done.
+};
+
+static RailPrefetchThread _rail_prefetch_threads[MAX_PREFETCH_THREADS - 1]; ///< The threads helping the main thread.
+static uint _rail_prefetch_num_threads = 0;                                 ///< Number of threads started so far.
+
+/** Delete all prefetched searches. */
+static void ClearRailPrefetches()
+{
+	for (CYapfRailPrefetch **p = _rail_prefetches.Begin(); p != _rail_prefetches.End(); p++) delete *p;
+	_rail_prefetches.Clear();
+}
+
+/**
+ * Is the destination of a train definitely not reachable by track from a tile?
+ * @param v The train.
+ * @param tile The tile the search would start at.
+ * @return True if no track connects the tile with the destination.
+ */
+static bool IsRailDestinationUnreachable(const Train *v, TileIndex tile)
+{
+	switch (v->current_order.GetType()) {
+		case OT_GOTO_STATION:
+		case OT_GOTO_WAYPOINT:
+			return !IsRailStationConnected(tile, v->current_order.GetDestination());
+
+		case OT_GOTO_DEPOT:
+			return v->dest_tile != INVALID_TILE && !AreRailTilesConnected(tile, v->dest_tile);
+
+		default:
+			return false;
+	}
+}
+
+/**
+ * Predict whether a train will ask the pathfinder for a path soon.
+ * Mirrors what ChooseTrainTrack() does on the next choice without changing
+ * anything: the reservation is followed to the next choice or possible target.
+ * @param v The train.
+ * @param origin [out] End of the reservation the search would start at.
+ * @return True if a search is expected.
+ */
+static bool PredictRailSearch(const Train *v, PBSTileInfo *origin)
+{
+	if ((v->vehstatus & (VS_CRASHED | VS_STOPPED)) != 0 || v->track == TRACK_BIT_DEPOT) return false;
+	if (v->cur_speed == 0 && !HasBit(v->flags, VRF_TRAIN_STUCK)) return false;
+
+	/* Orders that are advanced before the search can't be predicted. */
+	switch (v->current_order.GetType()) {
+		case OT_GOTO_STATION:
+		case OT_GOTO_DEPOT:
+			break;
+
+		case OT_GOTO_WAYPOINT:
+			/* Complex waypoints are searched with a look ahead that isn't covered by the map snapshot. */
+			if (!Waypoint::Get(v->current_order.GetDestination())->IsSingleTile()) return false;
+			break;
+
+		default:
+			return false;
+	}
+
+	/* The search would be skipped anyway. */
+	if (IsRailDestinationUnreachable(v, v->tile)) return false;
+
+	PBSTileInfo res = FollowTrainReservation(v);
+	bool reserving = _settings_game.pf.reserve_paths || HasReservedTracks(v->tile, TrackToTrackBits(TrackdirToTrack(v->GetVehicleTrackdir())));
+	/* Only trains close to the end of their reservation extend it. */
+	if (DistanceManhattan(v->tile, res.tile) > 1) return false;
+
+	CFollowTrackRail ft(v);
+	TileIndex tile = res.tile;
+	Trackdir td = res.trackdir;
+	for (uint i = 0; i < MAX_PREFETCH_TILES; i++) {
+		if (!ft.Follow(tile, td)) return false;
+
+		if (KillFirstBit(ft.m_new_td_bits) == TRACKDIR_BIT_NONE) {
+			if (HasOnewaySignalBlockingTrackdir(ft.m_new_tile, FindFirstTrackdir(ft.m_new_td_bits))) return false;
+		}
+
+		if (_settings_game.pf.forbid_90_deg) {
+			ft.m_new_td_bits &= ~TrackdirCrossesTrackdirs(ft.m_old_td);
+			if (ft.m_new_td_bits == TRACKDIR_BIT_NONE) return false;
+		}
+
+		bool target_seen = ft.m_is_station || (IsTileType(ft.m_new_tile, MP_RAILWAY) && !IsPlainRail(ft.m_new_tile));
+		if (target_seen || KillFirstBit(ft.m_new_td_bits) != TRACKDIR_BIT_NONE) {
+			if (HasReservedTracks(ft.m_new_tile, TrackdirBitsToTrackBits(TrackdirReachesTrackdirs(ft.m_old_td)))) return false;
+			*origin = PBSTileInfo(tile, td, false);
+			return true;
+		}
+
+		/* Without a reservation the train only searches when it is next to the choice. */
+		if (!reserving) return false;
+
+		tile = ft.m_new_tile;
+		td = FindFirstTrackdir(ft.m_new_td_bits);
+
+		/* The reservation would end at a safe position without a search. */
+		if (IsSafeWaitingPosition(v, tile, td, true, _settings_game.pf.forbid_90_deg)) return false;
+		if (HasReservedTracks(tile, TrackToTrackBits(TrackdirToTrack(td)))) return false;
+	}
+
+	return false;
+}
+
+/** Do searches of the queue until none are left. */
+static void DoRailPrefetches()
+{
+	for (;;) {
+		_rail_prefetch_mutex->BeginCritical();
+		uint i = _rail_prefetch_next++;
+		_rail_prefetch_mutex->EndCritical();
+
+		if (i >= _rail_prefetch_queue_length) return;
+		_rail_prefetch_queue[i]->Search();
+	}
+}
+
+/**
+ * Thread procedure of the prefetching threads. The threads live as long as
+ * the game and wait for work between the ticks.
+ * @param arg The RailPrefetchThread of the thread.
+ */
+static void RailPrefetchWorker(void *arg)
+{
+	RailPrefetchThread *self = (RailPrefetchThread *)arg;
+
+	self->mutex->BeginCritical();
+	for (;;) {
+		while (!self->busy) self->mutex->WaitForSignal();
+		self->mutex->EndCritical();
+
+		DoRailPrefetches();
+
+		self->mutex->BeginCritical();
+		self->busy = false;
+		self->mutex->SendSignal();
+	}
+}
+
+/**
+ * Make sure the given number of prefetching threads is running.
+ * @param count Wanted number of threads.
+ * @return Number of threads available, less than wanted if starting one failed.
+ */
+static uint StartRailPrefetchThreads(uint count)
+{
+	while (_rail_prefetch_num_threads < count) {
+		RailPrefetchThread *t = &_rail_prefetch_threads[_rail_prefetch_num_threads];
+		if (t->mutex == NULL) t->mutex = ThreadMutex::New();
+		t->busy = false;
+		if (!ThreadObject::New(&RailPrefetchWorker, t, &t->thread)) break;
+		_rail_prefetch_num_threads++;
+	}
+	return min(count, _rail_prefetch_num_threads);
+}
+
+void YapfTrainPrefetchPaths()
+{
+	if (!_settings_game.pf.yapf.rail_parallel_search || _settings_game.pf.pathfinder_for_trains != VPF_YAPF) {
+		ClearRailPrefetches();
+		return;
+	}
+
+	SmallVector<CYapfRailPrefetch *, 64> prefetches;
+	SmallVector<CYapfRailPrefetch *, 64> queue;
+	CYapfRailPrefetch **old = _rail_prefetches.Begin();
+
+	const Train *v;
+	FOR_ALL_TRAINS(v) {
+		if (!v->IsFrontEngine()) continue;
+
+		/* Searches of trains that moved on or vanished are useless now. */
+		while (old != _rail_prefetches.End() && (*old == NULL || (*old)->veh < v->index)) delete *old++;
+		CYapfRailPrefetch *p = NULL;
+		if (old != _rail_prefetches.End() && (*old)->veh == v->index) p = *old++;
+
+		PBSTileInfo origin;
+		if (prefetches.Length() >= MAX_PREFETCHED_SEARCHES || !PredictRailSearch(v, &origin)) {
+			delete p;
+			continue;
+		}
+
+		/* Keep the search of an earlier tick if it is still up to date. */
+		if (p != NULL && p->MatchesKey(v, origin) && p->IsSnapshotValid()) {
+			*prefetches.Append() = p;
+			continue;
+		}
+		delete p;
+
+		if (_settings_game.pf.forbid_90_deg) {
+			p = new CYapfRailPrefetchT<CYapfRail2>(v, origin);
+		} else {
+			p = new CYapfRailPrefetchT<CYapfRail1>(v, origin);
+		}
+		*prefetches.Append() = p;
+		*queue.Append() = p;
+	}
+	while (old != _rail_prefetches.End()) delete *old++;
+	_rail_prefetches.Clear();
+
+	if (queue.Length() > 0) {
+		if (_rail_prefetch_mutex == NULL) _rail_prefetch_mutex = ThreadMutex::New();
+		_rail_prefetch_queue = queue.Begin();
+		_rail_prefetch_queue_length = queue.Length();
+		_rail_prefetch_next = 0;
+
+		/* The pathfinder debug output isn't thread safe. */
+		uint num_threads = _debug_yapf_level >= 2 ? 1 : Clamp<uint>(GetCPUCoreCount(), 1, MAX_PREFETCH_THREADS);
+		num_threads = min(num_threads, max<uint>(1, queue.Length() / MIN_PREFETCHES_PER_THREAD));
+
+		/* This thread does its part of the work as well. */
+		uint num_workers = StartRailPrefetchThreads(num_threads - 1);
+		for (uint i = 0; i < num_workers; i++) {
+			RailPrefetchThread *t = &_rail_prefetch_threads[i];
+			t->mutex->BeginCritical();
+			t->busy = true;
+			t->mutex->SendSignal();
+			t->mutex->EndCritical();
+		}
+
+		DoRailPrefetches();
+
+		for (uint i = 0; i < num_workers; i++) {
+			RailPrefetchThread *t = &_rail_prefetch_threads[i];
+			t->mutex->BeginCritical();
+			while (t->busy) t->mutex->WaitForSignal();
+			t->mutex->EndCritical();
+		}
+	}
+
+	for (CYapfRailPrefetch **p = prefetches.Begin(); p != prefetches.End(); p++) {
+		if ((*p)->usable) {
+			*_rail_prefetches.Append() = *p;
+		} else {
+			delete *p;
+		}
+	}
+}
+
+/**
+ * Use a prefetched search for the train if it is up to date.
+ * @param v The train.
+ * @param path_found [out] Was the destination found?
+ * @param reserve_track Should the path be reserved?
+ * @param target [out] End of the reserved path.
+ * @param td [out] The trackdir to follow.
+ * @return True if a prefetched search was used.
+ */
+static bool ApplyRailPrefetch(const Train *v, bool &path_found, bool reserve_track, PBSTileInfo *target, Trackdir *td)
+{
+	CYapfRailPrefetch **p = _rail_prefetches.Begin();
+	while (p != _rail_prefetches.End() && (*p == NULL || (*p)->veh != v->index)) p++;
+	if (p == _rail_prefetches.End()) return false;
+
+	/* Whatever happens, the search is used up. */
+	CYapfRailPrefetch *prefetch = *p;
+	*p = NULL;
+
+	bool ok = prefetch->MatchesKey(v, FollowTrainReservation(v)) && prefetch->IsSnapshotValid();
+	if (ok) *td = prefetch->Apply(path_found, reserve_track, target);
+	delete prefetch;
+	return ok;
+}
+
+/**
+ * Choose a track without searching: the one leaving the tile closest to a destination.
+ * A full search to an unreachable destination would end up at the node closest to it as well.
+ * @param tile Tile the train is about to enter.
+ * @param enterdir Direction the train enters the tile in.
+ * @param tracks Tracks the train can choose from.
+ * @param dest Destination tile, or INVALID_TILE.
+ * @return The chosen track.
+ */
+static Track ChooseRailTrackTowards(TileIndex tile, DiagDirection enterdir, TrackBits tracks, TileIndex dest)
+{
+	Track best = FindFirstTrack(tracks);
+	if (dest == INVALID_TILE) return best;
+
+	uint best_distance = UINT_MAX;
+	Track track;
+	FOR_EACH_SET_TRACK(track, tracks) {
+		Trackdir td = TrackEnterdirToTrackdir(track, enterdir);
+		if (td == INVALID_TRACKDIR) continue;
+		TileIndex next = AddTileIndexDiffCWrap(tile, TileIndexDiffCByDiagDir(TrackdirToExitdir(td)));
+		uint distance = DistanceManhattan(next != INVALID_TILE ? next : tile, dest);
+		if (distance < best_distance) {
+			best_distance = distance;
+			best = track;
+		}
+	}
+	return best;
+}
+
 Track YapfTrainChooseTrack(const Train *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, bool reserve_track, PBSTileInfo *target)
 {
+	if (IsRailDestinationUnreachable(v, v->tile)) {
+		if (target != NULL) target->tile = INVALID_TILE;
+		path_found = false;
+		return ChooseRailTrackTowards(tile, enterdir, tracks, v->dest_tile);
+	}
+
 	/* default is YAPF type 2 */
 	typedef Trackdir (*PfnChooseRailTrack)(const Train*, TileIndex, DiagDirection, TrackBits, bool&, bool, PBSTileInfo*);
 	PfnChooseRailTrack pfnChooseRailTrack = &CYapfRail1::stChooseRailTrack;
@@ -547,7 +1106,10 @@ Track YapfTrainChooseTrack(const Train *v, TileIndex tile, DiagDirection enterdi
 		pfnChooseRailTrack = &CYapfRail2::stChooseRailTrack; // Trackdir, forbid 90-deg
 	}
 
-	Trackdir td_ret = pfnChooseRailTrack(v, tile, enterdir, tracks, path_found, reserve_track, target);
+	Trackdir td_ret;
+	if (!ApplyRailPrefetch(v, path_found, reserve_track, target, &td_ret)) {
+		td_ret = pfnChooseRailTrack(v, tile, enterdir, tracks, path_found, reserve_track, target);
+	}
 	return (td_ret != INVALID_TRACKDIR) ? TrackdirToTrack(td_ret) : FindFirstTrack(tracks);
 }
 
@@ -617,9 +1179,16 @@ FindDepotData YapfTrainFindNearestDepot(const Train *v, int max_penalty)
 	const Train *last_veh = v->Last();
 
 	PBSTileInfo origin = FollowTrainReservation(v);
+	if (!HasConnectedRailDepot(origin.tile)) return fdd;
+
 	TileIndex last_tile = last_veh->tile;
 	Trackdir td_rev = ReverseTrackdir(last_veh->GetVehicleTrackdir());
 
+	/* Every tile on the way costs at least a corner length, so there is no
+	 * need to search when the nearest depot is too far away anyway. */
+	uint depot_distance = min(GetRailDepotDistance(origin.tile), GetRailDepotDistance(last_tile));
+	if (max_penalty > 0 && (int)depot_distance * YAPF_TILE_CORNER_LENGTH > max_penalty) return fdd;
+
 	typedef bool (*PfnFindNearestDepotTwoWay)(const Train*, TileIndex, Trackdir, TileIndex, Trackdir, int, int, TileIndex*, bool*);
 	PfnFindNearestDepotTwoWay pfnFindNearestDepotTwoWay = &CYapfAnyDepotRail1::stFindNearestDepotTwoWay;
 
@@ -648,8 +1217,47 @@ bool YapfTrainFindNearestSafeTile(const Train *v, TileIndex tile, Trackdir td, b
 
 /** if any track changes, this counter is incremented - that will invalidate segment cost cache */
 int CSegmentCostCacheBase::s_rail_change_counter = 0;
+uint32 CSegmentCostCacheBase::s_change_stamp = 0;
+SmallVector<uint32, 1> CSegmentCostCacheBase::s_region_stamps;
+
+/**
+ * Mark the region containing the given tile as changed.
+ * @param tile Changed tile.
+ */
+static void MarkSegmentCostRegionChanged(TileIndex tile)
+{
+	uint width = MapSizeX() >> CSegmentCostCacheBase::REGION_BITS;
+	uint region = (TileY(tile) >> CSegmentCostCacheBase::REGION_BITS) * width + (TileX(tile) >> CSegmentCostCacheBase::REGION_BITS);
+	*CSegmentCostCacheBase::s_region_stamps.Get(region) = CSegmentCostCacheBase::s_change_stamp;
+}
+
+/**
+ * Track layout changed. Only cached segments around the changed tile are invalidated,
+ * unless the tile is not known; in that case the whole cache is flushed.
+ * @param tile Changed tile or INVALID_TILE.
+ * @param track Changed track.
+ */
+void CSegmentCostCacheBase::NotifyTrackLayoutChange(TileIndex tile, Track track)
+{
+	uint regions = MapSize() >> (2 * REGION_BITS);
+	if (tile == INVALID_TILE || s_region_stamps.Length() != regions || s_change_stamp == UINT32_MAX) {
+		/* Flush everything and start over with fresh stamps. */
+		ClearRailPrefetches();
+		s_rail_change_counter++;
+		s_change_stamp = 0;
+		s_region_stamps.Clear();
+		MemSetT(s_region_stamps.Append(regions), 0, regions);
+		return;
+	}
+
+	s_change_stamp++;
+	MarkSegmentCostRegionChanged(tile);
+	/* Only one end of a new tunnel/bridge is announced. */
+	if (IsTileType(tile, MP_TUNNELBRIDGE)) MarkSegmentCostRegionChanged(GetOtherTunnelBridgeEnd(tile));
+}
 
 void YapfNotifyTrackLayoutChange(TileIndex tile, Track track)
 {
 	CSegmentCostCacheBase::NotifyTrackLayoutChange(tile, track);
+	NotifyRailConnectivityChange(tile);
 }
@@ -15,6 +15,35 @@
 #include "../../roadstop_base.h"
 
 
+typedef CSegmentCostCacheT<CYapfRoadSegment> CRoadSegmentCache;
+
+/**
+ * Get the road segments cached for all road vehicles.
+ *  The cache is flushed whenever the whole map might have changed.
+ */
+static CRoadSegmentCache &GetRoadSegmentCache()
+{
+	static int last_rail_change_counter = 0;
+	static CRoadSegmentCache C;
+
+	if (last_rail_change_counter != CRoadSegmentCache::s_rail_change_counter) {
+		last_rail_change_counter = CRoadSegmentCache::s_rail_change_counter;
+		C.Flush();
+	}
+	return C;
+}
+
+/**
+ * Road layout changed. Road segments are checked against the same record of
+ *  changed map regions as the rail segments.
+ * @param tile Changed tile or INVALID_TILE.
+ */
+void YapfNotifyRoadLayoutChange(TileIndex tile)
+{
+	CSegmentCostCacheBase::NotifyTrackLayoutChange(tile, INVALID_TRACK);
+}
+
+
 template <class Types>
 class CYapfCostRoadT
 {
@@ -50,7 +79,7 @@ protected:
 		return 0;
 	}
 
-	/** return one tile cost */
+	/** return one tile cost, apart from the vehicles occupying road stops */
 	inline int OneTileCost(TileIndex tile, Trackdir trackdir)
 	{
 		int cost = 0;
@@ -65,24 +94,10 @@ protected:
 					}
 					break;
 
-				case MP_STATION: {
-					const RoadStop *rs = RoadStop::GetByTile(tile, GetRoadStopType(tile));
-					if (IsDriveThroughStopTile(tile)) {
-						/* Increase the cost for drive-through road stops */
-						cost += Yapf().PfGetSettings().road_stop_penalty;
-						DiagDirection dir = TrackdirToExitdir(trackdir);
-						if (!RoadStop::IsDriveThroughRoadStopContinuation(tile, tile - TileOffsByDiagDir(dir))) {
-							/* When we're the first road stop in a 'queue' of them we increase
-							 * cost based on the fill percentage of the whole queue. */
-							const RoadStop::Entry *entry = rs->GetEntry(dir);
-							cost += entry->GetOccupied() * Yapf().PfGetSettings().road_stop_occupied_penalty / entry->GetLength();
-						}
-					} else {
-						/* Increase cost for filled road stops */
-						cost += Yapf().PfGetSettings().road_stop_bay_occupied_penalty * (!rs->IsFreeBay(0) + !rs->IsFreeBay(1)) / 2;
-					}
+				case MP_STATION:
+					/* Increase the cost for drive-through road stops */
+					if (IsDriveThroughStopTile(tile)) cost += Yapf().PfGetSettings().road_stop_penalty;
 					break;
-				}
 
 				default:
 					break;
@@ -99,26 +114,63 @@ protected:
 		return cost;
 	}
 
-public:
+	/** return the cost of the vehicles occupying a road stop tile */
+	inline int RoadStopOccupancyCost(TileIndex tile, Trackdir trackdir)
+	{
+		if (!IsDiagonalTrackdir(trackdir)) return 0;
+
+		const RoadStop *rs = RoadStop::GetByTile(tile, GetRoadStopType(tile));
+		if (IsDriveThroughStopTile(tile)) {
+			DiagDirection dir = TrackdirToExitdir(trackdir);
+			if (RoadStop::IsDriveThroughRoadStopContinuation(tile, tile - TileOffsByDiagDir(dir))) return 0;
+
+			/* When we're the first road stop in a 'queue' of them we increase
+			 * cost based on the fill percentage of the whole queue. */
+			const RoadStop::Entry *entry = rs->GetEntry(dir);
+			return entry->GetOccupied() * Yapf().PfGetSettings().road_stop_occupied_penalty / entry->GetLength();
+		}
+
+		/* Increase cost for filled road stops */
+		return Yapf().PfGetSettings().road_stop_bay_occupied_penalty * (!rs->IsFreeBay(0) + !rs->IsFreeBay(1)) / 2;
+	}
+
+	/** return the penalty for driving a tile with the given speed limit */
+	inline int SpeedLimitCost(int max_speed)
+	{
+		int max_veh_speed = Yapf().GetVehicle()->GetDisplayMaxSpeed();
+		return max_speed < max_veh_speed ? max_veh_speed - max_speed : 0;
+	}
+
 	/**
-	 * Called by YAPF to calculate the cost from the origin to the given node.
-	 *  Calculates only the cost of given node, adds it to the parent node cost
-	 *  and stores the result into Node::m_cost member
+	 * Walk the road from the start of a segment to its end and fill in the segment.
+	 * @param segment The segment, its key tells where to start.
+	 * @param detect_destination Whether the segment should end at the destination of the vehicle.
+	 * @return The cost of the segment caused by other vehicles and the speed limits.
 	 */
-	inline bool PfCalcCost(Node& n, const TrackFollower *tf)
+	inline int CalcSegment(CYapfRoadSegment &segment, bool detect_destination)
 	{
 		int segment_cost = 0;
+		int vehicle_cost = 0;
 		uint tiles = 0;
-		/* start at n.m_key.m_tile / n.m_key.m_td and walk to the end of segment */
-		TileIndex tile = n.m_key.m_tile;
-		Trackdir trackdir = n.m_key.m_td;
+		/* start at the first tile of the segment and walk to its end */
+		TileIndex tile = segment.m_key.m_tile;
+		Trackdir trackdir = segment.m_key.m_td;
 		for (;;) {
+			segment.AddTile(tile);
+
 			/* base tile cost depending on distance between edges */
 			segment_cost += Yapf().OneTileCost(tile, trackdir);
 
-			const RoadVehicle *v = Yapf().GetVehicle();
+			/* remember the tiles that can be destinations or depend on other vehicles */
+			if (IsTileType(tile, MP_STATION)) {
+				segment.AddStopTile(tile, trackdir);
+				vehicle_cost += Yapf().RoadStopOccupancyCost(tile, trackdir);
+			} else if (IsRoadDepotTile(tile)) {
+				segment.AddStopTile(tile, trackdir);
+			}
+
 			/* we have reached the vehicle's destination - segment should end here to avoid target skipping */
-			if (Yapf().PfDetectDestinationTile(tile, trackdir)) break;
+			if (detect_destination && Yapf().PfDetectDestinationTile(tile, trackdir)) break;
 
 			/* stop if we have just entered the depot */
 			if (IsRoadDepotTile(tile) && trackdir == DiagDirToDiagTrackdir(ReverseDiagDir(GetRoadDepotDirection(tile)))) {
@@ -136,7 +188,10 @@ public:
 			Trackdir new_td = (Trackdir)FindFirstBit2x64(F.m_new_td_bits);
 
 			/* stop if RV is on simple loop with no junctions */
-			if (F.m_new_tile == n.m_key.m_tile && new_td == n.m_key.m_td) return false;
+			if (F.m_new_tile == segment.m_key.m_tile && new_td == segment.m_key.m_td) {
+				segment.m_loop = true;
+				break;
+			}
 
 			/* if we skipped some tunnel tiles, add their cost */
 			segment_cost += F.m_tiles_skipped * YAPF_TILE_LENGTH;
@@ -145,12 +200,12 @@ public:
 			/* add hilly terrain penalty */
 			segment_cost += Yapf().SlopeCost(tile, F.m_new_tile, trackdir);
 
-			/* add min/max speed penalties */
-			int min_speed = 0;
-			int max_veh_speed = v->GetDisplayMaxSpeed();
-			int max_speed = F.GetSpeedLimit(&min_speed);
-			if (max_speed < max_veh_speed) segment_cost += 1 * (max_veh_speed - max_speed);
-			if (min_speed > max_veh_speed) segment_cost += 10 * (min_speed - max_veh_speed);
+			/* add max speed penalty; roads have no minimum speed */
+			int max_speed = F.GetSpeedLimit();
+			if (max_speed != INT_MAX) {
+				segment.AddSpeedLimit(max_speed);
+				vehicle_cost += Yapf().SpeedLimitCost(max_speed);
+			}
 
 			/* move to the next tile */
 			tile = F.m_new_tile;
@@ -158,13 +213,58 @@ public:
 			if (tiles > MAX_MAP_SIZE) break;
 		}
 
+		segment.m_last_tile = tile;
+		segment.m_last_td = trackdir;
+		segment.m_cost = segment_cost;
+		return vehicle_cost;
+	}
+
+	/** return the cost of a cached segment caused by other vehicles and the speed limits */
+	inline int CalcVehicleCost(const CYapfRoadSegment &segment)
+	{
+		int cost = 0;
+		for (uint i = 0; i < segment.m_num_stop_tiles; i++) {
+			const CYapfRoadSegment::StopTile &stop = segment.m_stop_tiles[i];
+			if (IsTileType(stop.tile, MP_STATION)) cost += Yapf().RoadStopOccupancyCost(stop.tile, stop.td);
+		}
+		for (uint i = 0; i < segment.m_num_speed_limits; i++) {
+			cost += segment.m_speed_limits[i].count * Yapf().SpeedLimitCost(segment.m_speed_limits[i].speed);
+		}
+		return cost;
+	}
+
+public:
+	/**
+	 * Called by YAPF to calculate the cost from the origin to the given node.
+	 *  Calculates only the cost of given node, adds it to the parent node cost
+	 *  and stores the result into Node::m_cost member
+	 */
+	inline bool PfCalcCost(Node& n, const TrackFollower *tf)
+	{
+		const RoadVehicle *v = Yapf().GetVehicle();
+		CYapfRoadSegmentKey key(n.m_key.m_tile, n.m_key.m_td, v->compatible_roadtypes, v->owner);
+
+		bool found;
+		CYapfRoadSegment *segment = &GetRoadSegmentCache().Get(key, &found);
+		int vehicle_cost = found ? Yapf().CalcVehicleCost(*segment) : Yapf().CalcSegment(*segment, false);
+
+		/* The destination might lie within the segment, which then has to end there.
+		 * When not all stop tiles are known, the cached segment can't tell. */
+		CYapfRoadSegment local(key);
+		if (segment->m_incomplete || Yapf().PfDetectDestinationSegment(*segment)) {
+			vehicle_cost = Yapf().CalcSegment(local, true);
+			segment = &local;
+		}
+
+		if (segment->m_loop) return false;
+
 		/* save end of segment back to the node */
-		n.m_segment_last_tile = tile;
-		n.m_segment_last_td = trackdir;
+		n.m_segment_last_tile = segment->m_last_tile;
+		n.m_segment_last_td = segment->m_last_td;
 
 		/* save also tile cost */
 		int parent_cost = (n.m_parent != NULL) ? n.m_parent->m_cost : 0;
-		n.m_cost = parent_cost + segment_cost;
+		n.m_cost = parent_cost + segment->m_cost + vehicle_cost;
 		return true;
 	}
 };
@@ -197,6 +297,15 @@ public:
 		return IsRoadDepotTile(tile);
 	}
 
+	/** Called by YAPF to detect if the destination might lie within a segment */
+	inline bool PfDetectDestinationSegment(const CYapfRoadSegment &segment)
+	{
+		for (uint i = 0; i < segment.m_num_stop_tiles; i++) {
+			if (IsRoadDepotTile(segment.m_stop_tiles[i].tile)) return true;
+		}
+		return false;
+	}
+
 	/**
 	 * Called by YAPF to calculate cost estimate. Calculates distance to the destination
 	 *  adds it to the actual cost from origin and stores the sum to the Node::m_estimate
@@ -267,6 +376,17 @@ public:
 		return tile == m_destTile && ((m_destTrackdirs & TrackdirToTrackdirBits(trackdir)) != TRACKDIR_BIT_NONE);
 	}
 
+	/** Called by YAPF to detect if the destination might lie within a segment */
+	inline bool PfDetectDestinationSegment(const CYapfRoadSegment &segment)
+	{
+		if (m_dest_station == INVALID_STATION) return segment.IsInArea(m_destTile);
+
+		for (uint i = 0; i < segment.m_num_stop_tiles; i++) {
+			if (PfDetectDestinationTile(segment.m_stop_tiles[i].tile, segment.m_stop_tiles[i].td)) return true;
+		}
+		return false;
+	}
+
 	/**
 	 * Called by YAPF to calculate cost estimate. Calculates distance to the destination
 	 *  adds it to the actual cost from origin and stores the sum to the Node::m_estimate
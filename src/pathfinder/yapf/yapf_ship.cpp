@@ -14,6 +14,7 @@
 
 #include "yapf.hpp"
 #include "yapf_node_ship.hpp"
+#include "yapf_water_regions.h"
 
 /** Node Follower module of YAPF for ships */
 template <class Types>
@@ -26,6 +27,8 @@ public:
 	typedef typename Node::Key Key;                      ///< key to hash tables
 
 protected:
+	const WaterRegionCorridor *m_corridor; ///< Regions the search is limited to, or NULL.
+
 	/** to access inherited path finder */
 	inline Tpf& Yapf()
 	{
@@ -33,6 +36,8 @@ protected:
 	}
 
 public:
+	CYapfFollowShipT() : m_corridor(NULL) {}
+
 	/**
 	 * Called by YAPF to move from the given node to the next tile. For each
 	 *  reachable trackdir on the new tile creates new node, initializes it
@@ -42,6 +47,8 @@ public:
 	{
 		TrackFollower F(Yapf().GetVehicle());
 		if (F.Follow(old_node.m_key.m_tile, old_node.m_key.m_td)) {
+			/* The first step is fixed, the corridor only starts to matter after it. */
+			if (m_corridor != NULL && old_node.m_parent != NULL && !m_corridor->Contains(F.m_new_tile)) return;
 			Yapf().AddMultipleNodes(&old_node, F);
 		}
 	}
@@ -71,18 +78,50 @@ public:
 		Trackdir trackdir = v->GetVehicleTrackdir();
 		assert(IsValidTrackdir(trackdir));
 
-		/* convert origin trackdir to TrackdirBits */
-		TrackdirBits trackdirs = TrackdirToTrackdirBits(trackdir);
 		/* get available trackdirs on the destination tile */
 		TrackdirBits dest_trackdirs = TrackStatusToTrackdirBits(GetTileTrackStatus(v->dest_tile, TRANSPORT_WATER, 0));
 
+		PathfinderTelemetryTimer telemetry(PFTT_SHIP, v->index);
+		uint nodes = 0;
+
+		/* only look at the water regions on the way to the destination */
+		WaterRegionCorridor corridor;
+		WaterRegionCorridorResult corridor_result = FindWaterRegionCorridor(src_tile, v->dest_tile, &corridor, &nodes);
+
+		/* An unreachable destination still needs a search everywhere to head towards the closest tile. */
+		Trackdir next_trackdir = FindShipPath(v, tile, src_tile, trackdir, dest_trackdirs, corridor_result == WRCR_FOUND ? &corridor : NULL, path_found, &nodes);
+		if (corridor_result == WRCR_FOUND && !path_found && dest_trackdirs != TRACKDIR_BIT_NONE) {
+			/* Coasts can make the corridor impassable, search everywhere. */
+			next_trackdir = FindShipPath(v, tile, src_tile, trackdir, dest_trackdirs, NULL, path_found, &nodes);
+		}
+		if (corridor_result == WRCR_UNREACHABLE) path_found = false;
+		telemetry.SetResult(nodes, path_found);
+		return next_trackdir;
+	}
+
+	/**
+	 * Search the path of a ship and get its first step.
+	 * @param v Ship
+	 * @param tile Tile the ship is about to enter
+	 * @param src_tile Tile the ship is coming from
+	 * @param trackdir Current trackdir of the ship
+	 * @param dest_trackdirs Trackdirs the ship may reach the destination tile with
+	 * @param corridor Regions to limit the search to, or NULL
+	 * @param path_found [out] Was the destination found?
+	 * @param nodes [in,out] Number of nodes expanded by the search is added to this.
+	 * @return Trackdir to take on tile, or INVALID_TRACKDIR
+	 */
+	static Trackdir FindShipPath(const Ship *v, TileIndex tile, TileIndex src_tile, Trackdir trackdir, TrackdirBits dest_trackdirs, const WaterRegionCorridor *corridor, bool &path_found, uint *nodes)
+	{
 		/* create pathfinder instance */
 		Tpf pf;
+		pf.m_corridor = corridor;
 		/* set origin and destination nodes */
-		pf.SetOrigin(src_tile, trackdirs);
+		pf.SetOrigin(src_tile, TrackdirToTrackdirBits(trackdir));
 		pf.SetDestination(v->dest_tile, dest_trackdirs);
 		/* find best path */
 		path_found = pf.FindPath(v);
+		*nodes += pf.m_nodes->ClosedCount();
 
 		Trackdir next_trackdir = INVALID_TRACKDIR; // this would mean "path not found"
 
@@ -116,13 +155,17 @@ public:
 		/* get available trackdirs on the destination tile */
 		TrackdirBits dest_trackdirs = TrackStatusToTrackdirBits(GetTileTrackStatus(v->dest_tile, TRANSPORT_WATER, 0));
 
+		PathfinderTelemetryTimer telemetry(PFTT_SHIP, v->index);
+
 		/* create pathfinder instance */
 		Tpf pf;
 		/* set origin and destination nodes */
 		pf.SetOrigin(tile, TrackdirToTrackdirBits(td1) | TrackdirToTrackdirBits(td2));
 		pf.SetDestination(v->dest_tile, dest_trackdirs);
 		/* find best path */
-		if (!pf.FindPath(v)) return false;
+		bool found = pf.FindPath(v);
+		telemetry.SetResult(pf.m_nodes->ClosedCount(), found);
+		if (!found) return false;
 
 		Node *pNode = pf.GetBestNode();
 		if (pNode == NULL) return false;
@@ -0,0 +1,547 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file yapf_water_regions.cpp Division of the water into regions for hierarchical ship path finding.
+ *
+ * The map is cut into square regions. The water tiles of a region are grouped
+ * into patches, the areas a ship can move in without leaving the region. A
+ * search over these patches gives the regions a ship has to pass, and the
+ * normal ship path finder then only looks at the tiles of those regions.
+ *
+ * Ships are assumed to be able to move between any two edges of a tile with
+ * water tracks, so patches can be larger than what a ship can reach on coasts.
+ * A destination that can't be reached on the patches can't be reached at all.
+ *
+ * Changed tiles only invalidate their region, which is recalculated from the
+ * map when it is needed the next time.
+ */
+
+#include "../../stdafx.h"
+#include "../../ship.h"
+#include "../../tunnelbridge_map.h"
+#include "../../core/sort_func.hpp"
+
+#include "yapf.hpp"
+#include "yapf_cache.h"
+#include "yapf_water_regions.h"
+
+static const uint WATER_REGION_EDGE_BITS = 4;                                                       ///< Log2 of the edge length of a region.
+static const uint WATER_REGION_EDGE_LENGTH = 1 << WATER_REGION_EDGE_BITS;                           ///< Edge length of a region in tiles.
+static const uint WATER_REGION_NUMBER_OF_TILES = WATER_REGION_EDGE_LENGTH * WATER_REGION_EDGE_LENGTH; ///< Number of tiles in a region.
+
+static const byte WRS_AQUEDUCT = 1 << DIAGDIR_END; ///< Flag in WaterRegion::sides for the ends of aqueducts.
+static const uint32 INVALID_WATER_PATCH = UINT32_MAX; ///< Patch ID of tiles ships can't be on.
+
+/** Connectivity of the water in one region. */
+struct WaterRegion {
+	bool valid;                                     ///< Does the region match the map?
+	byte num_patches;                               ///< Number of patches in the region.
+	byte sides[WATER_REGION_NUMBER_OF_TILES];       ///< Edges ships can leave each tile through, plus #WRS_AQUEDUCT.
+	byte patch[WATER_REGION_NUMBER_OF_TILES];       ///< Patch of each tile starting at 1, or 0 if ships can't be on it.
+	SmallVector<byte, 2> aqueducts;                 ///< Region local indices of the aqueduct ends.
+};
+
+static SmallVector<WaterRegion *, 1> _water_regions; ///< All regions of the map, allocated when first needed.
+
+/**
+ * Get the number of regions in a row of the map.
+ * @return Number of regions.
+ */
+static inline uint GetWaterRegionsPerRow()
+{
+	return MapSizeX() >> WATER_REGION_EDGE_BITS;
+}
+
+/**
+ * Get the region a tile is in.
+ * @param tile The tile.
+ * @return Index of the region.
+ */
+static inline uint GetWaterRegionIndex(TileIndex tile)
+{
+	return (TileY(tile) >> WATER_REGION_EDGE_BITS) * GetWaterRegionsPerRow() + (TileX(tile) >> WATER_REGION_EDGE_BITS);
+}
+
+/**
+ * Get the index of a tile inside its region.
+ * @param tile The tile.
+ * @return Region local index.
+ */
+static inline uint GetWaterRegionLocalIndex(TileIndex tile)
+{
+	return (TileY(tile) & (WATER_REGION_EDGE_LENGTH - 1)) * WATER_REGION_EDGE_LENGTH + (TileX(tile) & (WATER_REGION_EDGE_LENGTH - 1));
+}
+
+/**
+ * Get the north tile of a region.
+ * @param index Index of the region.
+ * @return The tile.
+ */
+static inline TileIndex GetWaterRegionNorthTile(uint index)
+{
+	return TileXY((index % GetWaterRegionsPerRow()) << WATER_REGION_EDGE_BITS, (index / GetWaterRegionsPerRow()) << WATER_REGION_EDGE_BITS);
+}
+
+/**
+ * Get the distance between two regions in path cost units.
+ * @param index1 First region.
+ * @param index2 Second region.
+ * @return The Manhattan distance between the regions, scaled to tile lengths.
+ */
+static inline int GetWaterRegionDistance(uint index1, uint index2)
+{
+	uint regions_x = GetWaterRegionsPerRow();
+	int dx = Delta(index1 % regions_x, index2 % regions_x);
+	int dy = Delta(index1 / regions_x, index2 / regions_x);
+	return (dx + dy) * WATER_REGION_EDGE_LENGTH * YAPF_TILE_LENGTH;
+}
+
+/**
+ * Get the edges of a tile ships can leave it through.
+ * @param tile The tile.
+ * @return Edge bits plus #WRS_AQUEDUCT for the ends of aqueducts.
+ */
+static byte GetWaterSides(TileIndex tile)
+{
+	if (IsTileType(tile, MP_TUNNELBRIDGE)) {
+		if (GetTunnelBridgeTransportType(tile) != TRANSPORT_WATER) return 0;
+		return WRS_AQUEDUCT | (1 << ReverseDiagDir(GetTunnelBridgeDirection(tile)));
+	}
+
+	TrackBits tracks = TrackStatusToTrackBits(GetTileTrackStatus(tile, TRANSPORT_WATER, 0));
+	byte sides = 0;
+	for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
+		if ((tracks & DiagdirReachesTracks(ReverseDiagDir(dir))) != TRACK_BIT_NONE) SetBit(sides, dir);
+	}
+	return sides;
+}
+
+/**
+ * Calculate the patches of a region from the map.
+ * @param region The region to fill.
+ * @param index Index of the region.
+ */
+static void BuildWaterRegion(WaterRegion *region, uint index)
+{
+	TileIndex north = GetWaterRegionNorthTile(index);
+
+	region->aqueducts.Clear();
+	for (uint i = 0; i < WATER_REGION_NUMBER_OF_TILES; i++) {
+		region->sides[i] = GetWaterSides(north + TileDiffXY(i % WATER_REGION_EDGE_LENGTH, i / WATER_REGION_EDGE_LENGTH));
+		region->patch[i] = 0;
+		if ((region->sides[i] & WRS_AQUEDUCT) != 0) *region->aqueducts.Append() = i;
+	}
+
+	/* Flood fill the patches. */
+	region->num_patches = 0;
+	byte stack[WATER_REGION_NUMBER_OF_TILES];
+	for (uint start = 0; start < WATER_REGION_NUMBER_OF_TILES; start++) {
+		if (region->sides[start] == 0 || region->patch[start] != 0) continue;
+
+		/* Pathological coasts could have more patches than fit; merging them is still safe. */
+		if (region->num_patches < UINT8_MAX) region->num_patches++;
+		region->patch[start] = region->num_patches;
+
+		uint stack_size = 0;
+		stack[stack_size++] = start;
+		while (stack_size > 0) {
+			uint i = stack[--stack_size];
+			for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
+				if (!HasBit(region->sides[i], dir)) continue;
+
+				TileIndexDiffC diff = TileIndexDiffCByDiagDir(dir);
+				uint x = i % WATER_REGION_EDGE_LENGTH + diff.x;
+				uint y = i / WATER_REGION_EDGE_LENGTH + diff.y;
+				if (x >= WATER_REGION_EDGE_LENGTH || y >= WATER_REGION_EDGE_LENGTH) continue;
+
+				uint neighbour = y * WATER_REGION_EDGE_LENGTH + x;
+				if (region->patch[neighbour] != 0 || !HasBit(region->sides[neighbour], ReverseDiagDir(dir))) continue;
+
+				region->patch[neighbour] = region->num_patches;
+				stack[stack_size++] = neighbour;
+			}
+		}
+	}
+
+	region->valid = true;
+}
+
+/** Make sure there is a region entry for each part of the current map. */
+static void UpdateWaterRegionCount()
+{
+	uint count = MapSize() >> (2 * WATER_REGION_EDGE_BITS);
+	if (_water_regions.Length() == count) return;
+
+	for (WaterRegion **region = _water_regions.Begin(); region != _water_regions.End(); region++) delete *region;
+	_water_regions.Clear();
+	MemSetT(_water_regions.Append(count), 0, count);
+}
+
+/**
+ * Get a region that matches the map.
+ * @param index Index of the region.
+ * @return The region.
+ */
+static const WaterRegion *GetWaterRegion(uint index)
+{
+	WaterRegion *&region = _water_regions[index];
+	if (region == NULL) region = new WaterRegion();
+	if (!region->valid) BuildWaterRegion(region, index);
+	return region;
+}
+
+/**
+ * Get the patch a tile belongs to.
+ * @param tile The tile.
+ * @return Region index shifted left by 8 bits plus the patch, or #INVALID_WATER_PATCH.
+ */
+static uint32 GetWaterPatchID(TileIndex tile)
+{
+	uint index = GetWaterRegionIndex(tile);
+	byte patch = GetWaterRegion(index)->patch[GetWaterRegionLocalIndex(tile)];
+	return patch == 0 ? INVALID_WATER_PATCH : (index << 8) | patch;
+}
+
+void YapfNotifyWaterLayoutChange(TileIndex tile)
+{
+	if (tile == INVALID_TILE || _water_regions.Length() != MapSize() >> (2 * WATER_REGION_EDGE_BITS)) {
+		for (WaterRegion **region = _water_regions.Begin(); region != _water_regions.End(); region++) {
+			if (*region != NULL) (*region)->valid = false;
+		}
+		return;
+	}
+
+	/* Connections to other regions are looked up when searching, so only the own region changes. */
+	WaterRegion *region = _water_regions[GetWaterRegionIndex(tile)];
+	if (region != NULL) region->valid = false;
+}
+
+bool WaterRegionCorridor::Contains(TileIndex tile) const
+{
+	uint index = GetWaterRegionIndex(tile);
+	uint low = 0;
+	uint high = this->regions.Length();
+	while (low < high) {
+		uint mid = (low + high) / 2;
+		if (this->regions[mid] == index) return true;
+		if (this->regions[mid] < index) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return false;
+}
+
+
+/** YAPF node key for water region patches. */
+struct CYapfWaterRegionNodeKey {
+	uint32 m_patch_id; ///< Region index shifted left by 8 bits plus the patch in the region.
+
+	inline void Set(uint32 patch_id)
+	{
+		m_patch_id = patch_id;
+	}
+
+	inline int CalcHash() const
+	{
+		return m_patch_id;
+	}
+
+	inline bool operator == (const CYapfWaterRegionNodeKey &other) const
+	{
+		return m_patch_id == other.m_patch_id;
+	}
+
+	void Dump(DumpTarget &dmp) const
+	{
+		dmp.WriteLine("m_patch_id = %u", m_patch_id);
+	}
+};
+
+/** YAPF node for water region patches. */
+struct CYapfWaterRegionNode : public CYapfNodeT<CYapfWaterRegionNodeKey, CYapfWaterRegionNode> {
+	typedef CYapfNodeT<CYapfWaterRegionNodeKey, CYapfWaterRegionNode> Base;
+
+	inline void Set(CYapfWaterRegionNode *parent, uint32 patch_id)
+	{
+		Base::Set(parent, false);
+		this->m_key.Set(patch_id);
+	}
+
+	inline uint32 GetPatchID() const { return this->m_key.m_patch_id; }
+	inline uint GetRegionIndex() const { return this->m_key.m_patch_id >> 8; }
+};
+
+typedef CNodeList_HashTableT<CYapfWaterRegionNode, 10, 12, 4096> CWaterRegionNodeList;
+
+/** Finds the patches next to a patch. */
+struct CFollowWaterRegion {
+	SmallVector<uint32, 16> m_new_patches; ///< The patches reachable from the followed one.
+
+	/**
+	 * Add the patch of a tile if ships can enter the tile.
+	 * @param tile The tile.
+	 * @param side Edge of the tile it is entered through, or INVALID_DIAGDIR for aqueducts.
+	 */
+	inline void AddPatch(TileIndex tile, DiagDirection side)
+	{
+		uint index = GetWaterRegionIndex(tile);
+		const WaterRegion *region = GetWaterRegion(index);
+		uint i = GetWaterRegionLocalIndex(tile);
+		if (region->patch[i] == 0) return;
+		if (side != INVALID_DIAGDIR && !HasBit(region->sides[i], side)) return;
+		this->m_new_patches.Include((index << 8) | region->patch[i]);
+	}
+
+	/**
+	 * Find the patches next to a patch.
+	 * @param patch_id The patch to follow.
+	 * @return True if there are any.
+	 */
+	inline bool Follow(uint32 patch_id)
+	{
+		this->m_new_patches.Clear();
+
+		uint index = patch_id >> 8;
+		byte patch = GB(patch_id, 0, 8);
+		const WaterRegion *region = GetWaterRegion(index);
+		TileIndex north = GetWaterRegionNorthTile(index);
+
+		for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
+			TileIndexDiffC diff = TileIndexDiffCByDiagDir(dir);
+			for (uint n = 0; n < WATER_REGION_EDGE_LENGTH; n++) {
+				/* Walk along the border of the region in direction dir. */
+				uint x = diff.x == 0 ? n : (diff.x < 0 ? 0 : WATER_REGION_EDGE_LENGTH - 1);
+				uint y = diff.y == 0 ? n : (diff.y < 0 ? 0 : WATER_REGION_EDGE_LENGTH - 1);
+				uint i = y * WATER_REGION_EDGE_LENGTH + x;
+				if (region->patch[i] != patch || !HasBit(region->sides[i], dir)) continue;
+
+				uint nx = TileX(north) + x + diff.x;
+				uint ny = TileY(north) + y + diff.y;
+				if (nx >= MapSizeX() || ny >= MapSizeY()) continue;
+				this->AddPatch(TileXY(nx, ny), ReverseDiagDir(dir));
+			}
+		}
+
+		for (const byte *i = region->aqueducts.Begin(); i != region->aqueducts.End(); i++) {
+			if (region->patch[*i] != patch) continue;
+			TileIndex tile = north + TileDiffXY(*i % WATER_REGION_EDGE_LENGTH, *i / WATER_REGION_EDGE_LENGTH);
+			this->AddPatch(GetOtherTunnelBridgeEnd(tile), INVALID_DIAGDIR);
+		}
+
+		return this->m_new_patches.Length() > 0;
+	}
+};
+
+/** YAPF cost provider for water region patches. */
+template <class Types>
+class CYapfCostWaterRegionT {
+public:
+	typedef typename Types::Tpf Tpf;              ///< the pathfinder class (derived from THIS class)
+	typedef typename Types::TrackFollower TrackFollower;
+	typedef typename Types::NodeList::Titem Node; ///< this will be our node type
+
+	/** Called by YAPF to calculate the cost from the origin to the given node. */
+	inline bool PfCalcCost(Node &n, const TrackFollower *tf)
+	{
+		n.m_cost = n.m_parent->m_cost + GetWaterRegionDistance(n.m_parent->GetRegionIndex(), n.GetRegionIndex());
+		return true;
+	}
+};
+
+/** YAPF origin provider for water region patches. */
+template <class Types>
+class CYapfOriginWaterRegionT {
+public:
+	typedef typename Types::Tpf Tpf;              ///< the pathfinder class (derived from THIS class)
+	typedef typename Types::NodeList::Titem Node; ///< this will be our node type
+
+protected:
+	uint32 m_origin; ///< Patch the search starts at.
+
+	/** to access inherited path finder */
+	inline Tpf& Yapf()
+	{
+		return *static_cast<Tpf*>(this);
+	}
+
+public:
+	/** Set the origin patch. */
+	void SetOrigin(uint32 patch_id)
+	{
+		m_origin = patch_id;
+	}
+
+	/** Called when YAPF needs to place origin nodes into the open list. */
+	void PfSetStartupNodes()
+	{
+		Node &n = Yapf().CreateNewNode();
+		n.Set(NULL, m_origin);
+		Yapf().AddStartupNode(n);
+	}
+};
+
+/** YAPF destination provider for water region patches. */
+template <class Types>
+class CYapfDestinationWaterRegionT {
+public:
+	typedef typename Types::Tpf Tpf;              ///< the pathfinder class (derived from THIS class)
+	typedef typename Types::NodeList::Titem Node; ///< this will be our node type
+
+protected:
+	SmallVector<uint32, 8> m_dest; ///< Patches of the destination.
+
+public:
+	/**
+	 * Accept the patch of a tile as destination.
+	 * @param tile The tile.
+	 */
+	void AddDestination(TileIndex tile)
+	{
+		uint32 patch_id = GetWaterPatchID(tile);
+		if (patch_id != INVALID_WATER_PATCH) m_dest.Include(patch_id);
+	}
+
+	/** Is there any destination patch? */
+	inline bool HasDestination() const
+	{
+		return m_dest.Length() > 0;
+	}
+
+	/** Is a patch one of the destination patches? */
+	inline bool IsDestination(uint32 patch_id) const
+	{
+		return m_dest.Contains(patch_id);
+	}
+
+	/** Called by YAPF to detect if the node reaches the destination. */
+	inline bool PfDetectDestination(Node &n)
+	{
+		return this->IsDestination(n.GetPatchID());
+	}
+
+	/** Called by YAPF to calculate the estimated cost to the destination. */
+	inline bool PfCalcEstimate(Node &n)
+	{
+		int d = INT_MAX;
+		for (const uint32 *dest = m_dest.Begin(); dest != m_dest.End(); dest++) {
+			d = min(d, GetWaterRegionDistance(n.GetRegionIndex(), *dest >> 8));
+		}
+		n.m_estimate = n.m_cost + d;
+		assert(n.m_estimate >= n.m_parent->m_estimate);
+		return true;
+	}
+};
+
+/** Node follower of YAPF for water region patches. */
+template <class Types>
+class CYapfFollowWaterRegionT {
+public:
+	typedef typename Types::Tpf Tpf;                     ///< the pathfinder class (derived from THIS class)
+	typedef typename Types::TrackFollower TrackFollower;
+	typedef typename Types::NodeList::Titem Node;        ///< this will be our node type
+
+protected:
+	/** to access inherited path finder */
+	inline Tpf& Yapf()
+	{
+		return *static_cast<Tpf*>(this);
+	}
+
+public:
+	/** Called by YAPF to move from the given node to the next patches. */
+	inline void PfFollowNode(Node &old_node)
+	{
+		TrackFollower F;
+		if (!F.Follow(old_node.GetPatchID())) return;
+
+		for (const uint32 *patch_id = F.m_new_patches.Begin(); patch_id != F.m_new_patches.End(); patch_id++) {
+			Node &n = Yapf().CreateNewNode();
+			n.Set(&old_node, *patch_id);
+			Yapf().AddNewNode(n, F);
+		}
+	}
+
+	/** return debug report character to identify the transportation type */
+	inline char TransportTypeChar() const
+	{
+		return 'W';
+	}
+};
+
+/** Config struct of YAPF for water region patches. */
+template <class Tpf_>
+struct CYapfWaterRegion_TypesT {
+	typedef CYapfWaterRegion_TypesT<Tpf_> Types;
+
+	typedef Tpf_                 Tpf;           ///< Pathfinder type
+	typedef CFollowWaterRegion   TrackFollower; ///< Node follower
+	typedef CWaterRegionNodeList NodeList;      ///< Node list type
+	typedef Ship                 VehicleType;   ///< Dummy type
+
+	typedef CYapfBaseT<Types>                   PfBase;        ///< Base pathfinder class
+	typedef CYapfFollowWaterRegionT<Types>      PfFollow;      ///< Node follower
+	typedef CYapfOriginWaterRegionT<Types>      PfOrigin;      ///< Origin provider
+	typedef CYapfDestinationWaterRegionT<Types> PfDestination; ///< Destination/distance provider
+	typedef CYapfSegmentCostCacheNoneT<Types>   PfCache;       ///< Cost cache provider
+	typedef CYapfCostWaterRegionT<Types>        PfCost;        ///< Cost provider
+};
+
+struct CYapfWaterRegion : CYapfT<CYapfWaterRegion_TypesT<CYapfWaterRegion> > {};
+
+/** Sort region indices ascending. */
+static int CDECL WaterRegionIndexSorter(const uint *a, const uint *b)
+{
+	return (int)(*a > *b) - (int)(*a < *b);
+}
+
+/**
+ * Find the regions a ship has to pass to get to its destination.
+ * @param origin Tile the ship is on.
+ * @param dest Destination tile of the ship; ships stop next to docks, so the tiles around it count as well.
+ * @param corridor [out] The regions the ship path search should be limited to.
+ * @param nodes [in,out] Number of nodes expanded by the search is added to this.
+ * @return Whether a corridor was found; the corridor is empty unless it was.
+ */
+WaterRegionCorridorResult FindWaterRegionCorridor(TileIndex origin, TileIndex dest, WaterRegionCorridor *corridor, uint *nodes)
+{
+	UpdateWaterRegionCount();
+	corridor->regions.Clear();
+
+	uint32 origin_patch = GetWaterPatchID(origin);
+	if (origin_patch == INVALID_WATER_PATCH) return WRCR_NONE;
+
+	CYapfWaterRegion pf;
+	pf.SetOrigin(origin_patch);
+	pf.AddDestination(dest);
+	for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
+		TileIndex tile = AddTileIndexDiffCWrap(dest, TileIndexDiffCByDiagDir(dir));
+		if (tile != INVALID_TILE) pf.AddDestination(tile);
+	}
+	if (!pf.HasDestination()) return WRCR_NONE;
+
+	if (pf.IsDestination(origin_patch)) {
+		*corridor->regions.Append() = origin_patch >> 8;
+		return WRCR_FOUND;
+	}
+
+	bool found = pf.FindPath(NULL);
+	*nodes += pf.m_nodes->ClosedCount();
+	if (!found) {
+		/* Gave up before everything reachable was seen? */
+		return pf.m_nodes->OpenCount() > 0 ? WRCR_NONE : WRCR_UNREACHABLE;
+	}
+
+	for (CYapfWaterRegionNode *n = pf.GetBestNode(); n != NULL; n = n->m_parent) {
+		corridor->regions.Include(n->GetRegionIndex());
+	}
+	QSortT(corridor->regions.Begin(), corridor->regions.Length(), &WaterRegionIndexSorter);
+	return WRCR_FOUND;
+}
@@ -0,0 +1,34 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file yapf_water_regions.h Division of the water into regions for hierarchical ship path finding. */
+
+#ifndef YAPF_WATER_REGIONS_H
+#define YAPF_WATER_REGIONS_H
+
+#include "../../tile_type.h"
+#include "../../core/smallvec_type.hpp"
+
+/** Outcome of the search for a corridor of water regions. */
+enum WaterRegionCorridorResult {
+	WRCR_NONE,        ///< There is no corridor, the whole map has to be searched.
+	WRCR_FOUND,       ///< The destination can be reached through the corridor.
+	WRCR_UNREACHABLE, ///< The destination can't be reached at all, the whole map has to be searched for the closest tile.
+};
+
+/** Water regions a ship path search is limited to. */
+struct WaterRegionCorridor {
+	SmallVector<uint, 32> regions; ///< Sorted indices of the regions in the corridor.
+
+	bool Contains(TileIndex tile) const;
+};
+
+WaterRegionCorridorResult FindWaterRegionCorridor(TileIndex origin, TileIndex dest, WaterRegionCorridor *corridor, uint *nodes);
+
+#endif /* YAPF_WATER_REGIONS_H */
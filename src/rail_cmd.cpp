@@ -697,6 +697,7 @@ CommandCost CmdRemoveSingleRail(TileIndex tile, DoCommandFlag flags, uint32 p1,
 					/* If there is flat water on the lower halftile, convert the tile to shore so the water remains */
 					if (GetRailGroundType(tile) == RAIL_GROUND_WATER && IsSlopeWithOneCornerRaised(tileh)) {
 						MakeShore(tile);
+						YapfNotifyWaterLayoutChange(tile);
 					} else {
 						DoClearSquare(tile);
 					}
@@ -768,6 +769,7 @@ bool FloodHalftile(TileIndex t)
 			rail_bits = rail_bits & ~to_remove;
 			if (rail_bits == 0) {
 				MakeShore(t);
+				YapfNotifyWaterLayoutChange(t);
 				MarkTileDirtyByTile(t);
 				return flooded;
 			}
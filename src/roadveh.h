@@ -81,6 +81,7 @@ static const byte RV_OVERTAKE_TIMEOUT = 35;
 
 void RoadVehUpdateCache(RoadVehicle *v, bool same_length = false);
 void GetRoadVehSpriteSize(EngineID engine, uint &width, uint &height, int &xoffs, int &yoffs, EngineImageType image_type);
+RoadVehicle *GetFirstRoadVehicleOnTile(TileIndex tile);
 
 /**
  * Buses, trucks and trams belong to this class.
@@ -103,6 +104,10 @@ struct RoadVehicle FINAL : public GroundVehicle<RoadVehicle, VEH_ROAD> {
 	uint16 limit_speed;      ///< Limitation of speed
 	uint16 limit_speed_pass; ///< Hack solution, sorry.
 
+	RoadVehicle *hash_tile_road_next;     ///< NOSAVE: Next road vehicle in the road vehicle tile hash.
+	RoadVehicle **hash_tile_road_prev;    ///< NOSAVE: Previous road vehicle in the road vehicle tile hash.
+	RoadVehicle **hash_tile_road_current; ///< NOSAVE: Cache of the current hash chain.
+
 	/** We don't want GCC to zero our struct! It already is zeroed and has an index! */
 	RoadVehicle() : GroundVehicleBase() {}
 	/** We want to 'destruct' the right class. */
@@ -129,6 +134,17 @@ struct RoadVehicle FINAL : public GroundVehicle<RoadVehicle, VEH_ROAD> {
 
 	bool IsBus() const;
 
+	/**
+	 * Get the next road vehicle on the tile of this road vehicle.
+	 * @return The next road vehicle, or \c NULL if there is none.
+	 */
+	inline RoadVehicle *GetNextOnTile() const
+	{
+		RoadVehicle *v = this->hash_tile_road_next;
+		while (v != NULL && v->tile != this->tile) v = v->hash_tile_road_next;
+		return v;
+	}
+
 	int GetCurrentMaxSpeed() const;
 	int UpdateSpeed();
 
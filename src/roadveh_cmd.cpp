@@ -14,6 +14,7 @@
 #include "command_func.h"
 #include "news_func.h"
 #include "pathfinder/npf/npf_func.h"
+#include "pathfinder/pf_query_log.h"
 #include "station_base.h"
 #include "company_func.h"
 #include "articulated_vehicles.h"
@@ -337,12 +338,16 @@ static FindDepotData FindClosestRoadDepot(const RoadVehicle *v, int max_distance
 {
 	if (IsRoadDepotTile(v->tile)) return FindDepotData(v->tile, 0);
 
+	PathfinderQuery query(PFQ_ROAD_DEPOT, v, v->tile, v->state);
+	FindDepotData fdd;
 	switch (_settings_game.pf.pathfinder_for_roadvehs) {
-		case VPF_NPF: return NPFRoadVehicleFindNearestDepot(v, max_distance);
-		case VPF_YAPF: return YapfRoadVehicleFindNearestDepot(v, max_distance);
+		case VPF_NPF: fdd = NPFRoadVehicleFindNearestDepot(v, max_distance); break;
+		case VPF_YAPF: fdd = YapfRoadVehicleFindNearestDepot(v, max_distance); break;
 
 		default: NOT_REACHED();
 	}
+	query.Finish(fdd.tile, fdd.tile != INVALID_TILE);
+	return fdd;
 }
 
 bool RoadVehicle::FindClosestDepot(TileIndex *location, DestinationID *destination, bool *reverse)
@@ -615,20 +620,24 @@ struct RoadVehFindData {
 	Direction dir;
 };
 
-static Vehicle *EnumCheckRoadVehClose(Vehicle *v, void *data)
+/**
+ * Check whether a road vehicle is close in front of the searching one.
+ * @param v The road vehicle to check.
+ * @param rvf The search.
+ */
+static void CheckRoadVehClose(RoadVehicle *v, RoadVehFindData *rvf)
 {
 	static const int8 dist_x[] = { -4, -8, -4, -1, 4, 8, 4, 1 };
 	static const int8 dist_y[] = { -4, -1, 4, 8, 4, 1, -4, -8 };
 
-	RoadVehFindData *rvf = (RoadVehFindData*)data;
+	/* Only vehicles in the same lane can block. */
+	if (v->direction != rvf->dir) return;
 
 	short x_diff = v->x_pos - rvf->x;
 	short y_diff = v->y_pos - rvf->y;
 
-	if (v->type == VEH_ROAD &&
-			!v->IsInDepot() &&
+	if (!v->IsInDepot() &&
 			abs(v->z_pos - rvf->veh->z_pos) < 6 &&
-			v->direction == rvf->dir &&
 			rvf->veh->First() != v->First() &&
 			(dist_x[v->direction] >= 0 || (x_diff > dist_x[v->direction] && x_diff <= 0)) &&
 			(dist_x[v->direction] <= 0 || (x_diff < dist_x[v->direction] && x_diff >= 0)) &&
@@ -641,8 +650,18 @@ static Vehicle *EnumCheckRoadVehClose(Vehicle *v, void *data)
 			rvf->best_diff = diff;
 		}
 	}
+}
 
-	return NULL;
+/**
+ * Check all road vehicles on a tile for being close in front of the searching one.
+ * @param tile The tile.
+ * @param rvf The search.
+ */
+static void CheckRoadVehCloseOnTile(TileIndex tile, RoadVehFindData *rvf)
+{
+	for (RoadVehicle *v = GetFirstRoadVehicleOnTile(tile); v != NULL; v = v->GetNextOnTile()) {
+		CheckRoadVehClose(v, rvf);
+	}
 }
 
 static RoadVehicle *RoadVehFindCloseTo(RoadVehicle *v, int x, int y, Direction dir, bool update_blocked_ctr = true)
@@ -659,10 +678,20 @@ static RoadVehicle *RoadVehFindCloseTo(RoadVehicle *v, int x, int y, Direction d
 	rvf.best_diff = UINT_MAX;
 
 	if (front->state == RVSB_WORMHOLE) {
-		FindVehicleOnPos(v->tile, &rvf, EnumCheckRoadVehClose);
-		FindVehicleOnPos(GetOtherTunnelBridgeEnd(v->tile), &rvf, EnumCheckRoadVehClose);
+		CheckRoadVehCloseOnTile(v->tile, &rvf);
+		CheckRoadVehCloseOnTile(GetOtherTunnelBridgeEnd(v->tile), &rvf);
 	} else {
-		FindVehicleOnPosXY(x, y, &rvf, EnumCheckRoadVehClose);
+		/* Check the tiles within COLL_DIST pixels of the position, like FindVehicleOnPosXY does. */
+		const int COLL_DIST = 6;
+		uint xl = max(x - COLL_DIST, 0) / TILE_SIZE;
+		uint xu = min<uint>((x + COLL_DIST) / TILE_SIZE, MapMaxX());
+		uint yl = max(y - COLL_DIST, 0) / TILE_SIZE;
+		uint yu = min<uint>((y + COLL_DIST) / TILE_SIZE, MapMaxY());
+		for (uint ty = yl; ty <= yu; ty++) {
+			for (uint tx = xl; tx <= xu; tx++) {
+				CheckRoadVehCloseOnTile(TileXY(tx, ty), &rvf);
+			}
+		}
 	}
 
 	/* This code protects a roadvehicle from being blocked for ever
@@ -769,13 +798,6 @@ struct OvertakeData {
 	Trackdir trackdir;
 };
 
-static Vehicle *EnumFindVehBlockingOvertake(Vehicle *v, void *data)
-{
-	const OvertakeData *od = (OvertakeData*)data;
-
-	return (v->type == VEH_ROAD && v->First() == v && v != od->u && v != od->v) ? v : NULL;
-}
-
 /**
  * Check if overtaking is possible on a piece of track
  *
@@ -793,7 +815,10 @@ static bool CheckRoadBlockedForOvertaking(OvertakeData *od)
 	if (!HasBit(trackdirbits, od->trackdir) || (trackbits & ~TRACK_BIT_CROSS) || (red_signals != TRACKDIR_BIT_NONE)) return true;
 
 	/* Are there more vehicles on the tile except the two vehicles involved in overtaking */
-	return HasVehicleOnPos(od->tile, od, EnumFindVehBlockingOvertake);
+	for (const RoadVehicle *v = GetFirstRoadVehicleOnTile(od->tile); v != NULL; v = v->GetNextOnTile()) {
+		if (v->First() == v && v != od->u && v != od->v) return true;
+	}
+	return false;
 }
 
 static void RoadVehCheckOvertake(RoadVehicle *v, RoadVehicle *u)
@@ -954,11 +979,15 @@ static Trackdir RoadFindPathToDest(RoadVehicle *v, TileIndex tile, DiagDirection
 		return_track(FindFirstBit2x64(trackdirs));
 	}
 
-	switch (_settings_game.pf.pathfinder_for_roadvehs) {
-		case VPF_NPF:  best_track = NPFRoadVehicleChooseTrack(v, tile, enterdir, trackdirs, path_found); break;
-		case VPF_YAPF: best_track = YapfRoadVehicleChooseTrack(v, tile, enterdir, trackdirs, path_found); break;
+	{
+		PathfinderQuery query(PFQ_ROAD_TRACK, v, tile, enterdir);
+		switch (_settings_game.pf.pathfinder_for_roadvehs) {
+			case VPF_NPF:  best_track = NPFRoadVehicleChooseTrack(v, tile, enterdir, trackdirs, path_found); break;
+			case VPF_YAPF: best_track = YapfRoadVehicleChooseTrack(v, tile, enterdir, trackdirs, path_found); break;
 
-		default: NOT_REACHED();
+			default: NOT_REACHED();
+		}
+		query.Finish(best_track, path_found);
 	}
 	v->HandlePathfindingResult(path_found);
 
@@ -258,6 +258,7 @@ static void InitializeWindowsAndCaches()
 	Station::RecomputeIndustriesNearForAll();
 	RebuildSubsidisedSourceAndDestinationCache();
 	RebuildCargoLinkCounts();
+	RebuildNearbyIndex();
 
 	/* Towns have a noise controlled number of airports system
 	 * So each airport's noise value must be added to the town->noise_reached value
@@ -1250,6 +1251,8 @@ bool AfterLoadGame()
 	}
 
 	YapfNotifyTrackLayoutChange(INVALID_TILE, INVALID_TRACK);
+	YapfNotifyWaterLayoutChange(INVALID_TILE);
+	InvalidateTrafficLightConsists();
 
 	if (IsSavegameVersionBefore(34)) {
 		Company *c;
@@ -77,6 +77,7 @@ void CargoSourceSink::LoadCargoSourceSink()
 	for (uint cid = 0; cid < lengthof(this->cargo_links); cid++) {
 		/* Remove links created by constructors. */
 		this->cargo_links[cid].Clear();
+		this->InvalidateLinkWeightIndex(cid);
 		/* Read vector length and allocate storage. */
 		SlObject(NULL, _cargolink_uint_desc);
 		this->cargo_links[cid].Append(_cargolink_uint);
@@ -228,6 +228,7 @@ static uint16 _cargo_source;
 static uint32 _cargo_source_xy;
 static uint8  _cargo_days;
 static Money  _cargo_feeder_share;
+static std::list<CargoPacket *> _packets; ///< Cargo packets of a goods entry while saving or loading it.
 
 static const SaveLoad _station_speclist_desc[] = {
 	SLE_CONDVAR(StationSpecList, grfid,    SLE_UINT32, 27, SL_MAX_VERSION),
@@ -259,7 +260,7 @@ const SaveLoad *GetGoodsDesc()
 		SLEG_CONDVAR(            _cargo_feeder_share, SLE_INT64,                  65, 67),
 		 SLE_CONDVAR(GoodsEntry, amount_fract,        SLE_UINT8,                 150, SL_MAX_VERSION),
 		 SLE_CONDVAR(GoodsEntry, cargo_counter,       SLE_UINT16,                181, SL_MAX_VERSION),
-		 SLE_CONDLST(GoodsEntry, cargo.packets,       REF_CARGO_PACKET,           68, SL_MAX_VERSION),
+		SLEG_CONDLST(            _packets,            REF_CARGO_PACKET,           68, SL_MAX_VERSION),
 		 SLE_CONDVAR(GoodsEntry, cargo.next_start,    SLE_UINT32,                181, SL_MAX_VERSION),
 		 SLE_CONDLST(GoodsEntry, routes,              REF_ROUTE_LINK,            181, SL_MAX_VERSION),
 
@@ -269,6 +270,54 @@ const SaveLoad *GetGoodsDesc()
 	return goods_desc;
 }
 
+/**
+ * Save a goods entry. The packets are saved as one list in the order they
+ * arrived at the station.
+ * @param ge Goods entry to save.
+ */
+static void SaveGoods(GoodsEntry *ge)
+{
+	const StationCargoList::List *packets = ge->cargo.Packets();
+	for (StationCargoList::ConstIterator it = packets->begin(); it != packets->end(); ++it) {
+		_packets.push_back(*it);
+	}
+	SlObject(ge, GetGoodsDesc());
+	_packets.clear();
+}
+
+/**
+ * Load a goods entry. The loaded packets are only references yet, so they
+ * are stored without indexing them until #PtrsGoods resolves them.
+ * @param ge Goods entry to load.
+ */
+static void LoadGoods(GoodsEntry *ge)
+{
+	SlObject(ge, GetGoodsDesc());
+	if (IsSavegameVersionBefore(68)) return;
+
+	StationCargoPacketMap &packets = const_cast<StationCargoPacketMap &>(*ge->cargo.Packets());
+	packets.StoreUnresolved(_packets);
+	_packets.clear();
+}
+
+/**
+ * Resolve the references of a goods entry and index the loaded packets
+ * by their next hop.
+ * @param ge Goods entry to resolve.
+ */
+static void PtrsGoods(GoodsEntry *ge)
+{
+	StationCargoPacketMap &packets = const_cast<StationCargoPacketMap &>(*ge->cargo.Packets());
+	packets.TakeUnresolved(&_packets);
+
+	SlObject(ge, GetGoodsDesc());
+
+	for (std::list<CargoPacket *>::const_iterator it = _packets.begin(); it != _packets.end(); ++it) {
+		packets.push_back(*it);
+	}
+	_packets.clear();
+}
+
 
 static void Load_STNS()
 {
@@ -283,7 +332,7 @@ static void Load_STNS()
 		uint num_cargo = IsSavegameVersionBefore(55) ? 12 : NUM_CARGO;
 		for (CargoID i = 0; i < num_cargo; i++) {
 			GoodsEntry *ge = &st->goods[i];
-			SlObject(ge, GetGoodsDesc());
+			LoadGoods(ge);
 			if (IsSavegameVersionBefore(68)) {
 				SB(ge->acceptance_pickup, GoodsEntry::GES_ACCEPTANCE, 1, HasBit(_waiting_acceptance, 15));
 				if (GB(_waiting_acceptance, 0, 12) != 0) {
@@ -320,8 +369,7 @@ static void Ptrs_STNS()
 	FOR_ALL_STATIONS(st) {
 		if (!IsSavegameVersionBefore(68)) {
 			for (CargoID i = 0; i < NUM_CARGO; i++) {
-				GoodsEntry *ge = &st->goods[i];
-				SlObject(ge, GetGoodsDesc());
+				PtrsGoods(&st->goods[i]);
 			}
 		}
 		SlObject(st, _old_station_desc);
@@ -414,7 +462,7 @@ static void RealSave_STNN(BaseStation *bst)
 	if (!waypoint) {
 		Station *st = Station::From(bst);
 		for (CargoID i = 0; i < NUM_CARGO; i++) {
-			SlObject(&st->goods[i], GetGoodsDesc());
+			SaveGoods(&st->goods[i]);
 		}
 	}
 
@@ -455,7 +503,7 @@ static void Load_STNN()
 			}
 
 			for (CargoID i = 0; i < NUM_CARGO; i++) {
-				SlObject(&st->goods[i], GetGoodsDesc());
+				LoadGoods(&st->goods[i]);
 			}
 		}
 
@@ -477,8 +525,7 @@ static void Ptrs_STNN()
 	Station *st;
 	FOR_ALL_STATIONS(st) {
 		for (CargoID i = 0; i < NUM_CARGO; i++) {
-			GoodsEntry *ge = &st->goods[i];
-			SlObject(ge, GetGoodsDesc());
+			PtrsGoods(&st->goods[i]);
 		}
 		SlObject(st, _station_desc);
 	}
@@ -1356,6 +1356,7 @@ bool CargodestModeChanged(int32 p1)
 				(*i)->next_order = INVALID_ORDER;
 				(*i)->next_station = INVALID_STATION;
 			}
+			st->goods[cid].cargo.packets.Rebuild();
 			st->goods[cid].cargo.InvalidateCache();
 		}
 	}
@@ -1377,12 +1378,18 @@ bool CargodestModeChanged(int32 p1)
 	CargoSourceSink *css;
 	FOR_ALL_TOWNS(css) {
 		for (CargoID cid = 0; cid < NUM_CARGO; cid++) {
-			if (!CargoHasDestinations(cid)) css->cargo_links[cid].Clear();
+			if (!CargoHasDestinations(cid)) {
+				css->cargo_links[cid].Clear();
+				css->InvalidateLinkWeightIndex(cid);
+			}
 		}
 	}
 	FOR_ALL_INDUSTRIES(css) {
 		for (CargoID cid = 0; cid < NUM_CARGO; cid++) {
-			if (!CargoHasDestinations(cid)) css->cargo_links[cid].Clear();
+			if (!CargoHasDestinations(cid)) {
+				css->cargo_links[cid].Clear();
+				css->InvalidateLinkWeightIndex(cid);
+			}
 		}
 	}
 
@@ -1896,6 +1903,9 @@ CommandCost CmdChangeSetting(TileIndex tile, DoCommandFlag flags, uint32 p1, uin
 			return CommandCost();
 		}
 
+		/* Many game settings influence cargo routing decisions. */
+		InvalidateRouteTables();
+
 		if (sd->desc.flags & SGF_NO_NETWORK) {
 			GamelogStartAction(GLAT_SETTING);
 			GamelogSetting(sd->desc.name, oldval, newval);
@@ -407,6 +407,7 @@ struct YAPFSettings {
 	bool   ship_use_yapf;                    ///< use YAPF for ships
 	bool   road_use_yapf;                    ///< use YAPF for road
 	bool   rail_use_yapf;                    ///< use YAPF for rail
+	bool   rail_parallel_search;             ///< search paths of trains in advance on several threads
 	uint32 road_slope_penalty;               ///< penalty for up-hill slope
 	uint32 road_curve_penalty;               ///< penalty for curves
 	uint32 road_crossing_penalty;            ///< penalty for level crossing
@@ -16,6 +16,7 @@
 #include "news_func.h"
 #include "company_func.h"
 #include "pathfinder/npf/npf_func.h"
+#include "pathfinder/pf_query_log.h"
 #include "depot_base.h"
 #include "station_base.h"
 #include "newgrf_engine.h"
@@ -427,12 +428,14 @@ static Track ChooseShipTrack(Ship *v, TileIndex tile, DiagDirection enterdir, Tr
 
 	bool path_found = true;
 	Track track;
+	PathfinderQuery query(PFQ_SHIP_TRACK, v, tile, enterdir);
 	switch (_settings_game.pf.pathfinder_for_ships) {
 		case VPF_OPF: track = OPFShipChooseTrack(v, tile, enterdir, tracks, path_found); break;
 		case VPF_NPF: track = NPFShipChooseTrack(v, tile, enterdir, tracks, path_found); break;
 		case VPF_YAPF: track = YapfShipChooseTrack(v, tile, enterdir, tracks, path_found); break;
 		default: NOT_REACHED();
 	}
+	query.Finish(track, path_found);
 
 	v->HandlePathfindingResult(path_found);
 	return track;
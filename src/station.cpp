@@ -483,6 +483,8 @@ CommandCost StationRect::BeforeAddTile(TileIndex tile, StationRectMode mode)
 {
 	int x = TileX(tile);
 	int y = TileY(tile);
+	/* Station layout and catchment are part of the routing decisions. */
+	if (mode != ADD_TEST) InvalidateRouteTables();
 	if (this->IsEmpty()) {
 		/* we are adding the first station tile */
 		if (mode != ADD_TEST) {
@@ -547,6 +549,8 @@ bool StationRect::AfterRemoveTile(BaseStation *st, TileIndex tile)
 {
 	int x = TileX(tile);
 	int y = TileY(tile);
+	/* Station layout and catchment are part of the routing decisions. */
+	InvalidateRouteTables();
 
 	/* look if removed tile was on the bounding rect edge
 	 * and try to reduce the rect by this edge
@@ -18,6 +18,7 @@
 #include "industry_type.h"
 #include "newgrf_storage.h"
 #include "cargodest_type.h"
+#include "cargodest_base.h"
 #include "core/smallvec_type.hpp"
 #include <map>
 #include <set>
@@ -117,6 +118,7 @@ struct GoodsEntry {
 	uint16 cargo_counter;   ///< Update timer for the packets' next hop
 	StationCargoList cargo; ///< The cargo packets of cargo waiting in this station
 	RouteLinkList routes;   ///< List of originating route links
+	RouteTable route_table; ///< Cached routing decisions for cargo waiting here
 
 	/**
 	 * Reports whether a vehicle has ever tried to load the cargo at this station.
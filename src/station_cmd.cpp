@@ -759,6 +759,9 @@ void UpdateStationAcceptance(Station *st, bool show_msg)
 	uint new_acc = GetAcceptanceMask(st);
 	if (old_acc == new_acc) return;
 
+	/* Cargo routing depends on acceptance. */
+	InvalidateRouteTables();
+
 	/* show a message to report that the acceptance was changed? */
 	if (show_msg && st->owner == _local_company && st->IsInUse()) {
 		/* List of accept and reject strings for different number of
@@ -2143,6 +2146,7 @@ CommandCost CmdBuildRoadStop(TileIndex tile, DoCommandFlag flags, uint32 p1, uin
 			DirtyCompanyInfrastructureWindows(st->owner);
 
 			MarkTileDirtyByTile(cur_tile);
+			YapfNotifyRoadLayoutChange(cur_tile);
 		}
 	}
 
@@ -2885,6 +2889,8 @@ CommandCost CmdBuildDock(TileIndex tile, DoCommandFlag flags, uint32 p1, uint32
 
 		assert(wc != WATER_CLASS_INVALID);
 		MakeDock(tile, st->owner, st->index, direction, wc);
+		YapfNotifyWaterLayoutChange(tile);
+		YapfNotifyWaterLayoutChange(tile + TileOffsByDiagDir(direction));
 
 		st->UpdateVirtCoord();
 		UpdateStationAcceptance(st, false);
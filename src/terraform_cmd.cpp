@@ -22,6 +22,7 @@
 #include "company_func.h"
 #include "strings_func.h"
 #include "tunnelbridge.h"
+#include "pathfinder/yapf/yapf_cache.h"
 
 #include "table/strings.h"
 
@@ -405,6 +406,8 @@ CommandCost CmdTerraformLand(TileIndex tile, DoCommandFlag flags, uint32 p1, uin
 				int height = it->second;
 
 				SetTileHeight(tile, (uint)height);
+				/* The slope of roads around the tile changes. */
+				YapfNotifyRoadLayoutChange(tile);
 			}
 		}
 
@@ -32,6 +32,12 @@ struct BuildingCounts {
 
 typedef TileMatrix<uint32, 4> AcceptanceMatrix;
 
+/** Entry of the cumulative acceptance index of a town. */
+struct AcceptanceIndexItem {
+	uint32 weight_sum; ///< Weight sum of all accepting squares up to and including this one.
+	TileIndex tile;    ///< North tile of the grid square.
+};
+
 static const uint CUSTOM_TOWN_NUMBER_DIFFICULTY  = 4; ///< value for custom town number in difficulty settings
 static const uint CUSTOM_TOWN_MAX_NUMBER = 5000;  ///< this is the maximum number of towns a user can specify in customisation
 
@@ -114,6 +120,7 @@ struct Town : TownPool::PoolItem<&_town_pool>, CargoSourceSink {
 	/* Current cargo acceptance and production. */
 	uint32 cargo_accepted_weights[NUM_CARGO]; ///< NOSAVE: Weight sum of accepting squares per cargo.
 	uint32 cargo_accepted_max_weight; ///< NOSAVE: Cached maximum weight for an accepting square.
+	SmallVector<AcceptanceIndexItem, 16> cargo_accepted_index[NUM_CARGO]; ///< NOSAVE: Running weight sums of the accepting squares per cargo.
 
 	void UpdateLabel();
 
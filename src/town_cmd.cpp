@@ -46,6 +46,7 @@
 #include "object_base.h"
 #include "ai/ai.hpp"
 #include "game/game.hpp"
+#include "cargodest_func.h"
 
 #include "table/strings.h"
 #include "table/town_land.h"
@@ -62,6 +63,8 @@ Town::~Town()
 	free(this->name);
 	free(this->text);
 
+	RemoveFromNearbyIndex(this);
+
 	if (CleaningPool()) return;
 
 	/* Delete town authority window
@@ -783,6 +786,7 @@ void UpdateTownCargoTotal(Town *t)
 {
 	t->cargo_accepted_total = 0;
 	MemSetT(t->cargo_accepted_weights, 0, lengthof(t->cargo_accepted_weights));
+	for (CargoID cid = 0; cid < NUM_CARGO; cid++) t->cargo_accepted_index[cid].Clear();
 
 	/* Calculate the maximum weight based on the grid square furthest
 	 * from the town centre. The maximum weight is two times the L-inf
@@ -802,6 +806,11 @@ void UpdateTownCargoTotal(Town *t)
 				/* For each accepted cargo, the grid square weight is the maximum weight
 				 * minus two times the L-inf norm between this square and the centre square. */
 				t->cargo_accepted_weights[cid] += t->cargo_accepted_max_weight - (DistanceMax(t->xy_aligned, tile) / AcceptanceMatrix::GRID) * 2;
+
+				/* Remember the running weight sum for the destination tile selection. */
+				AcceptanceIndexItem *item = t->cargo_accepted_index[cid].Append();
+				item->weight_sum = t->cargo_accepted_weights[cid];
+				item->tile = tile;
 			}
 		}
 	}
@@ -1612,6 +1621,7 @@ void UpdateTownMaxPass(Town *t)
 static void DoCreateTown(Town *t, TileIndex tile, uint32 townnameparts, TownSize size, bool city, TownLayout layout, bool manual)
 {
 	t->xy = tile;
+	AddToNearbyIndex(t);
 	t->cache.num_houses = 0;
 	t->time_until_rebuild = 10;
 	UpdateTownRadius(t);
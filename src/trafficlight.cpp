@@ -26,6 +26,7 @@
 #include "trafficlight.h"
 #include "trafficlight_type.h"
 #include "date_func.h"
+#include "pathfinder/yapf/yapf_cache.h"
 #include "company_func.h"
 
 #include "table/sprites.h"
@@ -73,6 +74,119 @@ TLC *GetTrafficLightConsist(TileIndex tile, bool checkroadworks)
 	return visited;
 }
 
+/**
+ * Cache of the traffic light consist of every traffic light tile, so the
+ * state of a light can be found without searching its consist. It is an open
+ * addressing hash table keyed by tile. A consist is searched when one of its
+ * tiles is queried the first time and then all its tiles are stored at once.
+ * Building or removing traffic lights and roadworks on traffic light tiles
+ * throw away the whole cache by bumping the stamp.
+ */
+struct TLCCacheSlot {
+	TileIndex tile;  ///< Tile with traffic lights.
+	uint32 stamp;    ///< The slot is only used if this equals #_tlc_cache_stamp.
+	TileIndex root;  ///< Lowest tile index of the consist, which identifies it.
+	bool roadworks;  ///< Are there roadworks on any tile of the consist?
+};
+
+static const uint TLC_CACHE_MIN_SIZE = 64; ///< Initial number of slots of the cache.
+
+static TLCCacheSlot *_tlc_cache = NULL;  ///< Slots of the cache.
+static uint _tlc_cache_size = 0;         ///< Number of slots, a power of two.
+static uint _tlc_cache_used = 0;         ///< Number of used slots.
+static uint32 _tlc_cache_stamp = 1;      ///< Stamp of the used slots.
+static uint8 _tlc_cache_distance = 0;    ///< Value of the max_tlc_distance setting the cache is valid for.
+
+/** Throw away the cached traffic light consists. */
+void InvalidateTrafficLightConsists()
+{
+	_tlc_cache_used = 0;
+	if (++_tlc_cache_stamp == 0) {
+		/* Old stamps would become valid again. */
+		MemSetT(_tlc_cache, 0, _tlc_cache_size);
+		_tlc_cache_stamp = 1;
+	}
+}
+
+/**
+ * Find the slot of a tile in the cache.
+ * @param tile Tile to look for.
+ * @return The slot with the tile or the free slot the tile belongs in.
+ */
+static inline TLCCacheSlot *FindTLCCacheSlot(TileIndex tile)
+{
+	uint i = tile * 0x9E3779B1U >> 8;
+	for (;;) {
+		TLCCacheSlot *slot = &_tlc_cache[i & (_tlc_cache_size - 1)];
+		if (slot->stamp != _tlc_cache_stamp || slot->tile == tile) return slot;
+		i++;
+	}
+}
+
+/**
+ * Make sure the cache has room for more tiles, keeping at most half of the
+ * slots used.
+ * @param count Number of tiles to add.
+ */
+static void ReserveTLCCache(uint count)
+{
+	if ((_tlc_cache_used + count) * 2 <= _tlc_cache_size) return;
+
+	TLCCacheSlot *old_cache = _tlc_cache;
+	uint old_size = _tlc_cache_size;
+
+	_tlc_cache_size = max(TLC_CACHE_MIN_SIZE, _tlc_cache_size);
+	while ((_tlc_cache_used + count) * 2 > _tlc_cache_size) _tlc_cache_size *= 2;
+	_tlc_cache = CallocT<TLCCacheSlot>(_tlc_cache_size);
+
+	for (uint i = 0; i < old_size; i++) {
+		if (old_cache[i].stamp == _tlc_cache_stamp) *FindTLCCacheSlot(old_cache[i].tile) = old_cache[i];
+	}
+	free(old_cache);
+}
+
+/**
+ * Get the cached traffic light consist of a tile.
+ * @param tile Tile with traffic lights.
+ * @return The cache slot of the tile.
+ */
+static const TLCCacheSlot *GetTLCCacheSlot(TileIndex tile)
+{
+	if (_tlc_cache_distance != _settings_game.construction.max_tlc_distance) {
+		InvalidateTrafficLightConsists();
+		_tlc_cache_distance = _settings_game.construction.max_tlc_distance;
+	}
+
+	if (_tlc_cache_size != 0) {
+		const TLCCacheSlot *slot = FindTLCCacheSlot(tile);
+		if (slot->stamp == _tlc_cache_stamp) return slot;
+	}
+
+	/* Not cached yet, so search the consist and cache all of its tiles. */
+	TLC *consist = GetTrafficLightConsist(tile, false);
+
+	bool roadworks = false;
+	for (TLC::iterator it = consist->begin(); it != consist->end(); it++) {
+		if (HasRoadWorks(*it)) {
+			roadworks = true;
+			break;
+		}
+	}
+
+	ReserveTLCCache((uint)consist->size());
+	for (TLC::iterator it = consist->begin(); it != consist->end(); it++) {
+		TLCCacheSlot *slot = FindTLCCacheSlot(*it);
+		slot->tile = *it;
+		slot->stamp = _tlc_cache_stamp;
+		slot->root = *consist->begin();
+		slot->roadworks = roadworks;
+		_tlc_cache_used++;
+	}
+	delete consist;
+
+	return FindTLCCacheSlot(tile);
+}
+
 /**
  * Gets the lowest TileIndex of the traffic light consist or 0 if roadworks
  * are found in the consist.
@@ -81,11 +195,8 @@ TLC *GetTrafficLightConsist(TileIndex tile, bool checkroadworks)
  */
 TileIndex GetTLCLowestTileIndexOrRoadWorks(TileIndex tile)
 {
-	TLC *consist = GetTrafficLightConsist(tile, true);
-	TileIndex result = 0;
-	if (consist != 0) result = *(consist->begin());
-	delete consist;
-	return result;
+	const TLCCacheSlot *slot = GetTLCCacheSlot(tile);
+	return slot->roadworks ? 0 : slot->root;
 }
 
 /**
@@ -215,6 +326,8 @@ CommandCost CmdBuildTrafficLights(TileIndex tile, DoCommandFlag flags, uint32 p1
 		MakeTrafficLights(tile);
 		AddAnimatedTile(tile);
 		MarkTileDirtyByTile(tile);
+		YapfNotifyRoadLayoutChange(tile);
+		InvalidateTrafficLightConsists();
 	}
 	return CommandCost(EXPENSES_CONSTRUCTION, _price[PR_BUILD_SIGNALS]);
 }
@@ -247,6 +360,8 @@ CommandCost CmdRemoveTrafficLights(TileIndex tile, DoCommandFlag flags, uint32 p
 		DeleteAnimatedTile(tile);
 		ClearTrafficLights(tile);
 		MarkTileDirtyByTile(tile);
+		YapfNotifyRoadLayoutChange(tile);
+		InvalidateTrafficLightConsists();
 	}
 	return CommandCost(EXPENSES_CONSTRUCTION, _price[PR_BUILD_SIGNALS]);
 }
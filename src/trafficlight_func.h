@@ -17,3 +17,4 @@ void DrawTrafficLights(TileInfo* ti);
 CommandCost CmdBuildTrafficLights(TileIndex tile, DoCommandFlag flags, uint32 p1, uint32 p2, const char *text);
 CommandCost CmdRemoveTrafficLights(TileIndex tile, DoCommandFlag flags, uint32 p1, uint32 p2, const char *text);
 void ClearAllTrafficLights();
+void InvalidateTrafficLightConsists();
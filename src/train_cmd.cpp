@@ -14,6 +14,7 @@
 #include "articulated_vehicles.h"
 #include "command_func.h"
 #include "pathfinder/npf/npf_func.h"
+#include "pathfinder/pf_query_log.h"
 #include "pathfinder/yapf/yapf.hpp"
 #include "news_func.h"
 #include "company_func.h"
@@ -2057,12 +2058,16 @@ static FindDepotData FindClosestTrainDepot(Train *v, int max_distance)
 	PBSTileInfo origin = FollowTrainReservation(v);
 	if (IsRailDepotTile(origin.tile)) return FindDepotData(origin.tile, 0);
 
+	PathfinderQuery query(PFQ_TRAIN_DEPOT, v, origin.tile, origin.trackdir);
+	FindDepotData fdd;
 	switch (_settings_game.pf.pathfinder_for_trains) {
-		case VPF_NPF: return NPFTrainFindNearestDepot(v, max_distance);
-		case VPF_YAPF: return YapfTrainFindNearestDepot(v, max_distance);
+		case VPF_NPF: fdd = NPFTrainFindNearestDepot(v, max_distance); break;
+		case VPF_YAPF: fdd = YapfTrainFindNearestDepot(v, max_distance); break;
 
 		default: NOT_REACHED();
 	}
+	query.Finish(fdd.tile, fdd.tile != INVALID_TILE);
+	return fdd;
 }
 
 /**
@@ -2403,12 +2408,16 @@ static const byte _initial_tile_subcoord[6][4][3] = {
  */
 static Track DoTrainPathfind(const Train *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, bool do_track_reservation, PBSTileInfo *dest)
 {
+	PathfinderQuery query(PFQ_TRAIN_TRACK, v, tile, enterdir);
+	Track track;
 	switch (_settings_game.pf.pathfinder_for_trains) {
-		case VPF_NPF: return NPFTrainChooseTrack(v, tile, enterdir, tracks, path_found, do_track_reservation, dest);
-		case VPF_YAPF: return YapfTrainChooseTrack(v, tile, enterdir, tracks, path_found, do_track_reservation, dest);
+		case VPF_NPF: track = NPFTrainChooseTrack(v, tile, enterdir, tracks, path_found, do_track_reservation, dest); break;
+		case VPF_YAPF: track = YapfTrainChooseTrack(v, tile, enterdir, tracks, path_found, do_track_reservation, dest); break;
 
 		default: NOT_REACHED();
 	}
+	query.Finish(track, path_found);
+	return track;
 }
 
 /**
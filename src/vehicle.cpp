@@ -52,15 +52,16 @@
 #include "tunnel_map.h"
 #include "depot_map.h"
 #include "cargodest_func.h"
+#include "pathfinder/yapf/yapf.h"
+#include "pathfinder/pf_telemetry.h"
 #include "gamelog.h"
+#include "departures_func.h"
 
 #include "table/strings.h"
 
 // MYGUI
 #include "aaa_template_vehicle_func.h"
 
-#define GEN_HASH(x, y) ((GB((y), 6 + ZOOM_LVL_SHIFT, 6) << 6) + GB((x), 7 + ZOOM_LVL_SHIFT, 6))
-
 VehicleID _new_vehicle_id;
 uint16 _returned_refit_capacity;      ///< Stores the capacity after a refit operation.
 uint16 _returned_mail_refit_capacity; ///< Stores the mail capacity after a refit operation (Aircraft only).
@@ -338,25 +339,55 @@ byte VehicleRandomBits()
 	return GB(Random(), 0, 8);
 }
 
-/* Size of the hash, 6 = 64 x 64, 7 = 128 x 128. Larger sizes will (in theory) reduce hash
- * lookup times at the expense of memory usage. */
-const int HASH_BITS = 7;
-const int HASH_SIZE = 1 << HASH_BITS;
-const int HASH_MASK = HASH_SIZE - 1;
-const int TOTAL_HASH_SIZE = 1 << (HASH_BITS * 2);
-const int TOTAL_HASH_MASK = TOTAL_HASH_SIZE - 1;
+/* Minimum sizes of the tile and viewport hashes, 6 = 64 x 64, 7 = 128 x 128. The hashes grow
+ * with the number of vehicles, but not beyond the size at which they cover the whole map. */
+static const uint MIN_TILE_HASH_BITS = 7;
+static const uint MIN_VIEWPORT_HASH_BITS = 6;
+/* Maximum size of the tile and viewport hashes, 10 = 1024 x 1024. */
+static const uint MAX_VEHICLE_HASH_BITS = 10;
 
 /* Resolution of the hash, 0 = 1*1 tile, 1 = 2*2 tiles, 2 = 4*4 tiles, etc.
  * Profiling results show that 0 is fastest. */
 const int HASH_RES = 0;
 
-static Vehicle *_vehicle_tile_hash[TOTAL_HASH_SIZE];
+static Vehicle **_vehicle_tile_hash = NULL;  ///< Vehicles by tile, see #UpdateVehicleTileHash.
+static uint _vehicle_tile_hash_bits = 0;     ///< Size of the tile hash, number of bits per axis.
+static uint _vehicle_tile_hash_mask = 0;     ///< Mask of the coordinates of the tile hash.
+static uint _vehicle_tile_hash_limit = 0;    ///< Number of vehicles at which the tile hash is resized.
+
+/**
+ * Get the size of a vehicle hash for a number of vehicles. The hash is made
+ * large enough to have at least four buckets for every vehicle.
+ * @param min_bits Minimum number of bits per axis.
+ * @param map_bits Number of bits per axis at which the hash covers the whole map.
+ * @param vehicles Number of vehicles.
+ * @return Number of bits per axis.
+ */
+static uint GetVehicleHashBits(uint min_bits, uint map_bits, uint vehicles)
+{
+	uint bits = min_bits;
+	while (bits < map_bits && bits < MAX_VEHICLE_HASH_BITS && (1U << (2 * bits)) < vehicles * 4) bits++;
+	return bits;
+}
+
+/**
+ * Get the number of vehicles at which a vehicle hash has to be resized.
+ * @param bits Number of bits per axis of the hash.
+ * @param vehicles Current number of vehicles.
+ * @return Number of vehicles.
+ */
+static uint GetVehicleHashLimit(uint bits, uint vehicles)
+{
+	/* When the hash couldn't grow as much as wanted, check again when the number of vehicles has doubled. */
+	uint limit = (1U << (2 * bits)) / 4;
+	return limit < vehicles ? vehicles * 2 : limit;
+}
 
 static Vehicle *VehicleFromTileHash(int xl, int yl, int xu, int yu, void *data, VehicleFromPosProc *proc, bool find_first)
 {
-	for (int y = yl; ; y = (y + (1 << HASH_BITS)) & (HASH_MASK << HASH_BITS)) {
-		for (int x = xl; ; x = (x + 1) & HASH_MASK) {
-			Vehicle *v = _vehicle_tile_hash[(x + y) & TOTAL_HASH_MASK];
+	for (int y = yl; ; y = (y + (1 << _vehicle_tile_hash_bits)) & (_vehicle_tile_hash_mask << _vehicle_tile_hash_bits)) {
+		for (int x = xl; ; x = (x + 1) & _vehicle_tile_hash_mask) {
+			Vehicle *v = _vehicle_tile_hash[x + y];
 			for (; v != NULL; v = v->hash_tile_next) {
 				Vehicle *a = proc(v, data);
 				if (find_first && a != NULL) return a;
@@ -394,10 +425,10 @@ static Vehicle *VehicleFromPosXY(int x, int y, void *data, VehicleFromPosProc *p
 	const int COLL_DIST = 6;
 
 	/* Hash area to scan is from xl,yl to xu,yu */
-	int xl = GB((x - COLL_DIST) / TILE_SIZE, HASH_RES, HASH_BITS);
-	int xu = GB((x + COLL_DIST) / TILE_SIZE, HASH_RES, HASH_BITS);
-	int yl = GB((y - COLL_DIST) / TILE_SIZE, HASH_RES, HASH_BITS) << HASH_BITS;
-	int yu = GB((y + COLL_DIST) / TILE_SIZE, HASH_RES, HASH_BITS) << HASH_BITS;
+	int xl = GB((x - COLL_DIST) / TILE_SIZE, HASH_RES, _vehicle_tile_hash_bits);
+	int xu = GB((x + COLL_DIST) / TILE_SIZE, HASH_RES, _vehicle_tile_hash_bits);
+	int yl = GB((y - COLL_DIST) / TILE_SIZE, HASH_RES, _vehicle_tile_hash_bits) << _vehicle_tile_hash_bits;
+	int yu = GB((y + COLL_DIST) / TILE_SIZE, HASH_RES, _vehicle_tile_hash_bits) << _vehicle_tile_hash_bits;
 
 	return VehicleFromTileHash(xl, yl, xu, yu, data, proc, find_first);
 }
@@ -449,10 +480,10 @@ bool HasVehicleOnPosXY(int x, int y, void *data, VehicleFromPosProc *proc)
  */
 static Vehicle *VehicleFromPos(TileIndex tile, void *data, VehicleFromPosProc *proc, bool find_first)
 {
-	int x = GB(TileX(tile), HASH_RES, HASH_BITS);
-	int y = GB(TileY(tile), HASH_RES, HASH_BITS) << HASH_BITS;
+	int x = GB(TileX(tile), HASH_RES, _vehicle_tile_hash_bits);
+	int y = GB(TileY(tile), HASH_RES, _vehicle_tile_hash_bits) << _vehicle_tile_hash_bits;
 
-	Vehicle *v = _vehicle_tile_hash[(x + y) & TOTAL_HASH_MASK];
+	Vehicle *v = _vehicle_tile_hash[x + y];
 	for (; v != NULL; v = v->hash_tile_next) {
 		if (v->tile != tile) continue;
 
@@ -598,9 +629,9 @@ static void UpdateVehicleTileHash(Vehicle *v, bool remove)
 	if (remove) {
 		new_hash = NULL;
 	} else {
-		int x = GB(TileX(v->tile), HASH_RES, HASH_BITS);
-		int y = GB(TileY(v->tile), HASH_RES, HASH_BITS) << HASH_BITS;
-		new_hash = &_vehicle_tile_hash[(x + y) & TOTAL_HASH_MASK];
+		int x = GB(TileX(v->tile), HASH_RES, _vehicle_tile_hash_bits);
+		int y = GB(TileY(v->tile), HASH_RES, _vehicle_tile_hash_bits) << _vehicle_tile_hash_bits;
+		new_hash = &_vehicle_tile_hash[x + y];
 	}
 
 	if (old_hash == new_hash) return;
@@ -623,7 +654,129 @@ static void UpdateVehicleTileHash(Vehicle *v, bool remove)
 	v->hash_tile_current = new_hash;
 }
 
-static Vehicle *_vehicle_viewport_hash[0x1000];
+/**
+ * Resize the tile hash to fit the map and the number of vehicles, and rehash all vehicles in it.
+ * @warning Must not be called while the hash is being walked, see #ResizeVehicleHashes.
+ */
+static void ResizeVehicleTileHash()
+{
+	uint vehicles = (uint)Vehicle::GetNumItems();
+	uint bits = GetVehicleHashBits(MIN_TILE_HASH_BITS, max(MapLogX(), MapLogY()), vehicles);
+	_vehicle_tile_hash_limit = GetVehicleHashLimit(bits, vehicles);
+	if (bits == _vehicle_tile_hash_bits) return;
+
+	free(_vehicle_tile_hash);
+	_vehicle_tile_hash = CallocT<Vehicle *>(1 << (2 * bits));
+	_vehicle_tile_hash_bits = bits;
+	_vehicle_tile_hash_mask = (1 << bits) - 1;
+
+	Vehicle *v;
+	FOR_ALL_VEHICLES(v) {
+		if (v->hash_tile_current == NULL) continue;
+		v->hash_tile_current = NULL;
+		UpdateVehicleTileHash(v, false);
+	}
+}
+
+/* Size of the road vehicle tile hash. The road vehicles are hashed by the lowest
+ * bits of the X and Y coordinates of their tile, like the tile hash above. */
+const uint ROAD_VEH_HASH_BITS = 8;
+const uint ROAD_VEH_HASH_MASK = (1 << ROAD_VEH_HASH_BITS) - 1;
+
+/** Road vehicles by tile, so road vehicles only have to check each other in their collision checks. */
+static RoadVehicle *_road_vehicle_tile_hash[1 << (ROAD_VEH_HASH_BITS * 2)];
+
+/**
+ * Get the chain of the road vehicle tile hash of a tile.
+ * @param tile The tile.
+ * @return The first road vehicle of the chain.
+ */
+static inline RoadVehicle **GetRoadVehicleTileHashChain(TileIndex tile)
+{
+	return &_road_vehicle_tile_hash[(TileX(tile) & ROAD_VEH_HASH_MASK) | (TileY(tile) & ROAD_VEH_HASH_MASK) << ROAD_VEH_HASH_BITS];
+}
+
+/**
+ * Get the first road vehicle on a tile.
+ * Iterate over the others with RoadVehicle::GetNextOnTile.
+ * @param tile The tile.
+ * @return The first road vehicle, or \c NULL if there is none.
+ */
+RoadVehicle *GetFirstRoadVehicleOnTile(TileIndex tile)
+{
+	RoadVehicle *v = *GetRoadVehicleTileHashChain(tile);
+	while (v != NULL && v->tile != tile) v = v->hash_tile_road_next;
+	return v;
+}
+
+static void UpdateRoadVehicleTileHash(RoadVehicle *v, bool remove)
+{
+	RoadVehicle **old_hash = v->hash_tile_road_current;
+	RoadVehicle **new_hash = remove ? NULL : GetRoadVehicleTileHashChain(v->tile);
+
+	if (old_hash == new_hash) return;
+
+	/* Remove from the old position in the hash table */
+	if (old_hash != NULL) {
+		if (v->hash_tile_road_next != NULL) v->hash_tile_road_next->hash_tile_road_prev = v->hash_tile_road_prev;
+		*v->hash_tile_road_prev = v->hash_tile_road_next;
+	}
+
+	/* Insert vehicle at beginning of the new position in the hash table */
+	if (new_hash != NULL) {
+		v->hash_tile_road_next = *new_hash;
+		if (v->hash_tile_road_next != NULL) v->hash_tile_road_next->hash_tile_road_prev = &v->hash_tile_road_next;
+		v->hash_tile_road_prev = new_hash;
+		*new_hash = v;
+	}
+
+	/* Remember current hash position */
+	v->hash_tile_road_current = new_hash;
+}
+
+static Vehicle **_vehicle_viewport_hash = NULL;  ///< Vehicles by position in the viewport, see #UpdateVehicleViewportHash.
+static uint _vehicle_viewport_hash_bits = 0;      ///< Size of the viewport hash, number of bits per axis.
+static uint _vehicle_viewport_hash_limit = 0;     ///< Number of vehicles at which the viewport hash is resized.
+
+/**
+ * Get the position in the viewport hash of a viewport coordinate.
+ * The hash consists of areas of 128 x 64 pixels at normal zoom.
+ * @param x The X coordinate.
+ * @param y The Y coordinate.
+ * @return The position in the hash.
+ */
+static inline uint GetViewportHash(int x, int y)
+{
+	return (GB(y, 6 + ZOOM_LVL_SHIFT, _vehicle_viewport_hash_bits) << _vehicle_viewport_hash_bits) + GB(x, 7 + ZOOM_LVL_SHIFT, _vehicle_viewport_hash_bits);
+}
+
+/**
+ * Resize the viewport hash to fit the map and the number of vehicles, and rehash all vehicles in it.
+ * @warning Must not be called while the hash is being walked, see #ResizeVehicleHashes.
+ */
+static void ResizeVehicleViewportHash()
+{
+	/* The map is (MapSizeX() + MapSizeY()) / 4 areas of the hash wide and high. */
+	uint vehicles = (uint)Vehicle::GetNumItems();
+	uint bits = GetVehicleHashBits(MIN_VIEWPORT_HASH_BITS, FindLastBit(MapSizeX() + MapSizeY() - 1) - 1, vehicles);
+	_vehicle_viewport_hash_limit = GetVehicleHashLimit(bits, vehicles);
+	if (bits == _vehicle_viewport_hash_bits) return;
+
+	free(_vehicle_viewport_hash);
+	_vehicle_viewport_hash = CallocT<Vehicle *>(1 << (2 * bits));
+	_vehicle_viewport_hash_bits = bits;
+
+	Vehicle *v;
+	FOR_ALL_VEHICLES(v) {
+		if (v->coord.left == INVALID_COORD) continue;
+
+		Vehicle **new_hash = &_vehicle_viewport_hash[GetViewportHash(v->coord.left, v->coord.top)];
+		v->hash_viewport_next = *new_hash;
+		if (v->hash_viewport_next != NULL) v->hash_viewport_next->hash_viewport_prev = &v->hash_viewport_next;
+		v->hash_viewport_prev = new_hash;
+		*new_hash = v;
+	}
+}
 
 static void UpdateVehicleViewportHash(Vehicle *v, int x, int y)
 {
@@ -631,8 +784,8 @@ static void UpdateVehicleViewportHash(Vehicle *v, int x, int y)
 	int old_x = v->coord.left;
 	int old_y = v->coord.top;
 
-	new_hash = (x == INVALID_COORD) ? NULL : &_vehicle_viewport_hash[GEN_HASH(x, y)];
-	old_hash = (old_x == INVALID_COORD) ? NULL : &_vehicle_viewport_hash[GEN_HASH(old_x, old_y)];
+	new_hash = (x == INVALID_COORD) ? NULL : &_vehicle_viewport_hash[GetViewportHash(x, y)];
+	old_hash = (old_x == INVALID_COORD) ? NULL : &_vehicle_viewport_hash[GetViewportHash(old_x, old_y)];
 
 	if (old_hash == new_hash) return;
 
@@ -651,12 +804,44 @@ static void UpdateVehicleViewportHash(Vehicle *v, int x, int y)
 	}
 }
 
+/**
+ * Grow the tile and viewport hashes when there are more vehicles than they
+ * were sized for. Vehicles are added while the hashes are walked, e.g. when
+ * flooding a vehicle creates an explosion, so the hashes are only resized
+ * here, before the vehicles are ticked.
+ */
+static void ResizeVehicleHashes()
+{
+	uint vehicles = (uint)Vehicle::GetNumItems();
+	if (vehicles > _vehicle_tile_hash_limit) ResizeVehicleTileHash();
+	if (vehicles > _vehicle_viewport_hash_limit) ResizeVehicleViewportHash();
+}
+
+/**
+ * Remove all vehicles from the hashes, and size the hashes for the current map.
+ * The vehicles are added again by #VehicleUpdatePosition and #VehicleUpdateViewport.
+ */
 void ResetVehicleHash()
 {
 	Vehicle *v;
-	FOR_ALL_VEHICLES(v) { v->hash_tile_current = NULL; }
-	memset(_vehicle_viewport_hash, 0, sizeof(_vehicle_viewport_hash));
-	memset(_vehicle_tile_hash, 0, sizeof(_vehicle_tile_hash));
+	FOR_ALL_VEHICLES(v) {
+		v->hash_tile_current = NULL;
+		v->coord.left = INVALID_COORD;
+	}
+	RoadVehicle *rv;
+	FOR_ALL_ROADVEHICLES(rv) { rv->hash_tile_road_current = NULL; }
+
+	free(_vehicle_tile_hash);
+	_vehicle_tile_hash = NULL;
+	_vehicle_tile_hash_bits = 0;
+	ResizeVehicleTileHash();
+
+	free(_vehicle_viewport_hash);
+	_vehicle_viewport_hash = NULL;
+	_vehicle_viewport_hash_bits = 0;
+	ResizeVehicleViewportHash();
+
+	memset(_road_vehicle_tile_hash, 0, sizeof(_road_vehicle_tile_hash));
 }
 
 void ResetVehicleColourMap()
@@ -683,6 +868,7 @@ void InitializeVehicles()
 {
 	_vehicles_to_autoreplace.Reset();
 	ResetVehicleHash();
+	InvalidateDepartureIndex();
 }
 
 uint CountVehiclesInChain(const Vehicle *v)
@@ -790,6 +976,8 @@ void Vehicle::HandlePathfindingResult(bool path_found)
 /** Destroy all stuff that (still) needs the virtual functions to work properly */
 void Vehicle::PreDestructor()
 {
+	ForgetPathfinderTelemetryVehicle(this->index);
+
 	if (CleaningPool()) return;
 
 	if (Station::IsValidID(this->last_station_visited)) {
@@ -819,6 +1007,8 @@ void Vehicle::PreDestructor()
 	}
 
 
+	if (this->type == VEH_ROAD) UpdateRoadVehicleTileHash(RoadVehicle::From(this), true);
+
 	if (this->type == VEH_ROAD && this->IsPrimaryVehicle()) {
 		RoadVehicle *v = RoadVehicle::From(this);
 		if (!(v->vehstatus & VS_CRASHED) && IsInsideMM(v->state, RVSB_IN_DT_ROAD_STOP, RVSB_IN_DT_ROAD_STOP_END)) {
@@ -941,11 +1131,17 @@ void CallVehicleTicks()
 	_vehicles_to_autoreplace.Clear();
 	_vehicles_to_templatereplace.Clear();
 
+	ResizeVehicleHashes();
+
 	RunVehicleDayProc();
 
+	/* The next hop updates queued by vehicles that arrived in the previous
+	 * tick were done at its end by RunCargoRoutingJobs. */
 	Station *st;
 	FOR_ALL_STATIONS(st) LoadUnloadStation(st);
 
+	YapfTrainPrefetchPaths();
+
 	Vehicle *v;
 	FOR_ALL_VEHICLES(v) {
 		/* Vehicle could be deleted in this tick */
@@ -1127,27 +1323,30 @@ void ViewportAddVehicles(DrawPixelInfo *dpi)
 	/* The hash area to scan */
 	int xl, xu, yl, yu;
 
-	if (dpi->width + (70 * ZOOM_LVL_BASE) < (1 << (7 + 6 + ZOOM_LVL_SHIFT))) {
-		xl = GB(l - (70 * ZOOM_LVL_BASE), 7 + ZOOM_LVL_SHIFT, 6);
-		xu = GB(r,                        7 + ZOOM_LVL_SHIFT, 6);
+	const uint bits = _vehicle_viewport_hash_bits;
+	const int mask = (1 << bits) - 1;
+
+	if (dpi->width + (70 * ZOOM_LVL_BASE) < (1 << (7 + bits + ZOOM_LVL_SHIFT))) {
+		xl = GB(l - (70 * ZOOM_LVL_BASE), 7 + ZOOM_LVL_SHIFT, bits);
+		xu = GB(r,                        7 + ZOOM_LVL_SHIFT, bits);
 	} else {
 		/* scan whole hash row */
 		xl = 0;
-		xu = 0x3F;
+		xu = mask;
 	}
 
-	if (dpi->height + (70 * ZOOM_LVL_BASE) < (1 << (6 + 6 + ZOOM_LVL_SHIFT))) {
-		yl = GB(t - (70 * ZOOM_LVL_BASE), 6 + ZOOM_LVL_SHIFT, 6) << 6;
-		yu = GB(b,                        6 + ZOOM_LVL_SHIFT, 6) << 6;
+	if (dpi->height + (70 * ZOOM_LVL_BASE) < (1 << (6 + bits + ZOOM_LVL_SHIFT))) {
+		yl = GB(t - (70 * ZOOM_LVL_BASE), 6 + ZOOM_LVL_SHIFT, bits) << bits;
+		yu = GB(b,                        6 + ZOOM_LVL_SHIFT, bits) << bits;
 	} else {
 		/* scan whole column */
 		yl = 0;
-		yu = 0x3F << 6;
+		yu = mask << bits;
 	}
 
-	for (int y = yl;; y = (y + (1 << 6)) & (0x3F << 6)) {
-		for (int x = xl;; x = (x + 1) & 0x3F) {
-			const Vehicle *v = _vehicle_viewport_hash[x + y]; // already masked & 0xFFF
+	for (int y = yl;; y = (y + (1 << bits)) & (mask << bits)) {
+		for (int x = xl;; x = (x + 1) & mask) {
+			const Vehicle *v = _vehicle_viewport_hash[x + y]; // already masked
 
 			while (v != NULL) {
 				if (v->IsDrawn() &&
@@ -1559,6 +1758,7 @@ void VehicleEnterDepot(Vehicle *v)
 void VehicleUpdatePosition(Vehicle *v)
 {
 	UpdateVehicleTileHash(v, false);
+	if (v->type == VEH_ROAD) UpdateRoadVehicleTileHash(RoadVehicle::From(v), false);
 }
 
 /**
@@ -2143,7 +2343,7 @@ void Vehicle::BeginLoading(StationID station)
 	FOR_EACH_SET_CARGO_ID(cid, this->vcache.cached_cargo_mask) {
 		/* Only update if the last update was at least route_recalc_delay ticks earlier. */
 		if (CargoHasDestinations(cid) && last_visited->goods[cid].cargo_counter == 0) {
-			last_visited->goods[cid].cargo.UpdateCargoNextHop(last_visited, cid);
+			QueueCargoNextHopUpdate(last_visited, cid);
 			last_visited->goods[cid].cargo_counter = _settings_game.economy.cargodest.route_recalc_delay;
 		}
 	}
@@ -2562,6 +2762,7 @@ void Vehicle::AddToShared(Vehicle *shared_chain)
 
 	shared_chain->orders.list->AddVehicle(this);
 	shared_chain->orders.list->MarkSeparationInvalid();
+	InvalidateDepartureIndex();
 }
 
 /**
@@ -2576,6 +2777,7 @@ void Vehicle::RemoveFromShared()
 
 	this->orders.list->MarkSeparationInvalid();
 	this->orders.list->RemoveVehicle(this);
+	InvalidateDepartureIndex();
 
 	if (!were_first) {
 		/* We are not the first shared one, so only relink our previous one. */
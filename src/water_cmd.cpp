@@ -41,6 +41,7 @@
 #include "company_gui.h"
 #include "clipboard_gui.h"
 #include "newgrf_generic.h"
+#include "pathfinder/yapf/yapf_cache.h"
 
 #include "table/strings.h"
 
@@ -157,6 +158,8 @@ CommandCost CmdBuildShipDepot(TileIndex tile, DoCommandFlag flags, uint32 p1, ui
 		MakeShipDepot(tile2, _current_company, depot->index, DEPOT_PART_SOUTH, axis, wc2);
 		MarkTileDirtyByTile(tile);
 		MarkTileDirtyByTile(tile2);
+		YapfNotifyWaterLayoutChange(tile);
+		YapfNotifyWaterLayoutChange(tile2);
 		MakeDefaultName(depot);
 	}
 
@@ -317,6 +320,9 @@ static CommandCost DoBuildLock(TileIndex tile, DiagDirection dir, DoCommandFlag
 		MarkTileDirtyByTile(tile);
 		MarkTileDirtyByTile(tile - delta);
 		MarkTileDirtyByTile(tile + delta);
+		YapfNotifyWaterLayoutChange(tile);
+		YapfNotifyWaterLayoutChange(tile - delta);
+		YapfNotifyWaterLayoutChange(tile + delta);
 		MarkCanalsAndRiversAroundDirty(tile - delta);
 		MarkCanalsAndRiversAroundDirty(tile + delta);
 	}
@@ -356,6 +362,7 @@ static CommandCost RemoveLock(TileIndex tile, DoCommandFlag flags)
 
 		if (GetWaterClass(tile) == WATER_CLASS_RIVER) {
 			MakeRiver(tile, Random());
+			YapfNotifyWaterLayoutChange(tile);
 		} else {
 			DoClearSquare(tile);
 		}
@@ -460,6 +467,7 @@ CommandCost CmdBuildCanal(TileIndex tile, DoCommandFlag flags, uint32 p1, uint32
 			}
 			MarkTileDirtyByTile(tile);
 			MarkCanalsAndRiversAroundDirty(tile);
+			YapfNotifyWaterLayoutChange(tile);
 		}
 
 		cost.AddCost(_price[PR_BUILD_CANAL]);
@@ -1104,6 +1112,7 @@ void DoFloodTile(TileIndex target)
 	if (flooded) {
 		/* Mark surrounding canal tiles dirty too to avoid glitches */
 		MarkCanalsAndRiversAroundDirty(target);
+		YapfNotifyWaterLayoutChange(target);
 
 		/* update signals if needed */
 		UpdateSignalsInBuffer();
@@ -1118,6 +1127,7 @@ void DoFloodTile(TileIndex target)
 static void DoDryUp(TileIndex tile)
 {
 	Backup<CompanyByte> cur_company(_current_company, OWNER_WATER, FILE_LINE);
+	YapfNotifyWaterLayoutChange(tile);
 
 	switch (GetTileType(tile)) {
 		case MP_RAILWAY:
@@ -346,6 +346,7 @@ CommandCost CmdBuildBuoy(TileIndex tile, DoCommandFlag flags, uint32 p1, uint32
 
 		assert(wc != WATER_CLASS_INVALID);
 		MakeBuoy(tile, wp->index, wc);
+		YapfNotifyWaterLayoutChange(tile);
 
 		wp->UpdateVirtCoord();
 		InvalidateWindowData(WC_WAYPOINT_VIEW, wp->index);